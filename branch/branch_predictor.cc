@@ -30,3 +30,8 @@ void O3_CPU::last_branch_result(uint64_t ip, uint8_t taken)
     else if ((taken == 0) && (bimodal_table[cpu][hash] > 0))
         bimodal_table[cpu][hash]--;
 }
+
+void O3_CPU::branch_predictor_final_stats()
+{
+
+}
@@ -1,9 +1,9 @@
 #!/bin/bash
 
-if [ "$#" -ne 4 ]; then
+if [ "$#" -ne 4 ] && [ "$#" -ne 5 ]; then
     echo "Illegal number of parameters"
     #echo "Usage: ./build_champsim.sh [branch_pred] [l1d_pref] [l2c_pref] [llc_pref] [llc_repl] [num_core]"
-    echo "Usage: ./build_champsim.sh [l1d_pref] [l2c_pref] [llc_pref] [num_core]"
+    echo "Usage: ./build_champsim.sh [l1d_pref] [l2c_pref] [llc_pref] [num_core] [branch_pred (optional)]"
     exit 1
 fi
 
@@ -22,10 +22,17 @@ NORMAL=$(tput sgr0)
 
 ############## Default configuration ############
 BRANCH=perceptron
-LLC_REPLACEMENT=ship
+L1I_PREFETCHER=multi    # prefetcher/*.l1i_pref, prefetchers are picked with --l1i_prefetcher_types
+STLB_PREFETCHER=multi   # prefetcher/*.stlb_pref, prefetchers are picked with --stlb_prefetcher_types
+LLC_REPLACEMENT=multi   # replacement/*.llc_repl, policies are picked with --llc_replacement_type
 #NUM_CORE=1
 #################################################
 
+# An optional fifth argument picks another branch/*.bpred
+if [ "$#" -eq 5 ]; then
+    BRANCH=$5
+fi
+
 # Sanity check
 if [ ! -f ./branch/${BRANCH}.bpred ]; then
     echo "[ERROR] Cannot find branch predictor"
@@ -34,6 +41,20 @@ if [ ! -f ./branch/${BRANCH}.bpred ]; then
     exit 1
 fi
 
+if [ ! -f ./prefetcher/${L1I_PREFETCHER}.l1i_pref ]; then
+    echo "[ERROR] Cannot find L1I prefetcher"
+	echo "[ERROR] Possible L1I prefetchers from prefetcher/*.l1i_pref "
+    find prefetcher -name "*.l1i_pref"
+    exit 1
+fi
+
+if [ ! -f ./prefetcher/${STLB_PREFETCHER}.stlb_pref ]; then
+    echo "[ERROR] Cannot find STLB prefetcher"
+	echo "[ERROR] Possible STLB prefetchers from prefetcher/*.stlb_pref "
+    find prefetcher -name "*.stlb_pref"
+    exit 1
+fi
+
 if [ ! -f ./prefetcher/${L1D_PREFETCHER}.l1d_pref ]; then
     echo "[ERROR] Cannot find L1D prefetcher"
 	echo "[ERROR] Possible L1D prefetchers from prefetcher/*.l1d_pref "
@@ -89,9 +110,11 @@ echo
 
 # Change prefetchers and replacement policy
 cp branch/${BRANCH}.bpred branch/branch_predictor.cc
+cp prefetcher/${L1I_PREFETCHER}.l1i_pref prefetcher/l1i_prefetcher.cc
 cp prefetcher/${L1D_PREFETCHER}.l1d_pref prefetcher/l1d_prefetcher.cc
 cp prefetcher/${L2C_PREFETCHER}.l2c_pref prefetcher/l2c_prefetcher.cc
 cp prefetcher/${LLC_PREFETCHER}.llc_pref prefetcher/llc_prefetcher.cc
+cp prefetcher/${STLB_PREFETCHER}.stlb_pref prefetcher/stlb_prefetcher.cc
 cp replacement/${LLC_REPLACEMENT}.llc_repl replacement/llc_replacement.cc
 
 # Build
@@ -110,6 +133,7 @@ fi
 
 echo "${BOLD}ChampSim is successfully built"
 echo "Branch Predictor: ${BRANCH}"
+echo "L1I Prefetcher: ${L1I_PREFETCHER}"
 echo "L1D Prefetcher: ${L1D_PREFETCHER}"
 echo "L2C Prefetcher: ${L2C_PREFETCHER}"
 echo "LLC Prefetcher: ${LLC_PREFETCHER}"
@@ -127,7 +151,9 @@ sed -i.bak 's/\<DRAM_CHANNELS 2\>/DRAM_CHANNELS 1/g' inc/champsim.h
 sed -i.bak 's/\<LOG2_DRAM_CHANNELS 1\>/LOG2_DRAM_CHANNELS 0/g' inc/champsim.h
 
 cp branch/bimodal.bpred branch/branch_predictor.cc
+cp prefetcher/no.l1i_pref prefetcher/l1i_prefetcher.cc
 cp prefetcher/no.l1d_pref prefetcher/l1d_prefetcher.cc
 cp prefetcher/no.l2c_pref prefetcher/l2c_prefetcher.cc
 cp prefetcher/no.llc_pref prefetcher/llc_prefetcher.cc
+cp prefetcher/no.stlb_pref prefetcher/stlb_prefetcher.cc
 cp replacement/lru.llc_repl replacement/llc_replacement.cc
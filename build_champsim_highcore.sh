@@ -1,9 +1,9 @@
 #!/bin/bash
 
-if [ "$#" -ne 4 ]; then
+if [ "$#" -ne 4 ] && [ "$#" -ne 5 ]; then
     echo "Illegal number of parameters"
     #echo "Usage: ./build_champsim.sh [branch_pred] [l1d_pref] [l2c_pref] [llc_pref] [llc_repl] [num_core]"
-    echo "Usage: ./build_champsim.sh [l1d_pref] [l2c_pref] [llc_pref] [num_core]"
+    echo "Usage: ./build_champsim.sh [l1d_pref] [l2c_pref] [llc_pref] [num_core] [branch_pred (optional)]"
     exit 1
 fi
 
@@ -22,10 +22,15 @@ NORMAL=$(tput sgr0)
 
 ############## Default configuration ############
 BRANCH=perceptron
-LLC_REPLACEMENT=ship
+LLC_REPLACEMENT=multi   # replacement/*.llc_repl, policies are picked with --llc_replacement_type
 #NUM_CORE=1
 #################################################
 
+# An optional fifth argument picks another branch/*.bpred
+if [ "$#" -eq 5 ]; then
+    BRANCH=$5
+fi
+
 # Sanity check
 if [ ! -f ./branch/${BRANCH}.bpred ]; then
     echo "[ERROR] Cannot find branch predictor"
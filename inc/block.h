@@ -5,6 +5,8 @@
 #include "instruction.h"
 #include "set.h"
 
+class LLC_INTERCONNECT;
+
 // CACHE BLOCK
 class BLOCK {
   public:
@@ -28,6 +30,13 @@ class BLOCK {
     // replacement state
     uint32_t lru;
 
+    // metadata of the prefetch that filled this block
+    uint32_t pf_metadata;
+
+    // compressed LLC: size in segments and when the line was last filled or hit
+    uint32_t comp_size;
+    uint64_t last_touch;
+
     BLOCK() {
         valid = 0;
         prefetch = 0;
@@ -47,6 +56,11 @@ class BLOCK {
         instr_id = 0;
 
         lru = 0;
+
+        pf_metadata = 0;
+
+        comp_size = 0;
+        last_touch = 0;
     };
 };
 
@@ -69,7 +83,11 @@ class PACKET {
             translated,
             fetched,
             prefetched,
-            drc_tag_read;
+            drc_tag_read,
+            wrong_path, // synthesized wrong-path load, has no LQ/ROB entry
+            clean_victim, // writeback of a clean L2C victim into an exclusive LLC
+            page_walk, // page table entry load of the walker, has no LQ/ROB entry
+            dual_fill; // an L1I and an L1D request merged at the L2C, the fill goes to both
 
     int fill_level, 
         pf_origin_level,
@@ -101,6 +119,9 @@ class PACKET {
 
     uint32_t cpu, data_index, lq_index, sq_index;
 
+    // other cores whose requests for this line merged into this one at the shared LLC
+    uint32_t merged_cpus;
+
     uint64_t address, 
              full_addr, 
              instruction_pa,
@@ -119,6 +140,10 @@ class PACKET {
         fetched = 0;
         prefetched = 0;
         drc_tag_read = 0;
+        wrong_path = 0;
+        clean_victim = 0;
+        page_walk = 0;
+        dual_fill = 0;
 
         returned = 0;
         asid[0] = UINT8_MAX;
@@ -151,6 +176,8 @@ class PACKET {
         lq_index = 0;
         sq_index = 0;
 
+        merged_cpus = 0;
+
         address = 0;
         full_addr = 0;
         instruction_pa = 0;
@@ -194,6 +221,10 @@ class PACKET_QUEUE {
 
     PACKET *entry, processed_packet[2*MAX_READ_PER_CYCLE];
 
+    // a sliced LLC counts its queues' entries per slice, NULL otherwise
+    LLC_INTERCONNECT *interconnect;
+    vector<uint32_t> slice_occupancy;
+
     // constructor
     PACKET_QUEUE(string v1, uint32_t v2) : NAME(v1), SIZE(v2) {
         is_RQ = 0;
@@ -221,6 +252,8 @@ class PACKET_QUEUE {
         ROW_BUFFER_MISS = 0;
         FULL = 0;
 
+        interconnect = NULL;
+
         entry = new PACKET[SIZE]; 
     };
 
@@ -249,6 +282,8 @@ class PACKET_QUEUE {
         ROW_BUFFER_MISS = 0;
         FULL = 0;
 
+        interconnect = NULL;
+
         //entry = new PACKET[SIZE]; 
     };
 
@@ -260,7 +295,8 @@ class PACKET_QUEUE {
     // functions
     int check_queue(PACKET* packet);
     void add_queue(PACKET* packet),
-         remove_queue(PACKET* packet);
+         remove_queue(PACKET* packet),
+         add_slice_occupancy(uint64_t address);
 };
 
 // reorder buffer
@@ -3,6 +3,9 @@
 
 #include "memory_class.h"
 #include "prefetcher.h"
+#include "replacement.h"
+#include "directory.h"
+#include "interconnect.h"
 
 // PAGE
 extern uint32_t PAGE_TABLE_LATENCY, SWAP_LATENCY;
@@ -16,6 +19,11 @@ extern uint32_t PAGE_TABLE_LATENCY, SWAP_LATENCY;
 #define IS_L2C  5
 #define IS_LLC  6
 
+// LLC INCLUSION POLICY (with respect to the private L2Cs)
+#define LLC_NON_INCLUSIVE 0
+#define LLC_INCLUSIVE     1
+#define LLC_EXCLUSIVE     2
+
 // INSTRUCTION TLB
 #define ITLB_SET 16
 #define ITLB_WAY 8
@@ -39,7 +47,7 @@ extern uint32_t PAGE_TABLE_LATENCY, SWAP_LATENCY;
 #define STLB_WAY 12
 #define STLB_RQ_SIZE 32
 #define STLB_WQ_SIZE 32
-#define STLB_PQ_SIZE 0
+#define STLB_PQ_SIZE 8
 #define STLB_MSHR_SIZE 16
 #define STLB_LATENCY 8
 
@@ -88,7 +96,9 @@ class CACHE : public MEMORY {
   public:
     uint32_t cpu;
     const string NAME;
-    const uint32_t NUM_SET, NUM_WAY, NUM_LINE, WQ_SIZE, RQ_SIZE, PQ_SIZE, MSHR_SIZE;
+    const uint32_t NUM_SET;
+    uint32_t NUM_WAY; // a compressed LLC has more tags than its data array holds lines
+    const uint32_t NUM_LINE, WQ_SIZE, RQ_SIZE, PQ_SIZE, MSHR_SIZE;
     uint32_t LATENCY;
     BLOCK **block;
     int fill_level;
@@ -103,7 +113,44 @@ class CACHE : public MEMORY {
              pf_filled,
              pf_useful,
              pf_useless,
-             pf_late;
+             pf_late,
+             pf_drop_refused_shared; // DRAM prefetch drops refused because other cores merged into the prefetch
+
+    // prefetch fills and useful prefetches by issuing prefetcher's confidence
+    uint64_t pf_conf_filled[PF_CONF_LEVELS],
+             pf_conf_useful[PF_CONF_LEVELS];
+
+    // wrong-path loads injected by the core
+    uint64_t wp_access,
+             wp_hit,
+             wp_miss;
+
+    // LLC inclusion policy and its stats
+    uint8_t  inclusion;
+    uint64_t incl_victims,          // evictions that had copies in private caches
+             incl_back_inval,       // private cache lines removed by back-invalidation
+             incl_back_inval_dirty, // ... that were dirty
+             incl_back_inval_pf,    // ... on an eviction for a prefetch fill
+             incl_back_inval_unused_pf, // ... that were unused prefetches in the L2C
+             excl_bypass_fill,      // fills handed to the L2C without allocating
+             excl_hit_move,         // hits whose line moved up to the L2C
+             excl_victim_fill;      // clean L2C victims filled in
+
+    // compressed LLC: the lines of a set share a data budget of comp_set_segments segments
+    uint32_t comp_set_segments;
+    uint64_t comp_clock,
+             comp_fills,            // lines filled ...
+             comp_fill_segments,    // ... and the segments they took
+             comp_evictions,        // extra lines evicted to make room for a fill
+             comp_evictions_dirty,  // ... that had to be written back
+             comp_evictions_pf,     // ... on a prefetch fill
+             comp_evictions_unused_pf; // ... that were unused prefetches
+
+    // coherence directory the LLC and the L1Ds report to, NULL without knob::coherence_directory
+    COHERENCE_DIRECTORY *directory;
+
+    // ring or mesh between the L2Cs and a sliced LLC, set on both; NULL unless knob::llc_slices > 1
+    LLC_INTERCONNECT *interconnect;
 
     /* for computing memory subsystem bw */
     uint32_t bw_compute_epoch;
@@ -126,7 +173,13 @@ class CACHE : public MEMORY {
 
     /* Array of prefetchers associated with this cache */
     vector<Prefetcher*> prefetchers;
+    vector<Prefetcher*> l1i_prefetchers;
     vector<Prefetcher*> l1d_prefetchers;
+    vector<Prefetcher*> llc_prefetchers;
+    vector<Prefetcher*> stlb_prefetchers;
+
+    /* LLC replacement policy, NULL means LRU */
+    Replacement *llc_replacement_policy;
 
     /* For semi-perfect cache */
     deque<uint64_t> page_buffer;
@@ -182,6 +235,34 @@ class CACHE : public MEMORY {
         pf_useful = 0;
         pf_useless = 0;
         pf_late = 0;
+        pf_drop_refused_shared = 0;
+        for (uint32_t i=0; i<PF_CONF_LEVELS; i++) {
+            pf_conf_filled[i] = 0;
+            pf_conf_useful[i] = 0;
+        }
+
+        wp_access = 0;
+        wp_hit = 0;
+        wp_miss = 0;
+
+        inclusion = LLC_NON_INCLUSIVE;
+        incl_victims = 0;
+        incl_back_inval = 0;
+        incl_back_inval_dirty = 0;
+        incl_back_inval_pf = 0;
+        incl_back_inval_unused_pf = 0;
+        excl_bypass_fill = 0;
+        excl_hit_move = 0;
+        excl_victim_fill = 0;
+
+        comp_set_segments = 0;
+        comp_clock = 0;
+        comp_fills = 0;
+        comp_fill_segments = 0;
+        comp_evictions = 0;
+        comp_evictions_dirty = 0;
+        comp_evictions_pf = 0;
+        comp_evictions_unused_pf = 0;
 
         cycle = 0; next_measure_cycle = 0;
         pf_useful_epoch = 0; pf_filled_epoch = 0;
@@ -189,6 +270,11 @@ class CACHE : public MEMORY {
         total_acc_epochs = 0;
 
         bw_compute_epoch = 0;
+
+        llc_replacement_policy = NULL;
+
+        directory = NULL;
+        interconnect = NULL;
     };
 
     // destructor
@@ -205,16 +291,26 @@ class CACHE : public MEMORY {
 
     void return_data(PACKET *packet),
          operate(),
-         increment_WQ_FULL(uint64_t address);
+         increment_WQ_FULL(uint64_t address),
+         promote_prefetch(uint64_t address);
+
+    int  drop_prefetch(PACKET *packet);
 
     uint32_t get_occupancy(uint8_t queue_type, uint64_t address),
              get_size(uint8_t queue_type, uint64_t address);
 
+    bool upper_level_dirty(uint64_t address),
+         exclusive_llc(),
+         make_compressed_room(uint32_t set, uint32_t way, PACKET *packet),
+         merge_other_cpu(PACKET *into, PACKET *packet),
+         mshr_full(uint64_t address);
+
     int  check_hit(PACKET *packet),
          invalidate_entry(uint64_t inval_addr),
          check_mshr(PACKET *packet),
          prefetch_line(uint64_t ip, uint64_t base_addr, uint64_t pf_addr, int prefetch_fill_level, uint32_t prefetch_metadata),
-         kpc_prefetch_line(uint64_t base_addr, uint64_t pf_addr, int prefetch_fill_level, int delta, int depth, int signature, int confidence, uint32_t prefetch_metadata);
+         kpc_prefetch_line(uint64_t base_addr, uint64_t pf_addr, int prefetch_fill_level, int delta, int depth, int signature, int confidence, uint32_t prefetch_metadata),
+         prefetch_translation(uint64_t ip, uint64_t pf_vpage);
 
     void handle_fill(),
          handle_writeback(),
@@ -224,32 +320,56 @@ class CACHE : public MEMORY {
     void add_mshr(PACKET *packet),
          update_fill_cycle(),
          llc_initialize_replacement(uint64_t rand_seed),
-         update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit),
-         llc_update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit),
+         llc_initialize_inclusion(),
+         llc_inclusion_final_stats(),
+         llc_initialize_compression(),
+         llc_compression_final_stats(),
+         llc_initialize_slices(LLC_INTERCONNECT *slices),
+         back_invalidate(uint64_t address, uint32_t type),
+         shared_llc_return(PACKET *packet),
+         merge_dual_fill(PACKET *into, PACKET *packet),
+         return_dual_fill(PACKET *packet),
+         update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit, uint32_t metadata),
+         llc_update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit, uint32_t metadata),
          lru_update(uint32_t set, uint32_t way),
+         lru_insert(uint32_t set, uint32_t way, uint32_t position),
          fill_cache(uint32_t set, uint32_t way, PACKET *packet),
          replacement_final_stats(),
          llc_replacement_final_stats(),
          //prefetcher_initialize(),
+         l1i_prefetcher_initialize(),
          l1d_prefetcher_initialize(),
          l2c_prefetcher_initialize(),
          llc_prefetcher_initialize(),
+         stlb_prefetcher_initialize(),
+         l1i_prefetcher_print_config(),
          l1d_prefetcher_print_config(),
          l2c_prefetcher_print_config(),
          llc_prefetcher_print_config(),
+         stlb_prefetcher_print_config(),
          prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type),
+         l1i_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type),
+         l1i_prefetcher_fetch_target(uint64_t ip, uint64_t pa),
          l1d_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type),
+         stlb_prefetcher_operate(uint64_t vpage, uint64_t ip, uint8_t cache_hit, uint8_t type),
          prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr),
+         l1i_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in),
          l1d_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in),
          //prefetcher_final_stats(),
+         l1i_prefetcher_final_stats(),
          l1d_prefetcher_final_stats(),
          l2c_prefetcher_final_stats(),
-         llc_prefetcher_final_stats();
+         llc_prefetcher_final_stats(),
+         stlb_prefetcher_final_stats();
 
     uint32_t l1d_prefetcher_prefetch_hit(uint64_t addr, uint64_t ip, uint32_t metadata_in),
             l2c_prefetcher_prefetch_hit(uint64_t addr, uint64_t ip, uint32_t metadata_in),
             llc_prefetcher_prefetch_hit(uint64_t addr, uint64_t ip, uint32_t metadata_in);
 
+    void l1d_prefetcher_prefetch_drop(uint64_t addr, uint32_t metadata_in),
+         l2c_prefetcher_prefetch_drop(uint64_t addr, uint32_t metadata_in),
+         llc_prefetcher_prefetch_drop(uint64_t addr, uint32_t metadata_in);
+
     uint32_t l2c_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in),
          llc_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in),
          l2c_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in),
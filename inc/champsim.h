@@ -38,6 +38,7 @@
 #define DRAM_IO_FREQ 2400 // DDR4-2400
 #define PAGE_SIZE 4096
 #define LOG2_PAGE_SIZE 12
+#define LOG2_HUGE_PAGE_SIZE 21 // 2MB frames backing whole virtual regions (knob::huge_page_fraction)
 
 // CACHE
 #define BLOCK_SIZE 64
@@ -96,6 +97,13 @@ void print_stats();
 uint64_t rotl64 (uint64_t n, unsigned int c),
          rotr64 (uint64_t n, unsigned int c),
          va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_vpage);
+bool     lookup_va_to_pa(uint32_t cpu, uint64_t va, uint64_t &pa),
+         lookup_vpage_to_pa(uint32_t cpu, uint64_t unique_vpage, uint64_t va, uint64_t &pa),
+         lookup_pa_to_va(uint64_t pa, uint64_t &va),
+         huge_page_mapped(uint32_t cpu, uint64_t unique_vpage),
+         stlb_huge_lookup(uint32_t cpu, uint64_t unique_vpage, uint64_t va, uint64_t &pa);
+uint32_t lookup_page_shift(uint64_t pa);
+int      request_translation(uint32_t cpu, uint64_t va);
 
 // log base 2 function from efectiu
 int lg2(int n);
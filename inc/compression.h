@@ -0,0 +1,21 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include "champsim.h"
+
+// compressed lines are stored and moved in 8B segments, BLOCK_SIZE/8 of them for an uncompressed line
+#define COMPRESSION_SEGMENT_SIZE 8
+#define COMPRESSION_SEGMENTS (BLOCK_SIZE / COMPRESSION_SEGMENT_SIZE)
+
+// the DRAM data bus moves a compressed line in 32B half bursts (a burst-chop)
+#define COMPRESSION_DRAM_BURST_SEGMENTS 4
+
+// Trace records carry no data values, so line sizes come from a synthetic model: each line
+// address is hashed onto knob::compression_size_dist, the share of lines that compress to
+// 1..COMPRESSION_SEGMENTS segments. The default follows the size classes of Base-Delta-Immediate
+// compression (zero and repeated lines, base8-delta1, base4-delta1 and base8-delta2, the
+// 2B/4B-delta encodings, and incompressible lines).
+void     initialize_compression();
+uint32_t compressed_segments(uint64_t block_address);
+
+#endif
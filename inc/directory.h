@@ -0,0 +1,56 @@
+#ifndef DIRECTORY_H
+#define DIRECTORY_H
+
+#include <set>
+#include <unordered_map>
+#include "champsim.h"
+
+class CACHE;
+
+// Sharers of one line. A line with an owner is Exclusive or Modified in that core (Modified if
+// its copy is dirty), a line with several sharers and no owner is Shared, others are Invalid
+class DIRECTORY_ENTRY {
+  public:
+    uint32_t sharers; // one bit per core that may hold a copy
+    int32_t  owner;   // the core allowed to write without asking, -1 if none
+
+    DIRECTORY_ENTRY() {
+        sharers = 0;
+        owner = -1;
+    };
+};
+
+// MESI directory at the LLC (knob::coherence_directory), full-map and unbounded. It sees a core
+// read a line when the LLC hands it up, and write one on an RFO or when its L1D takes a store to
+// a line it already holds (an upgrade, which takes no time here). A write invalidates the copies
+// in every other core's L1I, L1D and L2C; a read from another core downgrades the owner to Shared
+// and cleans its dirty copies. Writebacks from an L2C drop that core's sharer bit, silent clean
+// evictions leave it set, so sharers may hold stale cores.
+class COHERENCE_DIRECTORY {
+  public:
+    CACHE *L1I[NUM_CPUS], *L1D[NUM_CPUS], *L2C[NUM_CPUS], *LLC;
+
+    unordered_map<uint64_t, DIRECTORY_ENTRY> entries;
+
+    // lines coherence took from each core, to tell coherence misses when it asks for them again
+    set<uint64_t> invalidated[NUM_CPUS];
+
+    // stats
+    uint64_t reads, writes, upgrades, invalidations, invalidations_dirty, downgrades, downgrades_dirty;
+    uint64_t coherence_misses[NUM_CPUS], lines_invalidated[NUM_CPUS];
+
+    COHERENCE_DIRECTORY();
+
+    void read(uint32_t cpu, uint64_t address),
+         write(uint32_t cpu, uint64_t address),
+         upgrade(uint32_t cpu, uint64_t address),
+         take_ownership(uint32_t cpu, uint64_t address),
+         writeback(uint32_t cpu, uint64_t address),
+         reset_stats(),
+         final_stats();
+
+    uint8_t  remove_copies(uint32_t cpu, uint64_t address, uint8_t invalidate);
+    void     check_coherence_miss(uint32_t cpu, uint64_t address);
+};
+
+#endif
@@ -21,7 +21,94 @@ extern uint32_t DRAM_MTPS, DRAM_DBUS_RETURN_TIME, DRAM_DBUS_MAX_CAS;
 #define DRAM_WRITE_LOW_WM     ((DRAM_WQ_SIZE*3)>>2) // 6/8th
 #define MIN_DRAM_WRITES_PER_SWITCH (DRAM_WQ_SIZE*1/4)
 
+// detailed timing mode (knob::dram_detailed_timing), all values in CPU cycles
+// a DDR5 channel is split into two independent sub-channels, each owning half of the banks and its own data bus
+#define DRAM_MAX_SUB_CHANNELS 2
+#define DRAM_ACT_WINDOW 4 // tFAW limits a rank to four activates per window
+extern uint32_t tRRD_S, tRRD_L, tFAW, tCCD_S, tCCD_L, tREFI, tRFC,
+                DRAM_BANK_GROUPS, DRAM_SUB_CHANNELS;
+
+// multi-controller NUMA mode (knob::dram_controllers > 1): each controller is one node and owns
+// a contiguous DRAM_PAGES slice of physical memory, repeating every num_nodes slices.
+// Within a controller, consecutive DRAM_INTERLEAVE_SHIFT-sized chunks of blocks alternate between channels.
+#define DRAM_MAX_CONTROLLERS 8
+extern uint32_t DRAM_INTERLEAVE_SHIFT, DRAM_NODE_SHIFT, NUMA_REMOTE_LATENCY;
+
+// read latency histograms, bucket i counts latencies in [2^i, 2^(i+1)) cycles
+#define DRAM_LATENCY_BUCKETS 16
+
 void print_dram_config();
+void dram_initialize_timing();
+
+// telemetry pull API, cheap enough for a prefetcher to call on every access.
+// Each reports the channel that the (byte) address maps to.
+float   dram_utilization(uint64_t address);     // data bus utilization, 0..1
+float   dram_queueing_delay(uint64_t address);  // cycles a read waits in the RQ before it is scheduled
+float   dram_row_hit_rate(uint64_t address);    // fraction of scheduled requests that hit the open row
+uint8_t dram_bw_level(uint64_t address);        // utilization quantized to DRAM_BW_LEVELS
+
+// exponentially weighted moving averages kept per channel, in fixed point
+#define DRAM_TELEMETRY_FRAC_BITS 16
+class DRAM_TELEMETRY {
+  public:
+    int64_t utilization,    // per cycle
+            queueing_delay, // per scheduled read, in cycles
+            row_hit_rate;   // per scheduled request
+    uint64_t busy_cycles, cycles;
+
+    DRAM_TELEMETRY() {
+        utilization = 0;
+        queueing_delay = 0;
+        row_hit_rate = 0;
+        busy_cycles = 0;
+        cycles = 0;
+    };
+};
+
+// the activate (on a row miss) and column command a scheduled request reserved in its rank's windows
+class DRAM_RESERVATION {
+  public:
+    uint32_t bank, group;
+    uint8_t  activate, column;
+    uint64_t act_cycle, cas_cycle;
+
+    DRAM_RESERVATION() {
+        bank = 0;
+        group = 0;
+        activate = 0;
+        column = 0;
+        act_cycle = 0;
+        cas_cycle = 0;
+    };
+};
+
+// activate and column command windows of one rank (or one DDR5 sub-channel of a rank), and the
+// reservations that still constrain later commands, oldest first, so that those of requests
+// un-scheduled before their commands issued can be taken back
+class DRAM_TIMING_STATE {
+  public:
+    uint64_t next_act, next_cas,
+             next_act_bg[DRAM_BANKS], next_cas_bg[DRAM_BANKS],
+             act_window[DRAM_ACT_WINDOW];
+    uint32_t act_window_head;
+    deque<DRAM_RESERVATION> reserved;
+
+    DRAM_TIMING_STATE() {
+        reset_windows();
+    };
+
+    void reset_windows() {
+        next_act = 0;
+        next_cas = 0;
+        for (uint32_t i=0; i<DRAM_BANKS; i++) {
+            next_act_bg[i] = 0;
+            next_cas_bg[i] = 0;
+        }
+        for (uint32_t i=0; i<DRAM_ACT_WINDOW; i++)
+            act_window[i] = 0;
+        act_window_head = 0;
+    };
+};
 
 // DRAM
 class MEMORY_CONTROLLER : public MEMORY {
@@ -37,6 +124,26 @@ class MEMORY_CONTROLLER : public MEMORY {
 
     BANK_REQUEST bank_request[DRAM_CHANNELS][DRAM_RANKS][DRAM_BANKS];
 
+    // detailed timing state
+    DRAM_TIMING_STATE timing[DRAM_CHANNELS][DRAM_RANKS][DRAM_MAX_SUB_CHANNELS];
+    uint64_t sub_dbus_cycle_available[DRAM_CHANNELS][DRAM_MAX_SUB_CHANNELS];
+    // controller cycles of each channel, one per operate(), in the same CPU-cycle units as the DRAM timings
+    uint64_t channel_cycle[DRAM_CHANNELS];
+    uint64_t next_refresh[DRAM_CHANNELS][DRAM_RANKS], refresh_until[DRAM_CHANNELS][DRAM_RANKS];
+    uint8_t  refresh_pending[DRAM_CHANNELS][DRAM_RANKS];
+    uint64_t refreshes[DRAM_CHANNELS], refresh_cycles[DRAM_CHANNELS],
+             act_delayed_rrd[DRAM_CHANNELS], act_delayed_faw[DRAM_CHANNELS], cas_delayed_ccd[DRAM_CHANNELS];
+
+    DRAM_TELEMETRY telemetry[DRAM_CHANNELS];
+
+    // data bus cycles compressed transfers did not need (knob::dram_compression)
+    uint64_t dbus_cycles_saved[DRAM_CHANNELS];
+
+    // prefetch-aware scheduling
+    uint64_t pf_dropped, pf_drop_refused, pf_promoted;
+    uint64_t demand_latency_hist[DRAM_LATENCY_BUCKETS], prefetch_latency_hist[DRAM_LATENCY_BUCKETS],
+             demand_latency_total, prefetch_latency_total, demand_returned, prefetch_returned;
+
     // queues
     PACKET_QUEUE WQ[DRAM_CHANNELS], RQ[DRAM_CHANNELS];
     
@@ -60,6 +167,7 @@ class MEMORY_CONTROLLER : public MEMORY {
         for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
             dbus_cycle_available[i] = 0;
             dbus_cycle_congested[i] = 0;
+            dbus_cycles_saved[i] = 0;
             write_mode[i] = 0;
             scheduled_reads[i] = 0;
             scheduled_writes[i] = 0;
@@ -67,7 +175,18 @@ class MEMORY_CONTROLLER : public MEMORY {
             for (uint32_t j=0; j<DRAM_RANKS; j++) {
                 for (uint32_t k=0; k<DRAM_BANKS; k++)
                     bank_cycle_available[i][j][k] = 0;
+                next_refresh[i][j] = 0;
+                refresh_until[i][j] = 0;
+                refresh_pending[i][j] = 0;
             }
+            for (uint32_t j=0; j<DRAM_MAX_SUB_CHANNELS; j++)
+                sub_dbus_cycle_available[i][j] = 0;
+            channel_cycle[i] = 0;
+            refreshes[i] = 0;
+            refresh_cycles[i] = 0;
+            act_delayed_rrd[i] = 0;
+            act_delayed_faw[i] = 0;
+            cas_delayed_ccd[i] = 0;
 
             WQ[i].NAME = "DRAM_WQ" + to_string(i);
             WQ[i].SIZE = DRAM_WQ_SIZE;
@@ -80,6 +199,18 @@ class MEMORY_CONTROLLER : public MEMORY {
 
         fill_level = FILL_DRAM;
 
+        pf_dropped = 0;
+        pf_drop_refused = 0;
+        pf_promoted = 0;
+        for (uint32_t i=0; i<DRAM_LATENCY_BUCKETS; i++) {
+            demand_latency_hist[i] = 0;
+            prefetch_latency_hist[i] = 0;
+        }
+        demand_latency_total = 0;
+        prefetch_latency_total = 0;
+        demand_returned = 0;
+        prefetch_returned = 0;
+
         rq_enqueue_count = 0;
         last_enqueue_count = 0;
         epoch_enqueue_count = 0;
@@ -99,7 +230,8 @@ class MEMORY_CONTROLLER : public MEMORY {
 
     void return_data(PACKET *packet),
          operate(),
-         increment_WQ_FULL(uint64_t address);
+         increment_WQ_FULL(uint64_t address),
+         promote_prefetch(uint64_t address);
 
     uint32_t get_occupancy(uint8_t queue_type, uint64_t address),
              get_size(uint8_t queue_type, uint64_t address);
@@ -109,6 +241,24 @@ class MEMORY_CONTROLLER : public MEMORY {
          update_process_cycle(PACKET_QUEUE *queue),
          reset_remain_requests(PACKET_QUEUE *queue, uint32_t channel);
 
+    // detailed timing mode
+    void     operate_refresh(uint32_t channel);
+    uint64_t detailed_latency(uint32_t channel, uint32_t rank, uint32_t bank, uint8_t row_buffer_hit, uint64_t cycle);
+    void     apply_reservation(DRAM_TIMING_STATE *state, DRAM_RESERVATION *reservation),
+             cancel_reservation(uint32_t channel, uint32_t rank, uint32_t bank, uint64_t cycle);
+    uint32_t dram_get_sub_channel(uint32_t bank),
+             dram_get_bank_group(uint32_t bank);
+    uint64_t &dbus_available(uint32_t channel, uint32_t bank);
+
+    void    update_telemetry(uint32_t channel),
+            record_schedule(uint32_t channel, PACKET *packet, uint8_t is_read, uint8_t row_buffer_hit);
+
+    // prefetch-aware scheduling
+    uint8_t is_critical(PACKET *packet);
+    void    drop_stale_prefetch(uint32_t channel),
+            record_latency(PACKET *packet);
+
+    uint64_t dram_strip_channel(uint64_t address);
     uint32_t dram_get_channel(uint64_t address),
              dram_get_rank   (uint64_t address),
              dram_get_bank   (uint64_t address),
@@ -121,4 +271,55 @@ class MEMORY_CONTROLLER : public MEMORY {
     int check_dram_queue(PACKET_QUEUE *queue, PACKET *packet);
 };
 
+// Sits between the LLC and the controllers in NUMA mode and routes every request to the
+// controller of the node that owns its address. Responses to a core on another node cross
+// the socket interconnect and reach the LLC NUMA_REMOTE_LATENCY cycles later.
+class NUMA_INTERCONNECT : public MEMORY {
+  public:
+    const string NAME;
+
+    MEMORY_CONTROLLER *node[DRAM_MAX_CONTROLLERS];
+    uint32_t num_nodes;
+
+    // remote responses and the cycle they reach the LLC, in arrival order
+    queue <pair<uint64_t, PACKET> > in_flight;
+
+    uint64_t local_reads[DRAM_MAX_CONTROLLERS], remote_reads[DRAM_MAX_CONTROLLERS], writes[DRAM_MAX_CONTROLLERS];
+
+    // constructor
+    NUMA_INTERCONNECT(string v1) : NAME (v1) {
+        for (uint32_t i=0; i<DRAM_MAX_CONTROLLERS; i++) {
+            node[i] = NULL;
+            local_reads[i] = 0;
+            remote_reads[i] = 0;
+            writes[i] = 0;
+        }
+        num_nodes = 1;
+    };
+
+    // destructor
+    ~NUMA_INTERCONNECT() {
+
+    };
+
+    // functions
+    int  add_rq(PACKET *packet),
+         add_wq(PACKET *packet),
+         add_pq(PACKET *packet),
+         drop_prefetch(PACKET *packet);
+
+    void return_data(PACKET *packet),
+         operate(),
+         increment_WQ_FULL(uint64_t address),
+         promote_prefetch(uint64_t address);
+
+    uint32_t get_occupancy(uint8_t queue_type, uint64_t address),
+             get_size(uint8_t queue_type, uint64_t address);
+
+    void     initialize();
+    uint32_t get_node(uint64_t address),
+             home_node(uint32_t cpu);
+    uint64_t rq_enqueue_count();
+};
+
 #endif
@@ -0,0 +1,38 @@
+#ifndef DRRIP_H
+#define DRRIP_H
+
+#include "srrip.h"
+
+#define DRRIP_SDM_SIZE 32
+#define DRRIP_PSEL_WIDTH 10
+#define BIP_MAX 32
+
+/* leader policies of the DRRIP duel */
+#define DRRIP_BIP 0
+#define DRRIP_SRRIP 1
+
+class DRRIP : public SRRIP
+{
+protected:
+	RandomSetPicker picker;
+	SetDuelingMonitor sdm;
+	uint32_t bip_counter;
+
+	struct
+	{
+		uint64_t insert_bip;
+		uint64_t insert_srrip;
+	} drrip_stats;
+
+protected:
+	uint8_t insertion_rrpv(uint32_t cpu, uint32_t set);
+
+public:
+	DRRIP(std::string type, uint32_t sets, uint32_t ways, uint32_t num_cpus);
+	~DRRIP(){}
+	void update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit, uint32_t metadata);
+	void dump_stats();
+	void print_config();
+};
+
+#endif /* DRRIP_H */
@@ -0,0 +1,54 @@
+#ifndef FDIP_H
+#define FDIP_H
+
+#include <deque>
+#include "prefetcher.h"
+using namespace std;
+
+/* Fetch-directed instruction prefetcher (Reinman et al., MICRO'99)
+ * The decoupled front end hands over every fetch block it enqueues into the FTQ,
+ * and the prefetcher brings the block's line into L1I ahead of the fetch unit. */
+class FDIP : public Prefetcher
+{
+private:
+	deque<uint64_t> recent_lines; /* lines prefetched recently, filters out loop bodies */
+
+	struct
+	{
+		struct
+		{
+			uint64_t called;
+			uint64_t filtered;
+			uint64_t issue;
+		} fetch_target;
+
+		struct
+		{
+			uint64_t called;
+			uint64_t fill;
+		} register_fill;
+
+		struct
+		{
+			uint64_t called;
+			uint64_t covered;
+			uint64_t covered_hit;
+		} demand;
+	} stats;
+
+private:
+	void init_knobs();
+	void init_stats();
+	bool search_recent(uint64_t line);
+
+public:
+	FDIP(string type);
+	~FDIP();
+	void invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr);
+	void enqueue_fetch_target(uint64_t ip, uint64_t pa, vector<uint64_t> &pref_addr);
+	void register_fill(uint64_t address);
+	void dump_stats();
+	void print_config();
+};
+
+#endif /* FDIP_H */
@@ -2,6 +2,7 @@
 #define FEATURE_KNOWLEDGE
 
 #include <string>
+#include <vector>
 #include "scooby_helper.h"
 #define FK_MAX_TILINGS 32
 
@@ -31,6 +32,11 @@ typedef enum
 	NumFeatureTypes
 } FeatureType;
 
+class FeatureKnowledge;
+
+/* computes a state's tile index in every tiling of a feature table */
+typedef void (*TileKernel)(FeatureKnowledge *knowledge, State *state, uint32_t *tile_index);
+
 class FeatureKnowledge
 {
 private:
@@ -46,6 +52,11 @@ private:
 	float ***m_qtable;
 	bool m_enable_tiling_offset;
 
+	/* resolved once from the feature and hash type: a specialized kernel
+	 * for the configurations in the kernel table, the generic path otherwise */
+	TileKernel m_tile_kernel;
+	bool m_specialized_kernel;
+
 	float min_weight, max_weight;
 
 	/* q-value tracing related variables */
@@ -60,6 +71,11 @@ private:
 	uint32_t get_tile_index(uint32_t tiling, State *state);
 	string get_feature_string(State *state);
 
+	/* tile index kernels */
+	static void generic_tile_kernel(FeatureKnowledge *knowledge, State *state, uint32_t *tile_index);
+	template <FeatureType F, uint32_t H> static void tile_kernel(FeatureKnowledge *knowledge, State *state, uint32_t *tile_index);
+	void resolve_tile_kernel();
+
 	/* feature index generators */
 	uint32_t process_PC(uint32_t tiling, uint64_t pc);
 	uint32_t process_offset(uint32_t tiling, uint32_t offset);
@@ -90,16 +106,25 @@ public:
 	FeatureKnowledge(FeatureType feature_type, float alpha, float gamma, uint32_t actions, float weight, float weight_gradient, uint32_t num_tilings, uint32_t num_tiles, bool zero_init, uint32_t hash_type, int32_t enable_tiling_offset);
 	~FeatureKnowledge();
 	float retrieveQ(State *state, uint32_t action_index);
+	float retrieveQ(uint32_t *tile_index, uint32_t action_index);
 	void updateQ(State *state1, uint32_t action1, int32_t reward, State *state2, uint32_t action2);
 	static string getFeatureString(FeatureType type);
 	uint32_t getMaxAction(State *state); /* Called by featurewise engine only to get a consensus from all the features */
 
+	/* a state's tile indices, computed once and then used for every action */
+	inline void get_tile_indices(State *state, uint32_t *tile_index) {m_tile_kernel(this, state, tile_index);}
+	inline bool has_specialized_kernel() {return m_specialized_kernel;}
+
 	/* weight manipulation */
 	inline void increase_weight() {m_weight = m_weight + m_weight_gradient * m_weight; if(m_weight < min_weight) min_weight = m_weight;}
 	inline void decrease_weight() {m_weight = m_weight - m_weight_gradient * m_weight; if(m_weight > max_weight) max_weight = m_weight;}
 	inline float get_weight() {return m_weight;}
 	inline float get_min_weight() {return min_weight;}
 	inline float get_max_weight() {return max_weight;}
+
+	/* knowledge sharing across cores */
+	inline uint64_t get_qtable_bytes() {return (uint64_t)m_num_tilings * m_num_tiles * m_actions * sizeof(float);}
+	static float average(std::vector<FeatureKnowledge*> &knowledges);
 };
 
 #endif /* FEATURE_KNOWLEDGE */
@@ -208,5 +208,33 @@ uint32_t FeatureKnowledge::process_Delta_Path_PC(uint32_t tiling, uint32_t delta
 }
 
 
+/* Compile-time pieces of the specialized tile kernels. A feature's raw index does not depend
+ * on the tiling, so a kernel computes it once and only XORs in each tiling's offset; these
+ * must stay in step with the process_* functions above, which the generic path uses. */
+template <FeatureType F> inline uint32_t feature_raw_index(State *state);
+
+template <> inline uint32_t feature_raw_index<F_PC>(State *state)
+{
+	return folded_xor(state->pc, 2);
+}
+
+template <> inline uint32_t feature_raw_index<F_PC_Delta>(State *state)
+{
+	int32_t delta = state->delta;
+	uint32_t unsigned_delta = (delta < 0) ? (((-1) * delta) + (1 << (DELTA_BITS - 1))) : delta;
+	uint64_t tmp = state->pc;
+	tmp = tmp << 7;
+	tmp += unsigned_delta;
+	return folded_xor(tmp, 2);
+}
+
+template <uint32_t H> inline uint32_t feature_hash(uint32_t key);
+
+template <> inline uint32_t feature_hash<2>(uint32_t key)
+{
+	return HashZoo::jenkins(key);
+}
+
+
 #endif /* FEATURE_KNOWLEDGE_HELPER_H */
 
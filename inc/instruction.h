@@ -10,8 +10,18 @@
 #define NUM_INSTR_DESTINATIONS 2
 #define NUM_INSTR_SOURCES 4
 
+#include <vector>
 #include "set.h"
 
+// a consumer waiting on one of its source registers
+class reg_consumer {
+  public:
+    uint32_t rob_index;
+    uint32_t source_index;
+
+    reg_consumer(uint32_t rob_index, uint32_t source_index) : rob_index(rob_index), source_index(source_index) {}
+};
+
 class input_instr {
   public:
 
@@ -125,8 +135,8 @@ class ooo_model_instr {
     //int64_t registers_instrs_i_depend_on[NUM_INSTR_SOURCES];
     // these are indices of instructions in the window that depend on me
     //uint8_t registers_instrs_depend_on_me[ROB_SIZE], registers_index_depend_on_me[ROB_SIZE][NUM_INSTR_SOURCES];
-    fastset
-	registers_instrs_depend_on_me, registers_index_depend_on_me[NUM_INSTR_SOURCES];
+    // wake-up list, one element per (consumer, source register) pair
+    std::vector<reg_consumer> registers_consumers;
 
 
     // memory addresses that may cause dependencies between instructions
@@ -150,6 +160,11 @@ class ooo_model_instr {
              sq_index[NUM_INSTR_DESTINATIONS_SPARC],
              forwarding_index[NUM_INSTR_DESTINATIONS_SPARC];
 
+    // next older in-flight store in the same store index bucket, per destination
+    // encoded as rob_index*NUM_INSTR_DESTINATIONS_SPARC + data_index, UINT32_MAX if none
+    uint32_t store_chain[NUM_INSTR_DESTINATIONS_SPARC];
+    uint64_t store_chain_id[NUM_INSTR_DESTINATIONS_SPARC];
+
     ooo_model_instr() {
         instr_id = 0;
         ip = 0;
@@ -203,6 +218,8 @@ class ooo_model_instr {
             destination_added[i] = 0;
             sq_index[i] = UINT32_MAX;
             forwarding_index[i] = 0;
+            store_chain[i] = UINT32_MAX;
+            store_chain_id[i] = 0;
         }
 
 #if 0
@@ -0,0 +1,39 @@
+#ifndef INTERCONNECT_H
+#define INTERCONNECT_H
+
+#include <vector>
+#include "champsim.h"
+
+// Sliced LLC (knob::llc_slices > 1). Each line lives in the slice its address hashes to, and
+// each slice gets an even share of the LLC's RQ, WQ, PQ and MSHRs. Cores and slices sit on the
+// stops of a bidirectional ring or a mesh with XY routing: a request from a core's L2C and the
+// line sent back to it each cross knob::llc_hop_latency cycles per hop, and every link carries
+// knob::llc_link_bandwidth messages per cycle, later ones wait for the next cycle.
+class LLC_INTERCONNECT {
+  public:
+    uint32_t num_slices, num_stops, mesh_width;
+    uint8_t  xor_hash, mesh;
+
+    // cycle each directed link is next used in and how many messages it carries then
+    vector<uint64_t> link_cycle;
+    vector<uint32_t> link_used;
+
+    // stats
+    vector<uint64_t> slice_requests, slice_misses;
+    uint64_t messages, hops, transit_cycles, link_wait_cycles;
+
+    LLC_INTERCONNECT();
+
+    void     initialize(),
+             reset_stats(),
+             final_stats();
+    uint32_t get_slice(uint64_t address),
+             core_stop(uint32_t cpu),
+             slice_stop(uint32_t slice),
+             next_link(uint32_t from, uint32_t to, uint32_t &next);
+    uint64_t traverse(uint32_t from, uint32_t to, uint64_t cycle),
+             to_slice(uint32_t cpu, uint64_t address, uint64_t cycle),
+             to_core(uint64_t address, uint32_t cpu, uint64_t cycle);
+};
+
+#endif
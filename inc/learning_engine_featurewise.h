@@ -5,12 +5,28 @@
 #include "learning_engine_base.h"
 #include "feature_knowledge.h"
 
+typedef enum
+{
+	KS_Private = 0,	/* every core learns its own tables */
+	KS_Shared,		/* all cores at a cache level update one set of tables */
+	KS_Federated,	/* private tables, averaged across cores every epoch */
+
+	NumKnowledgeSharingTypes
+} KnowledgeSharingType;
+
+/* engines of all cores attached to the same cache level */
+struct KnowledgeGroup;
+
 class LearningEngineFeaturewise : public LearningEngineBase
 {
 private:
 	FeatureKnowledge* m_feature_knowledges[NumFeatureTypes];
 	float m_max_q_value;
 
+	/* knowledge sharing across cores */
+	KnowledgeGroup *m_group;
+	bool m_owns_knowledge;
+
 	std::default_random_engine m_generator;
 	std::bernoulli_distribution *m_explore;
 	std::uniform_int_distribution<int> *m_actiongen;
@@ -56,12 +72,13 @@ private:
 	void init_knobs();
 	void init_stats();
 	uint32_t getMaxAction(State *state, float &max_q, float &max_to_avg_q_ratio, vector<bool> &consensus_vec);
-	float consultQ(State *state, uint32_t action);
+	float consultQ(uint32_t tile_index[][FK_MAX_TILINGS], uint32_t action);
 	void gather_stats(float max_q, float max_to_avg_q_ratio);
 	void action_selection_consensus(State *state, uint32_t selected_action, vector<bool> &consensus_vec);
 	void adjust_feature_weights(vector<bool> consensus_vec, RewardType reward_type);
 	bool do_fallback(State *state);
 	void plot_scores();
+	void merge_knowledge();
 
 public:
 	LearningEngineFeaturewise(Prefetcher *p, float alpha, float gamma, float epsilon, uint32_t actions, uint64_t seed, std::string policy, std::string type, bool zero_init);
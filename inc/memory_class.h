@@ -36,6 +36,11 @@ class MEMORY {
     virtual void increment_WQ_FULL(uint64_t address) = 0;
     virtual uint32_t get_occupancy(uint8_t queue_type, uint64_t address) = 0;
     virtual uint32_t get_size(uint8_t queue_type, uint64_t address) = 0;
+
+    // the memory controller asks the levels above whether an in-flight prefetch may be dropped,
+    // and is told when a demand merges into one so that it can stop treating it as a prefetch
+    virtual int  drop_prefetch(PACKET *packet) { return 0; }
+    virtual void promote_prefetch(uint64_t address) {}
     void broadcast_bw(uint8_t bw_level){}
 
     // stats
@@ -1,7 +1,10 @@
 #ifndef OOO_CPU_H
 #define OOO_CPU_H
 
+#include <queue>
+#include <deque>
 #include "cache.h"
+#include "ptw.h"
 #include "instruction.h"
 
 #ifdef CRC2_COMPILE
@@ -26,11 +29,44 @@ using namespace std;
 //#define EXEC_LATENCY 1
 
 #define STA_SIZE (ROB_SIZE*NUM_INSTR_DESTINATIONS_SPARC)
+#define NUM_ARCH_REGS 256
+#define STORE_INDEX_SIZE 1024
+#define LQ_FREE_WORDS ((LQ_SIZE+63)/64)
 
 extern uint32_t SCHEDULING_LATENCY, EXEC_LATENCY;
 
 void print_core_config();
 
+// fetch target: sequential instructions within one cache line, ended early by a taken branch
+class FETCH_TARGET {
+  public:
+    uint64_t ip, first_instr_id, last_instr_id, enqueue_cycle;
+    uint8_t  closed;
+
+    FETCH_TARGET() {
+        ip = 0;
+        first_instr_id = 0;
+        last_instr_id = 0;
+        enqueue_cycle = 0;
+        closed = 0;
+    };
+};
+
+// address stream of one load PC, used to synthesize wrong-path loads
+class WRONG_PATH_LOAD {
+  public:
+    uint64_t ip, last_address, next_address, branch_id;
+    int64_t stride;
+
+    WRONG_PATH_LOAD() {
+        ip = 0;
+        last_address = 0;
+        next_address = 0;
+        branch_id = 0;
+        stride = 0;
+    };
+};
+
 // cpu
 class O3_CPU {
   public:
@@ -66,6 +102,10 @@ class O3_CPU {
     uint32_t RTE0[ROB_SIZE], RTE0_head, RTE0_tail, 
              RTE1[ROB_SIZE], RTE1_head, RTE1_tail;  
 
+    // Ready-To-Memory-schedule: memory instructions whose source registers are ready,
+    // ordered by age so that the oldest ones claim LQ/SQ entries first
+    priority_queue<pair<uint64_t, uint32_t>, vector<pair<uint64_t, uint32_t> >, greater<pair<uint64_t, uint32_t> > > RTM;
+
     // Ready-To-Load
     uint32_t RTL0[LQ_SIZE], RTL0_head, RTL0_tail, 
              RTL1[LQ_SIZE], RTL1_head, RTL1_tail;  
@@ -74,6 +114,20 @@ class O3_CPU {
     uint32_t RTS0[SQ_SIZE], RTS0_head, RTS0_tail,
              RTS1[SQ_SIZE], RTS1_head, RTS1_tail;
 
+    // register rename table: last in-flight writer of each architectural register
+    // an entry is valid while RAT_rob_index < ROB_SIZE and the ROB entry still holds RAT_instr_id
+    uint32_t RAT_rob_index[NUM_ARCH_REGS];
+    uint64_t RAT_instr_id[NUM_ARCH_REGS];
+
+    // free load queue slots, one bit per slot; the lowest free slot is taken first
+    // so slot numbering (and everything ordered by lq_index) matches a linear search
+    uint64_t LQ_free[LQ_FREE_WORDS];
+
+    // store index: youngest in-flight store per hashed virtual line, older stores
+    // of the same bucket are chained through ooo_model_instr::store_chain
+    uint32_t store_index[STORE_INDEX_SIZE];
+    uint64_t store_index_id[STORE_INDEX_SIZE];
+
     // branch
     int branch_mispredict_stall_fetch; // flag that says that we should stall because a branch prediction was wrong
     int mispredicted_branch_iw_index; // index in the instruction window of the mispredicted branch.  fetch resumes after the instruction at this index executes
@@ -82,6 +136,19 @@ class O3_CPU {
     uint64_t num_branch, branch_mispredictions;
     uint64_t total_rob_occupancy_at_branch_mispredict;
 
+    // fetch target queue: blocks the branch predictor has run ahead to but fetch has not consumed yet,
+    // and the predicted instructions of those blocks, oldest first
+    deque<FETCH_TARGET> FTQ;
+    deque<ooo_model_instr> FTQ_instr;
+    uint64_t ftq_blocks, ftq_full, ftq_untranslated, ftq_lead_cycles;
+
+    // wrong-path loads: recently seen load PCs and their address streams
+    vector<WRONG_PATH_LOAD> wp_table;
+    vector<uint64_t> wp_recent_ip;
+    uint32_t wp_recent_tail, wp_recent_count, wp_injected, wp_step;
+    uint8_t  wp_active;
+    uint64_t wp_branch_id, wp_mispredicts, wp_issued, wp_unmapped;
+
     // TLBs and caches
     CACHE ITLB{"ITLB", ITLB_SET, ITLB_WAY, ITLB_SET*ITLB_WAY, ITLB_WQ_SIZE, ITLB_RQ_SIZE, ITLB_PQ_SIZE, ITLB_MSHR_SIZE},
           DTLB{"DTLB", DTLB_SET, DTLB_WAY, DTLB_SET*DTLB_WAY, DTLB_WQ_SIZE, DTLB_RQ_SIZE, DTLB_PQ_SIZE, DTLB_MSHR_SIZE},
@@ -90,6 +157,12 @@ class O3_CPU {
           L1D{"L1D", L1D_SET, L1D_WAY, L1D_SET*L1D_WAY, L1D_WQ_SIZE, L1D_RQ_SIZE, L1D_PQ_SIZE, L1D_MSHR_SIZE},
           L2C{"L2C", L2C_SET, L2C_WAY, L2C_SET*L2C_WAY, L2C_WQ_SIZE, L2C_RQ_SIZE, L2C_PQ_SIZE, L2C_MSHR_SIZE};
 
+    // page table walker behind the STLB, only connected with knob::ptw_enable
+    PAGE_TABLE_WALKER PTW{"PTW"};
+
+    // the STLB's 2MB entries, only sized with knob::huge_page_fraction
+    PAGING_STRUCTURE_CACHE STLB_2M;
+
     // constructor
     O3_CPU() {
         cpu = 0;
@@ -132,6 +205,21 @@ class O3_CPU {
         num_branch = 0;
         branch_mispredictions = 0;
 
+        ftq_blocks = 0;
+        ftq_full = 0;
+        ftq_untranslated = 0;
+        ftq_lead_cycles = 0;
+
+        wp_recent_tail = 0;
+        wp_recent_count = 0;
+        wp_injected = 0;
+        wp_step = 0;
+        wp_active = 0;
+        wp_branch_id = 0;
+        wp_mispredicts = 0;
+        wp_issued = 0;
+        wp_unmapped = 0;
+
         for (uint32_t i=0; i<STA_SIZE; i++)
             STA[i] = UINT64_MAX;
         STA_head = 0;
@@ -163,6 +251,21 @@ class O3_CPU {
         RTS1_head = 0;
         RTS0_tail = 0;
         RTS1_tail = 0;
+
+        for (uint32_t i=0; i<LQ_FREE_WORDS; i++)
+            LQ_free[i] = 0;
+        for (uint32_t i=0; i<LQ_SIZE; i++)
+            LQ_free[i/64] |= 1ull << (i%64);
+
+        for (uint32_t i=0; i<STORE_INDEX_SIZE; i++) {
+            store_index[i] = UINT32_MAX;
+            store_index_id[i] = 0;
+        }
+
+        for (uint32_t i=0; i<NUM_ARCH_REGS; i++) {
+            RAT_rob_index[i] = ROB_SIZE;
+            RAT_instr_id[i] = 0;
+        }
     }
 
     // functions
@@ -180,15 +283,22 @@ class O3_CPU {
          complete_execution(uint32_t rob_index),
          reg_RAW_dependency(uint32_t prior, uint32_t current, uint32_t source_index),
          reg_RAW_release(uint32_t rob_index),
+         rename_release(uint32_t rob_index),
+         add_store_index(uint32_t rob_index),
+         release_store_index(uint32_t rob_index),
          mem_RAW_dependency(uint32_t prior, uint32_t current, uint32_t data_index, uint32_t lq_index),
          handle_o3_fetch(PACKET *current_packet, uint32_t cache_type),
          handle_merged_translation(PACKET *provider),
          handle_merged_load(PACKET *provider),
          release_load_queue(uint32_t lq_index),
          complete_instr_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb),
-         complete_data_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb);
+         complete_data_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb),
+         ftq_fetch(),
+         wrong_path_train(ooo_model_instr *arch_instr),
+         wrong_path_fetch();
 
     void initialize_core();
+    ooo_model_instr *ftq_enqueue(ooo_model_instr *arch_instr);
     void add_load_queue(uint32_t rob_index, uint32_t data_index),
          add_store_queue(uint32_t rob_index, uint32_t data_index),
          execute_store(uint32_t rob_index, uint32_t sq_index, uint32_t data_index);
@@ -202,12 +312,14 @@ class O3_CPU {
     uint32_t  add_to_rob(ooo_model_instr *arch_instr),
               check_rob(uint64_t instr_id);
 
-    uint32_t check_and_add_lsq(uint32_t rob_index);
+    uint32_t check_and_add_lsq(uint32_t rob_index),
+             find_store_producer(uint32_t rob_index, uint32_t data_index);
 
     // branch predictor
     uint8_t predict_branch(uint64_t ip);
     void    initialize_branch_predictor(),
-            last_branch_result(uint64_t ip, uint8_t taken); 
+            last_branch_result(uint64_t ip, uint8_t taken),
+            branch_predictor_final_stats();
 };
 
 extern O3_CPU ooo_cpu[NUM_CPUS];
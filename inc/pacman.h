@@ -0,0 +1,34 @@
+#ifndef PACMAN_H
+#define PACMAN_H
+
+#include "drrip.h"
+
+/* leader policies of the prefetch duel */
+#define PACMAN_HM 0
+#define PACMAN_OFF 1
+
+/* Prefetch-aware DRRIP, after Wu et al., "PACMan: Prefetch-Aware Cache
+ * Management for High Performance Caching," MICRO 2011. Prefetch fills are
+ * inserted at the distant RRPV and prefetch hits do not promote, unless a
+ * second set duel finds that treating prefetches like demands misses less. */
+class PACMan : public DRRIP
+{
+private:
+	SetDuelingMonitor pf_sdm;
+
+	struct
+	{
+		uint64_t pf_insert_distant;
+		uint64_t pf_hit_no_promote;
+		uint64_t pf_as_demand;
+	} pacman_stats;
+
+public:
+	PACMan(std::string type, uint32_t sets, uint32_t ways, uint32_t num_cpus);
+	~PACMan(){}
+	void update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit, uint32_t metadata);
+	void dump_stats();
+	void print_config();
+};
+
+#endif /* PACMAN_H */
@@ -3,6 +3,23 @@
 
 #include <string>
 #include <vector>
+#include <stdint.h>
+
+/* A prefetcher can attach its confidence in a prefetch to the metadata word
+ * it hands to prefetch_line(), so that the filling cache can pick an
+ * insertion position for the line. The level lives in the top byte, out of
+ * the way of prefetcher-private encodings such as IPCP's in the low bits. */
+#define PF_CONF_VALID	(1u << 31)
+#define PF_CONF_SHIFT	24
+#define PF_CONF_LEVELS	4
+
+inline uint32_t pf_conf_encode(uint32_t metadata, uint32_t level)
+{
+	if(level >= PF_CONF_LEVELS) level = PF_CONF_LEVELS - 1;
+	return (metadata & ~(0xffu << PF_CONF_SHIFT)) | PF_CONF_VALID | (level << PF_CONF_SHIFT);
+}
+inline bool pf_conf_valid(uint32_t metadata) {return metadata & PF_CONF_VALID;}
+inline uint32_t pf_conf_level(uint32_t metadata) {return (metadata >> PF_CONF_SHIFT) & (PF_CONF_LEVELS - 1);}
 
 class Prefetcher
 {
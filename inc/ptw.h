@@ -0,0 +1,106 @@
+#ifndef PTW_H
+#define PTW_H
+
+#include <deque>
+#include "memory_class.h"
+
+// x86-64 4-level radix page table: level 4 (PML4) down to level 1 (PT),
+// each level indexed by 9 bits of the virtual page number, 8B per entry
+#define PTW_LEVELS 4
+#define LOG2_PTW_ENTRIES 9
+#define PTW_ENTRY_SIZE 8
+
+// page table pages are allocated above every page va_to_pa can hand out (see RANDOM::dist)
+#define PTW_TABLE_PAGE_BASE (1ull << 36)
+
+// fully-associative LRU cache of PML4, PDP or PDE entries, tagged by the virtual page number bits
+// that select the entry. The STLB's 2MB entries are the same structure, tagged by 2MB region.
+class PAGING_STRUCTURE_CACHE {
+  public:
+    uint32_t SIZE;
+    vector<uint64_t> tag, lru;
+    vector<uint8_t> valid;
+    uint64_t access, hit, counter;
+
+    PAGING_STRUCTURE_CACHE() {
+        SIZE = 0;
+        access = 0;
+        hit = 0;
+        counter = 0;
+    };
+
+    void initialize(uint32_t size);
+    bool lookup(uint64_t vpn_tag);
+    void fill(uint64_t vpn_tag);
+};
+
+class PAGE_WALK {
+  public:
+    PACKET packet;      // the STLB miss being translated
+    uint32_t level;     // level of the entry being fetched, below leaf_level once the walk is done
+    uint32_t leaf_level; // 1, or 2 when a PDE maps a 2MB page
+    uint8_t issued;     // a load for the current entry is in flight (or merged with another walk's)
+    uint64_t entry_address, cycle_started;
+
+    PAGE_WALK() {
+        level = 0;
+        leaf_level = 1;
+        issued = 0;
+        entry_address = 0;
+        cycle_started = 0;
+    };
+};
+
+// Hardware page table walker behind the STLB (knob::ptw_enable). Each walk loads one entry per
+// level into the L1D, skipping the levels whose entry hits in the paging-structure caches.
+// Up to knob::ptw_walkers walks proceed at once, the rest wait in order.
+class PAGE_TABLE_WALKER : public MEMORY {
+  public:
+    const string NAME;
+    uint32_t cpu;
+
+    deque<PACKET> pending;
+    vector<PAGE_WALK> active;
+
+    // psc[level] caches the entries of that level, levels 2 to 4
+    PAGING_STRUCTURE_CACHE psc[PTW_LEVELS+1];
+
+    // physical page of every table, per level, keyed by the virtual page number bits above that level
+    map<uint64_t, uint64_t> table_page[PTW_LEVELS+1];
+
+    // stats
+    uint64_t walks, walk_cycles, entry_loads, entry_merged, huge_walks;
+
+    // constructor
+    PAGE_TABLE_WALKER(string v1) : NAME (v1) {
+        cpu = 0;
+        walks = 0;
+        walk_cycles = 0;
+        entry_loads = 0;
+        entry_merged = 0;
+        huge_walks = 0;
+    };
+
+    // destructor
+    ~PAGE_TABLE_WALKER() {
+
+    };
+
+    // functions
+    int  add_rq(PACKET *packet),
+         add_wq(PACKET *packet),
+         add_pq(PACKET *packet);
+
+    void return_data(PACKET *packet),
+         operate(),
+         increment_WQ_FULL(uint64_t address);
+
+    uint32_t get_occupancy(uint8_t queue_type, uint64_t address),
+             get_size(uint8_t queue_type, uint64_t address);
+
+    void     initialize();
+    void     start_walk(PACKET *packet);
+    uint64_t get_entry_address(uint64_t vpn, uint32_t level);
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef REPLACEMENT_H
+#define REPLACEMENT_H
+
+#include <string>
+#include "block.h"
+
+class Replacement
+{
+protected:
+	std::string type;
+
+public:
+	Replacement(std::string _type) {type = _type;}
+	virtual ~Replacement(){}
+	std::string get_type() {return type;}
+	virtual uint32_t find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type) = 0;
+	virtual void update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit, uint32_t metadata) = 0;
+	virtual void dump_stats() = 0;
+	virtual void print_config() = 0;
+};
+
+#endif /* REPLACEMENT_H */
@@ -0,0 +1,104 @@
+#ifndef RRIP_HELPER_H
+#define RRIP_HELPER_H
+
+#include <stdint.h>
+#include <vector>
+
+using namespace std;
+
+/* Re-reference prediction values of a whole cache, one byte per way.
+ * Every set is padded to a multiple of 16 ways so that the victim search
+ * can look at 16 ways at a time; padding ways always hold 0. */
+class RRPVTable
+{
+private:
+	uint32_t sets, ways, stride;
+	vector<uint8_t> rrpv;
+	vector<uint8_t> lane_mask;
+
+public:
+	uint8_t max_rrpv;
+
+	RRPVTable(uint32_t sets, uint32_t ways, uint8_t max_rrpv);
+	~RRPVTable(){}
+	uint8_t get(uint32_t set, uint32_t way) {return rrpv[set * stride + way];}
+	void set(uint32_t set, uint32_t way, uint8_t value) {rrpv[set * stride + way] = value;}
+
+	/* ages the set until some way reaches max_rrpv and returns the first such way */
+	uint32_t find_victim(uint32_t set);
+};
+
+/* Hands out distinct random sets for leader and sampler sets, using the
+ * same generator the original SHiP and DRRIP code used */
+class RandomSetPicker
+{
+private:
+	uint32_t sets;
+	unsigned long rand_seed;
+	vector<bool> picked;
+
+public:
+	RandomSetPicker(uint32_t sets);
+	~RandomSetPicker(){}
+	uint32_t next();
+};
+
+/* Duels two policies on per-core leader sets with a saturating PSEL counter.
+ * A miss in a policy-0 leader set pushes followers towards policy 1, and
+ * vice versa. */
+class SetDuelingMonitor
+{
+private:
+	uint32_t psel_max;
+	vector<uint32_t> psel;
+	vector<int16_t> leader_cpu;
+	vector<int8_t> leader_policy;
+
+public:
+	SetDuelingMonitor(RandomSetPicker &picker, uint32_t sets, uint32_t num_cpus, uint32_t sdm_size, uint32_t psel_width);
+	~SetDuelingMonitor(){}
+
+	/* 0 or 1 if the set leads that policy for this core, -1 for followers */
+	int leader(uint32_t cpu, uint32_t set) {return leader_cpu[set] == (int16_t)cpu ? leader_policy[set] : -1;}
+	void record_miss(uint32_t cpu, int policy);
+	int winner(uint32_t cpu) {return psel[cpu] > psel_max / 2 ? 0 : 1;}
+	uint32_t get_psel(uint32_t cpu) {return psel[cpu];}
+};
+
+class SamplerEntry
+{
+public:
+	uint8_t valid, type, used;
+	uint64_t tag, ip;
+	uint32_t lru;
+
+	SamplerEntry() : valid(0), type(0), used(0), tag(0), ip(0), lru(0) {}
+	~SamplerEntry(){}
+};
+
+typedef enum
+{
+	SAMPLER_NONE = 0,
+	SAMPLER_REUSE,	/* a sampled line was reused, trained_ip inserted it */
+	SAMPLER_DEAD,	/* a sampled line was evicted without reuse, trained_ip inserted it */
+} SamplerEvent;
+
+/* LRU-managed tag-only shadow copies of a few random sets, used to learn
+ * which PCs insert lines that are reused */
+class SamplerSets
+{
+private:
+	uint32_t ways;
+	vector<int32_t> index;
+	vector<SamplerEntry> entries;
+
+public:
+	SamplerSets(RandomSetPicker &picker, uint32_t sets, uint32_t num_sampled, uint32_t ways);
+	~SamplerSets(){}
+
+	/* sampler slot of this set, -1 if the set is not sampled */
+	int32_t lookup(uint32_t set) {return index[set];}
+	SamplerEvent access(int32_t s_idx, uint64_t tag, uint64_t ip, uint8_t type, uint64_t &trained_ip);
+};
+
+#endif /* RRIP_HELPER_H */
@@ -17,12 +17,146 @@ using namespace std;
 #define MAX_SCOOBY_DEGREE 16
 #define SCOOBY_MAX_IPC_LEVEL 4
 
+/* Knobs that can be overridden per cache level via the [l1d], [l2c]
+ * and [llc] sections of a config file. Each Scooby instance keeps its
+ * own copy and swaps it into the global knob namespace while it runs. */
+#define SCOOBY_LEVEL_KNOBS(X) \
+	X(float, scooby_alpha) \
+	X(float, scooby_gamma) \
+	X(float, scooby_epsilon) \
+	X(uint32_t, scooby_state_num_bits) \
+	X(uint32_t, scooby_max_states) \
+	X(uint32_t, scooby_seed) \
+	X(string, scooby_policy) \
+	X(string, scooby_learning_type) \
+	X(vector<int32_t>, scooby_actions) \
+	X(uint32_t, scooby_max_actions) \
+	X(uint32_t, scooby_pt_size) \
+	X(uint32_t, scooby_st_size) \
+	X(uint32_t, scooby_max_pcs) \
+	X(uint32_t, scooby_max_offsets) \
+	X(uint32_t, scooby_max_deltas) \
+	X(int32_t, scooby_reward_none) \
+	X(int32_t, scooby_reward_incorrect) \
+	X(int32_t, scooby_reward_correct_untimely) \
+	X(int32_t, scooby_reward_correct_timely) \
+	X(bool, scooby_brain_zero_init) \
+	X(bool, scooby_enable_reward_all) \
+	X(bool, scooby_enable_track_multiple) \
+	X(bool, scooby_enable_reward_out_of_bounds) \
+	X(int32_t, scooby_reward_out_of_bounds) \
+	X(uint32_t, scooby_state_type) \
+	X(bool, scooby_access_debug) \
+	X(bool, scooby_print_access_debug) \
+	X(uint64_t, scooby_print_access_debug_pc) \
+	X(uint32_t, scooby_print_access_debug_pc_count) \
+	X(bool, scooby_print_trace) \
+	X(bool, scooby_enable_state_action_stats) \
+	X(bool, scooby_enable_reward_tracker_hit) \
+	X(int32_t, scooby_reward_tracker_hit) \
+	X(int32_t, scooby_reward_dropped) \
+	X(uint32_t, scooby_state_hash_type) \
+	X(bool, scooby_enable_featurewise_engine) \
+	X(uint32_t, scooby_pref_degree) \
+	X(bool, scooby_enable_dyn_degree) \
+	X(vector<float>, scooby_max_to_avg_q_thresholds) \
+	X(vector<float>, scooby_pf_conf_q_ratio_thresholds) \
+	X(vector<int32_t>, scooby_dyn_degrees) \
+	X(uint64_t, scooby_early_exploration_window) \
+	X(uint32_t, scooby_multi_deg_select_type) \
+	X(vector<int32_t>, scooby_last_pref_offset_conf_thresholds) \
+	X(vector<int32_t>, scooby_dyn_degrees_type2) \
+	X(uint32_t, scooby_action_tracker_size) \
+	X(uint32_t, scooby_high_bw_thresh) \
+	X(bool, scooby_enable_hbw_reward) \
+	X(int32_t, scooby_reward_hbw_correct_timely) \
+	X(int32_t, scooby_reward_hbw_correct_untimely) \
+	X(int32_t, scooby_reward_hbw_incorrect) \
+	X(int32_t, scooby_reward_hbw_none) \
+	X(int32_t, scooby_reward_hbw_out_of_bounds) \
+	X(int32_t, scooby_reward_hbw_tracker_hit) \
+	X(int32_t, scooby_reward_hbw_dropped) \
+	X(vector<int32_t>, scooby_last_pref_offset_conf_thresholds_hbw) \
+	X(vector<int32_t>, scooby_dyn_degrees_type2_hbw) \
+	X(bool, scooby_enable_va) \
+	X(bool, scooby_enable_cross_page) \
+	X(bool, scooby_enable_throttle) \
+	X(bool, scooby_enable_dram_telemetry) \
+	X(bool, scooby_enable_huge_page) \
+	X(bool, scooby_enable_translation_prefetch) \
+	X(uint32_t, scooby_throttle_pc_table_size) \
+	X(uint32_t, scooby_throttle_region_table_size) \
+	X(uint32_t, scooby_throttle_log2_region_pages) \
+	X(uint32_t, scooby_throttle_epoch) \
+	X(float, scooby_throttle_suppress_acc) \
+	X(float, scooby_throttle_suppress_acc_hbw) \
+	X(float, scooby_throttle_boost_acc) \
+	X(float, scooby_throttle_boost_late) \
+	X(bool, le_enable_trace) \
+	X(uint32_t, le_trace_interval) \
+	X(string, le_trace_file_name) \
+	X(uint32_t, le_trace_state) \
+	X(bool, le_enable_score_plot) \
+	X(vector<int32_t>, le_plot_actions) \
+	X(string, le_plot_file_name) \
+	X(bool, le_enable_action_trace) \
+	X(uint32_t, le_action_trace_interval) \
+	X(string, le_action_trace_name) \
+	X(bool, le_enable_action_plot) \
+	X(vector<int32_t>, le_featurewise_active_features) \
+	X(vector<int32_t>, le_featurewise_num_tilings) \
+	X(vector<int32_t>, le_featurewise_num_tiles) \
+	X(vector<int32_t>, le_featurewise_hash_types) \
+	X(vector<int32_t>, le_featurewise_enable_tiling_offset) \
+	X(float, le_featurewise_max_q_thresh) \
+	X(bool, le_featurewise_enable_action_fallback) \
+	X(vector<float>, le_featurewise_feature_weights) \
+	X(bool, le_featurewise_enable_dynamic_weight) \
+	X(float, le_featurewise_weight_gradient) \
+	X(bool, le_featurewise_disable_adjust_weight_all_features_align) \
+	X(bool, le_featurewise_selective_update) \
+	X(uint32_t, le_featurewise_pooling_type) \
+	X(bool, le_featurewise_enable_dyn_action_fallback) \
+	X(uint32_t, le_featurewise_bw_acc_check_level) \
+	X(uint32_t, le_featurewise_acc_thresh) \
+	X(uint32_t, le_featurewise_knowledge_sharing) \
+	X(uint64_t, le_featurewise_knowledge_merge_epoch) \
+	X(bool, le_featurewise_enable_trace) \
+	X(uint32_t, le_featurewise_trace_feature_type) \
+	X(string, le_featurewise_trace_feature) \
+	X(uint32_t, le_featurewise_trace_interval) \
+	X(uint32_t, le_featurewise_trace_record_count) \
+	X(string, le_featurewise_trace_file_name) \
+	X(bool, le_featurewise_enable_score_plot) \
+	X(vector<int32_t>, le_featurewise_plot_actions) \
+	X(string, le_featurewise_plot_file_name) \
+	X(bool, le_featurewise_remove_plot_script)
+
 /* forward declaration */
 class LearningEngine;
 
+struct ScoobyLevelKnobs
+{
+#define X(type, name) type name;
+	SCOOBY_LEVEL_KNOBS(X)
+#undef X
+};
+
 class Scooby : public Prefetcher
 {
 private:
+	/* cache level this instance is attached to (l1d, l2c or llc) */
+	string level;
+	string stats_prefix;
+	uint32_t cpu;
+	bool has_level_knobs;
+	ScoobyLevelKnobs level_knobs;
+
+	/* Action array
+	 * Basically a set of deltas to evaluate
+	 * Similar to the concept of BOP */
+	vector<int32_t> Actions;
+
 	deque<Scooby_STEntry*> signature_table;
 	LearningEngineBasic *brain;
 	LearningEngineFeaturewise *brain_featurewise;
@@ -36,6 +170,9 @@ private:
 	 * has nothing to do with prefetching */
 	ScoobyRecorder *recorder;
 
+	/* per-PC/per-region prefetch throttling */
+	ScoobyThrottle *throttle;
+
 	/* Data structures for debugging */
 	unordered_map<string, uint64_t> target_action_state;
 
@@ -63,6 +200,11 @@ private:
 			uint64_t multi_deg_called;
 			uint64_t multi_deg_histogram[MAX_SCOOBY_DEGREE+1];
 			uint64_t deg_histogram[MAX_SCOOBY_DEGREE+1];
+			uint64_t cross_page;
+			uint64_t cross_page_unmapped;
+			uint64_t cross_page_huge;
+			uint64_t throttled;
+			uint64_t conf_level[PF_CONF_LEVELS];
 		} predict;
 
 		struct
@@ -104,7 +246,9 @@ private:
 			uint64_t incorrect;
 			uint64_t out_of_bounds;
 			uint64_t tracker_hit;
+			uint64_t dropped;
 			uint64_t dist[MAX_ACTIONS][MAX_REWARDS];
+			uint64_t cross_page_dist[MAX_REWARDS];
 		} reward;
 
 		struct
@@ -127,15 +271,31 @@ private:
 			uint64_t set_total;
 		} register_prefetch_hit;
 
+		struct
+		{
+			uint64_t called;
+			uint64_t rewarded;
+		} register_drop;
+
 		struct
 		{
 			uint64_t scooby;
 		} pref_issue;
 
+		struct
+		{
+			uint64_t pa_to_va;
+			uint64_t pa_to_va_miss;
+			uint64_t untranslated_access;
+			uint64_t va_to_pa;
+			uint64_t va_to_pa_miss;
+		} translation;
+
 		struct 
 		{
 			uint64_t epochs;
 			uint64_t histogram[DRAM_BW_LEVELS];
+			uint64_t pulled[DRAM_BW_LEVELS];
 		} bandwidth;
 
 		struct 
@@ -155,7 +315,20 @@ private:
 	unordered_map<std::string, vector<uint64_t> > state_action_dist2;
 	unordered_map<int32_t, vector<uint64_t> > action_deg_dist;
 
+	/* confidence metadata of the prefetches in the last pref_addr, index by index */
+	vector<uint32_t> pref_conf;
+
 private:
+	/* swaps this instance's per-level knobs in and out of the knob namespace */
+	struct LevelKnobScope
+	{
+		Scooby *scooby;
+		LevelKnobScope(Scooby *s) : scooby(s) {scooby->swap_level_knobs();}
+		~LevelKnobScope() {scooby->swap_level_knobs();}
+	};
+
+	void init_level_knobs(CACHE *cache);
+	void swap_level_knobs();
 	void init_knobs();
 	void init_stats();
 
@@ -171,23 +344,31 @@ private:
 	vector<Scooby_PTEntry*> search_pt(uint64_t address, bool search_all = false);
 	void update_stats(uint32_t state, uint32_t action_index, uint32_t pref_degree = 1);
 	void update_stats(State *state, uint32_t action_index, uint32_t degree = 1);
-	void track_in_st(uint64_t page, uint32_t pred_offset, int32_t pref_offset);
+	void track_in_st(uint64_t page, int32_t pred_offset, int32_t pref_offset);
+	bool get_virtual_address(uint64_t address, uint64_t &va);
+	void translate_prefetches(vector<uint64_t> &pref_addr, uint32_t start);
+	bool cross_page_target(uint64_t page, int32_t predicted_offset, uint64_t &addr);
 	void gen_multi_degree_pref(uint64_t page, uint32_t offset, int32_t action, uint32_t pref_degree, vector<uint64_t> &pref_addr);
 	uint32_t get_dyn_pref_degree(float max_to_avg_q_ratio, uint64_t page = 0xdeadbeef, int32_t action = 0); /* only implemented for CMAC engine 2.0 */
 	bool is_high_bw();
+	uint32_t get_pref_conf(float max_to_avg_q_ratio);
+	void append_pref_conf(uint32_t size, uint32_t metadata);
 
 public:
-	Scooby(string type);
+	Scooby(string type, CACHE *cache);
 	~Scooby();
 	void invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr);
+	uint32_t get_pref_metadata(uint32_t index) {return index < pref_conf.size() ? pref_conf[index] : 0;}
 	void register_fill(uint64_t address);
 	void register_prefetch_hit(uint64_t address);
+	void register_drop(uint64_t address);
 	void dump_stats();
 	void print_config();
 	int32_t getAction(uint32_t action_index);
 	void update_bw(uint8_t bw_level);
 	void update_ipc(uint8_t ipc);
 	void update_acc(uint32_t acc_level);
+	inline string get_level() {return level;}
 };
 
 #endif /* SCOOBY_H */
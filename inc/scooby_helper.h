@@ -36,6 +36,7 @@ typedef enum
 	correct_timely,
 	out_of_bounds,
 	tracker_hit,
+	dropped,		/* the memory controller dropped the prefetch before it was serviced */
 
 	num_rewards
 } RewardType;
@@ -162,10 +163,16 @@ public:
 	int32_t reward;
 	RewardType reward_type;
 	bool has_reward;
+	/* prefetch that crossed into the next virtual page */
+	bool cross_page;
+	/* prediction tracked for learning but not issued */
+	bool throttled;
 	vector<bool> consensus_vec; // only used in featurewise engine
 	
 	Scooby_PTEntry(uint64_t ad, State *st, uint32_t ac) : address(ad), state(st), action_index(ac)
 	{
+		cross_page = false;
+		throttled = false;
 		is_filled = false;
 		pf_cache_hit = false;
 		reward = 0;
@@ -197,6 +204,74 @@ public:
 	void dump_stats();
 };
 
+/* Feedback controller that throttles prefetches per PC and per page region
+ * based on the rewards earlier prefetches from that PC/region collected */
+typedef enum
+{
+	Throttle_Normal = 0,
+	Throttle_Suppress,
+	Throttle_Boost,
+
+	NumThrottleDecisions
+} ThrottleDecision;
+
+class ScoobyThrottleEntry
+{
+public:
+	uint64_t tag;
+	bool valid;
+	/* counters of the running epoch */
+	uint32_t correct, incorrect, timely, untimely;
+	/* outcome of the last completed epoch */
+	bool trained;
+	float accuracy, lateness;
+
+	ScoobyThrottleEntry() {reset(0); valid = false;}
+	void reset(uint64_t t)
+	{
+		tag = t;
+		valid = true;
+		correct = incorrect = timely = untimely = 0;
+		trained = false;
+		accuracy = lateness = 0.0;
+	}
+};
+
+class ScoobyThrottle
+{
+private:
+	vector<ScoobyThrottleEntry> pc_table;
+	vector<ScoobyThrottleEntry> region_table;
+
+	struct
+	{
+		uint64_t lookup;
+		uint64_t decision[NumThrottleDecisions];
+		uint64_t suppress_pc;
+		uint64_t suppress_region;
+		uint64_t boost_pc;
+		uint64_t boost_region;
+		uint64_t rewards;
+		uint64_t epochs_pc;
+		uint64_t epochs_region;
+		uint64_t evict_pc;
+		uint64_t evict_region;
+	} stats;
+
+private:
+	ScoobyThrottleEntry* get_entry(vector<ScoobyThrottleEntry> &table, uint64_t key, bool allocate, uint64_t &evict);
+	void update_entry(ScoobyThrottleEntry *entry, RewardType type, bool throttled, uint64_t &epochs);
+	ThrottleDecision decide(ScoobyThrottleEntry *entry, bool high_bw);
+	uint32_t count_decisions(vector<ScoobyThrottleEntry> &table, ThrottleDecision decision, bool high_bw);
+
+public:
+	ScoobyThrottle(uint32_t pc_table_size, uint32_t region_table_size);
+	~ScoobyThrottle(){}
+	ThrottleDecision get_decision(uint64_t pc, uint64_t page, bool high_bw);
+	void record_reward(uint64_t pc, uint64_t page, RewardType type, bool throttled);
+	void dump_stats(string prefix, bool high_bw);
+};
+
 /* auxiliary functions */
 void print_access_debug(Scooby_STEntry *stentry);
 string print_active_features(vector<int32_t> active_features);
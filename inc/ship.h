@@ -0,0 +1,34 @@
+#ifndef SHIP_H
+#define SHIP_H
+
+#include "srrip.h"
+
+#define SHCT_SIZE  16384
+#define SHCT_PRIME 16381
+#define SHCT_MAX 7
+#define SHIP_SAMPLER_SETS_PER_CPU 256
+
+class SHiP : public SRRIP
+{
+private:
+	uint32_t sets;
+	RandomSetPicker picker;
+	SamplerSets sampler;
+	vector<uint32_t> SHCT; /* SHCT_SIZE counters per core */
+
+	struct
+	{
+		uint64_t sampler_reuse;
+		uint64_t sampler_dead;
+		uint64_t insert_distant;
+	} ship_stats;
+
+public:
+	SHiP(std::string type, uint32_t sets, uint32_t ways, uint32_t num_cpus);
+	~SHiP(){}
+	void update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit, uint32_t metadata);
+	void dump_stats();
+	void print_config();
+};
+
+#endif /* SHIP_H */
@@ -0,0 +1,34 @@
+#ifndef SRRIP_H
+#define SRRIP_H
+
+#include "replacement.h"
+#include "rrip_helper.h"
+
+#define maxRRPV 3
+
+class SRRIP : public Replacement
+{
+protected:
+	RRPVTable rrpv;
+
+	struct
+	{
+		uint64_t insert;
+		uint64_t promote;
+		uint64_t victim;
+		uint64_t pf_conf_distant;
+		uint64_t pf_conf_no_promote;
+	} stats;
+
+	bool pf_conf_update(uint32_t set, uint32_t way, uint32_t type, uint8_t hit, uint32_t metadata);
+
+public:
+	SRRIP(std::string type, uint32_t sets, uint32_t ways);
+	~SRRIP(){}
+	uint32_t find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type);
+	void update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit, uint32_t metadata);
+	void dump_stats();
+	void print_config();
+};
+
+#endif /* SRRIP_H */
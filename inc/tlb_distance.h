@@ -0,0 +1,70 @@
+#ifndef TLB_DISTANCE_H
+#define TLB_DISTANCE_H
+
+#include <deque>
+#include <vector>
+#include "prefetcher.h"
+
+using namespace std;
+
+#define MAX_TLB_DISTANCE_SLOTS 4
+
+/* distances that followed a given distance in the STLB miss stream, most recent first */
+class DistanceEntry
+{
+  public:
+    int64_t distance;
+    vector<int64_t> next;
+
+    DistanceEntry()
+    {
+        distance = 0;
+    };
+};
+
+/* Distance prefetcher for the STLB (Kandiraju and Sivasubramaniam, ISCA'02).
+ * Works on virtual page numbers: it learns which page distances follow which
+ * in the miss stream, and on a miss prefetches the translations of the pages
+ * the current distance has been followed by. A stream with a constant stride
+ * ends up with one entry that predicts itself. */
+class TLBDistancePrefetcher : public Prefetcher
+{
+private:
+   deque<DistanceEntry*> table;
+   uint64_t last_vpage;
+   int64_t last_distance;
+
+   /* stats */
+   struct
+   {
+      struct
+      {
+         uint64_t lookup;
+         uint64_t evict;
+         uint64_t insert;
+         uint64_t hit;
+      } table;
+
+      struct
+      {
+         uint64_t called;
+         uint64_t generated;
+      } pref;
+
+   } stats;
+
+private:
+   void init_knobs();
+   void init_stats();
+   deque<DistanceEntry*>::iterator search(int64_t distance);
+   void train(int64_t distance, int64_t next);
+
+public:
+   TLBDistancePrefetcher(string type);
+   ~TLBDistancePrefetcher();
+   void invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr);
+   void dump_stats();
+   void print_config();
+};
+
+#endif /* TLB_DISTANCE_H */
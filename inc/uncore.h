@@ -15,9 +15,18 @@ class UNCORE {
     // LLC
     CACHE LLC{"LLC", LLC_SET, LLC_WAY, LLC_SET*LLC_WAY, LLC_WQ_SIZE, LLC_RQ_SIZE, LLC_PQ_SIZE, LLC_MSHR_SIZE};
 
+    // MESI directory at the LLC, only wired up with knob::coherence_directory
+    COHERENCE_DIRECTORY DIRECTORY;
+
+    // ring or mesh to the LLC slices, only used with knob::llc_slices > 1
+    LLC_INTERCONNECT INTERCONNECT;
+
     // DRAM
     MEMORY_CONTROLLER DRAM{"DRAM"}; 
 
+    // routes to one controller per node, NUMA.node[0] is DRAM
+    NUMA_INTERCONNECT NUMA{"NUMA"};
+
     // cycle
     uint64_t cycle;
 
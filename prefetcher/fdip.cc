@@ -0,0 +1,99 @@
+#include <assert.h>
+#include <algorithm>
+#include <strings.h>
+#include "fdip.h"
+#include "champsim.h"
+
+namespace knob
+{
+	extern uint32_t fdip_filter_size;
+	extern uint32_t ftq_size;
+}
+
+void FDIP::init_knobs()
+{
+	/* without a fetch target queue there is nothing to direct the prefetcher */
+	assert(knob::ftq_size > 0);
+	assert(knob::fdip_filter_size > 0);
+}
+
+void FDIP::init_stats()
+{
+	bzero(&stats, sizeof(stats));
+}
+
+FDIP::FDIP(string type) : Prefetcher(type)
+{
+	init_knobs();
+	init_stats();
+}
+
+FDIP::~FDIP()
+{
+
+}
+
+void FDIP::print_config()
+{
+	cout << "fdip_filter_size " << knob::fdip_filter_size << endl
+		<< endl;
+}
+
+/* demand fetches only tell us how much of the instruction stream FDIP covered */
+void FDIP::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr)
+{
+	stats.demand.called++;
+	if(search_recent(address >> LOG2_BLOCK_SIZE))
+	{
+		stats.demand.covered++;
+		if(cache_hit) stats.demand.covered_hit++;
+	}
+}
+
+void FDIP::enqueue_fetch_target(uint64_t ip, uint64_t pa, vector<uint64_t> &pref_addr)
+{
+	stats.fetch_target.called++;
+
+	uint64_t line = pa >> LOG2_BLOCK_SIZE;
+	if(search_recent(line))
+	{
+		stats.fetch_target.filtered++;
+		return;
+	}
+
+	if(recent_lines.size() >= knob::fdip_filter_size)
+	{
+		recent_lines.pop_front();
+	}
+	recent_lines.push_back(line);
+
+	pref_addr.push_back(line << LOG2_BLOCK_SIZE);
+	stats.fetch_target.issue++;
+}
+
+bool FDIP::search_recent(uint64_t line)
+{
+	return find(recent_lines.begin(), recent_lines.end(), line) != recent_lines.end();
+}
+
+void FDIP::register_fill(uint64_t address)
+{
+	stats.register_fill.called++;
+	if(search_recent(address >> LOG2_BLOCK_SIZE))
+	{
+		stats.register_fill.fill++;
+	}
+}
+
+void FDIP::dump_stats()
+{
+	cout << "fdip_fetch_target_called " << stats.fetch_target.called << endl
+		<< "fdip_fetch_target_filtered " << stats.fetch_target.filtered << endl
+		<< "fdip_fetch_target_issue " << stats.fetch_target.issue << endl
+		<< "fdip_register_fill_called " << stats.register_fill.called << endl
+		<< "fdip_register_fill_fill " << stats.register_fill.fill << endl
+		<< "fdip_demand_called " << stats.demand.called << endl
+		<< "fdip_demand_covered " << stats.demand.covered << endl
+		<< "fdip_demand_covered_hit " << stats.demand.covered_hit << endl
+		<< endl;
+}
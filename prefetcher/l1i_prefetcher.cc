@@ -0,0 +1,31 @@
+#include "cache.h"
+
+void CACHE::l1i_prefetcher_initialize() 
+{
+
+}
+
+void CACHE::l1i_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type)
+{
+
+}
+
+void CACHE::l1i_prefetcher_fetch_target(uint64_t ip, uint64_t pa)
+{
+
+}
+
+void CACHE::l1i_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in)
+{
+
+}
+
+void CACHE::l1i_prefetcher_final_stats()
+{
+
+}
+
+void CACHE::l1i_prefetcher_print_config()
+{
+	
+}
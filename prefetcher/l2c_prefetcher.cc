@@ -25,6 +25,11 @@ uint32_t CACHE::l2c_prefetcher_prefetch_hit(uint64_t addr, uint64_t ip, uint32_t
     return metadata_in;
 }
 
+void CACHE::l2c_prefetcher_prefetch_drop(uint64_t addr, uint32_t metadata_in)
+{
+
+}
+
 void CACHE::l2c_prefetcher_print_config()
 {
 	
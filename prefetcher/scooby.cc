@@ -4,8 +4,10 @@
 #include "champsim.h"
 #include "cache.h"
 #include "memory_class.h"
+#include "dram_controller.h"
 #include "scooby.h"
 #include "util.h"
+#include "knobs.h"
 
 #if 0
 #	define LOCKED(...) {fflush(stdout); __VA_ARGS__; fflush(stdout);}
@@ -17,12 +19,6 @@
 #	define MYLOG(...) {}
 #endif
 
-
-/* Action array
- * Basically a set of deltas to evaluate
- * Similar to the concept of BOP */
-std::vector<int32_t> Actions;
-
 namespace knob
 {
 	extern float    scooby_alpha;
@@ -58,11 +54,13 @@ namespace knob
 	extern bool     scooby_enable_state_action_stats;
 	extern bool     scooby_enable_reward_tracker_hit;
 	extern int32_t  scooby_reward_tracker_hit;
+	extern int32_t  scooby_reward_dropped;
 	extern uint32_t scooby_state_hash_type;
 	extern bool     scooby_enable_featurewise_engine;
 	extern uint32_t scooby_pref_degree;
 	extern bool     scooby_enable_dyn_degree;
 	extern vector<float> scooby_max_to_avg_q_thresholds;
+	extern vector<float> scooby_pf_conf_q_ratio_thresholds;
 	extern vector<int32_t> scooby_dyn_degrees;
 	extern uint64_t scooby_early_exploration_window;
 	extern uint32_t scooby_pt_address_hash_type;
@@ -80,8 +78,23 @@ namespace knob
 	extern int32_t  scooby_reward_hbw_none;
 	extern int32_t  scooby_reward_hbw_out_of_bounds;
 	extern int32_t  scooby_reward_hbw_tracker_hit;
+	extern int32_t  scooby_reward_hbw_dropped;
 	extern vector<int32_t> scooby_last_pref_offset_conf_thresholds_hbw;
 	extern vector<int32_t> scooby_dyn_degrees_type2_hbw;
+	extern bool     scooby_enable_va;
+	extern bool     scooby_enable_cross_page;
+	extern bool     scooby_enable_throttle;
+	extern bool     scooby_enable_dram_telemetry;
+	extern bool     scooby_enable_huge_page;
+	extern bool     scooby_enable_translation_prefetch;
+	extern uint32_t scooby_throttle_pc_table_size;
+	extern uint32_t scooby_throttle_region_table_size;
+	extern uint32_t scooby_throttle_log2_region_pages;
+	extern uint32_t scooby_throttle_epoch;
+	extern float    scooby_throttle_suppress_acc;
+	extern float    scooby_throttle_suppress_acc_hbw;
+	extern float    scooby_throttle_boost_acc;
+	extern float    scooby_throttle_boost_late;
 
 	/* Learning Engine knobs */
 	extern bool     le_enable_trace;
@@ -113,6 +126,8 @@ namespace knob
 	extern bool             le_featurewise_enable_dyn_action_fallback;
 	extern uint32_t 		le_featurewise_bw_acc_check_level;
 	extern uint32_t 		le_featurewise_acc_thresh;
+	extern uint32_t 		le_featurewise_knowledge_sharing;
+	extern uint64_t 		le_featurewise_knowledge_merge_epoch;
 	extern bool 			le_featurewise_enable_trace;
 	extern uint32_t		le_featurewise_trace_feature_type;
 	extern string 			le_featurewise_trace_feature;
@@ -123,6 +138,66 @@ namespace knob
 	extern vector<int32_t> le_featurewise_plot_actions;
 	extern std::string 	le_featurewise_plot_file_name;
 	extern bool 			le_featurewise_remove_plot_script;
+
+	/* per-level overrides from [l1d], [l2c] and [llc] config sections */
+	extern map<string, vector<pair<string, string> > > cache_level_knobs;
+}
+
+static bool is_level_knob(string name)
+{
+#define X(type, knob_name) if(!name.compare(#knob_name)) return true;
+	SCOOBY_LEVEL_KNOBS(X)
+#undef X
+	return false;
+}
+
+void Scooby::init_level_knobs(CACHE *cache)
+{
+	cpu = cache->cpu;
+	switch(cache->cache_type)
+	{
+		case IS_L1D:	level = string("l1d"); break;
+		case IS_LLC:	level = string("llc"); break;
+		default:		level = string("l2c"); break;
+	}
+	/* keep the historical stats names for the L2 instance */
+	stats_prefix = !level.compare("l2c") ? string("scooby") : string("scooby_") + level;
+
+	has_level_knobs = false;
+	auto it = knob::cache_level_knobs.find(level);
+	if(it == knob::cache_level_knobs.end() || it->second.empty())
+	{
+		return;
+	}
+
+	/* start from the global values and apply the overrides on top */
+#define X(type, knob_name) level_knobs.knob_name = knob::knob_name;
+	SCOOBY_LEVEL_KNOBS(X)
+#undef X
+	has_level_knobs = true;
+	swap_level_knobs();
+	for(uint32_t index = 0; index < it->second.size(); ++index)
+	{
+		const char *name = it->second[index].first.c_str();
+		const char *value = it->second[index].second.c_str();
+		if(!is_level_knob(it->second[index].first) || !parse_knobs(NULL, "", name, value))
+		{
+			cout << "unsupported " << level << " knob " << name << endl;
+			exit(1);
+		}
+	}
+	swap_level_knobs();
+}
+
+void Scooby::swap_level_knobs()
+{
+	if(!has_level_knobs)
+	{
+		return;
+	}
+#define X(type, knob_name) std::swap(level_knobs.knob_name, knob::knob_name);
+	SCOOBY_LEVEL_KNOBS(X)
+#undef X
 }
 
 void Scooby::init_knobs()
@@ -141,6 +216,9 @@ void Scooby::init_knobs()
 	assert(knob::scooby_pref_degree >= 1 && (knob::scooby_pref_degree == 1 || !knob::scooby_enable_dyn_degree));
 	assert(knob::scooby_max_to_avg_q_thresholds.size() == knob::scooby_dyn_degrees.size()-1);
 	assert(knob::scooby_last_pref_offset_conf_thresholds.size() == knob::scooby_dyn_degrees_type2.size()-1);
+	/* the shared LLC mixes the address spaces of all cores */
+	assert(!knob::scooby_enable_va || level.compare("llc"));
+	assert(!knob::scooby_enable_cross_page || knob::scooby_enable_va);
 }
 
 void Scooby::init_stats()
@@ -153,13 +231,22 @@ void Scooby::init_stats()
 	state_action_dist.clear();
 }
 
-Scooby::Scooby(string type) : Prefetcher(type)
+Scooby::Scooby(string type, CACHE *cache) : Prefetcher(type)
 {
+	init_level_knobs(cache);
+	LevelKnobScope scope(this);
+
 	init_knobs();
 	init_stats();
 
 	recorder = new ScoobyRecorder();
 
+	throttle = NULL;
+	if(knob::scooby_enable_throttle)
+	{
+		throttle = new ScoobyThrottle(knob::scooby_throttle_pc_table_size, knob::scooby_throttle_region_table_size);
+	}
+
 	last_evicted_tracker = NULL;
 
 	/* init learning engine */
@@ -197,11 +284,15 @@ Scooby::~Scooby()
 {
 	if(brain_featurewise) delete brain_featurewise;
 	if(brain) 		delete brain;
+	if(throttle)	delete throttle;
 }
 
 void Scooby::print_config()
 {
-	cout << "scooby_alpha " << knob::scooby_alpha << endl
+	LevelKnobScope scope(this);
+
+	cout << "scooby_level " << level << endl
+		<< "scooby_alpha " << knob::scooby_alpha << endl
 		<< "scooby_gamma " << knob::scooby_gamma << endl
 		<< "scooby_epsilon " << knob::scooby_epsilon << endl
 		<< "scooby_state_num_bits " << knob::scooby_state_num_bits << endl
@@ -235,10 +326,12 @@ void Scooby::print_config()
 		<< "scooby_enable_state_action_stats " << knob::scooby_enable_state_action_stats << endl
 		<< "scooby_enable_reward_tracker_hit " << knob::scooby_enable_reward_tracker_hit << endl
 		<< "scooby_reward_tracker_hit " << knob::scooby_reward_tracker_hit << endl
+		<< "scooby_reward_dropped " << knob::scooby_reward_dropped << endl
 		<< "scooby_enable_featurewise_engine " << knob::scooby_enable_featurewise_engine << endl
 		<< "scooby_pref_degree " << knob::scooby_pref_degree << endl
 		<< "scooby_enable_dyn_degree " << knob::scooby_enable_dyn_degree << endl
 		<< "scooby_max_to_avg_q_thresholds " << array_to_string(knob::scooby_max_to_avg_q_thresholds) << endl
+		<< "scooby_pf_conf_q_ratio_thresholds " << array_to_string(knob::scooby_pf_conf_q_ratio_thresholds) << endl
 		<< "scooby_dyn_degrees " << array_to_string(knob::scooby_dyn_degrees) << endl
 		<< "scooby_multi_deg_select_type " << knob::scooby_multi_deg_select_type << endl
 		<< "scooby_last_pref_offset_conf_thresholds " << array_to_string(knob::scooby_last_pref_offset_conf_thresholds) << endl
@@ -252,8 +345,23 @@ void Scooby::print_config()
 		<< "scooby_reward_hbw_none " << knob::scooby_reward_hbw_none << endl
 		<< "scooby_reward_hbw_out_of_bounds " << knob::scooby_reward_hbw_out_of_bounds << endl
 		<< "scooby_reward_hbw_tracker_hit " << knob::scooby_reward_hbw_tracker_hit << endl
+		<< "scooby_reward_hbw_dropped " << knob::scooby_reward_hbw_dropped << endl
 		<< "scooby_last_pref_offset_conf_thresholds_hbw " << array_to_string(knob::scooby_last_pref_offset_conf_thresholds_hbw) << endl
 		<< "scooby_dyn_degrees_type2_hbw " << array_to_string(knob::scooby_dyn_degrees_type2_hbw) << endl
+		<< "scooby_enable_va " << knob::scooby_enable_va << endl
+		<< "scooby_enable_cross_page " << knob::scooby_enable_cross_page << endl
+		<< "scooby_enable_throttle " << knob::scooby_enable_throttle << endl
+		<< "scooby_enable_dram_telemetry " << knob::scooby_enable_dram_telemetry << endl
+		<< "scooby_enable_huge_page " << knob::scooby_enable_huge_page << endl
+		<< "scooby_enable_translation_prefetch " << knob::scooby_enable_translation_prefetch << endl
+		<< "scooby_throttle_pc_table_size " << knob::scooby_throttle_pc_table_size << endl
+		<< "scooby_throttle_region_table_size " << knob::scooby_throttle_region_table_size << endl
+		<< "scooby_throttle_log2_region_pages " << knob::scooby_throttle_log2_region_pages << endl
+		<< "scooby_throttle_epoch " << knob::scooby_throttle_epoch << endl
+		<< "scooby_throttle_suppress_acc " << knob::scooby_throttle_suppress_acc << endl
+		<< "scooby_throttle_suppress_acc_hbw " << knob::scooby_throttle_suppress_acc_hbw << endl
+		<< "scooby_throttle_boost_acc " << knob::scooby_throttle_boost_acc << endl
+		<< "scooby_throttle_boost_late " << knob::scooby_throttle_boost_late << endl
 		<< endl
 		<< "le_enable_trace " << knob::le_enable_trace << endl
 		<< "le_trace_interval " << knob::le_trace_interval << endl
@@ -283,6 +391,8 @@ void Scooby::print_config()
 		<< "le_featurewise_enable_dyn_action_fallback " << knob::le_featurewise_enable_dyn_action_fallback << endl
 		<< "le_featurewise_bw_acc_check_level " << knob::le_featurewise_bw_acc_check_level << endl
 		<< "le_featurewise_acc_thresh " << knob::le_featurewise_acc_thresh << endl
+		<< "le_featurewise_knowledge_sharing " << knob::le_featurewise_knowledge_sharing << endl
+		<< "le_featurewise_knowledge_merge_epoch " << knob::le_featurewise_knowledge_merge_epoch << endl
 		<< "le_featurewise_enable_trace " << knob::le_featurewise_enable_trace << endl
 		<< "le_featurewise_trace_feature_type " << knob::le_featurewise_trace_feature_type << endl
 		<< "le_featurewise_trace_feature " << knob::le_featurewise_trace_feature << endl
@@ -297,6 +407,27 @@ void Scooby::print_config()
 
 void Scooby::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr)
 {
+	LevelKnobScope scope(this);
+
+	if(knob::scooby_enable_dram_telemetry)
+	{
+		/* use the current utilization of this address's DRAM channel
+		 * instead of the level broadcast at the end of the last epoch */
+		bw_level = dram_bw_level(address);
+		stats.bandwidth.pulled[bw_level]++;
+	}
+
+	if(knob::scooby_enable_va)
+	{
+		/* train and predict on the virtual address stream. An access without
+		 * a virtual address (e.g. a page table line) has no place in it */
+		if(!get_virtual_address(address, address))
+		{
+			stats.translation.untranslated_access++;
+			return;
+		}
+	}
+
 	uint64_t page = address >> LOG2_PAGE_SIZE;
 	uint32_t offset = (address >> LOG2_BLOCK_SIZE) & ((1ull << (LOG2_PAGE_SIZE - LOG2_BLOCK_SIZE)) - 1);
 
@@ -334,7 +465,12 @@ void Scooby::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit,
 	state->acc_level = acc_level;
 
 	uint32_t count = pref_addr.size();
+	pref_conf.assign(count, 0);
 	predict(address, page, offset, state, pref_addr);
+	if(knob::scooby_enable_va)
+	{
+		translate_prefetches(pref_addr, count);
+	}
 	stats.pref_issue.scooby += (pref_addr.size() - count);
 }
 
@@ -393,11 +529,13 @@ uint32_t Scooby::predict(uint64_t base_address, uint64_t page, uint32_t offset,
 	uint32_t action_index = 0;
 	uint32_t pref_degree = knob::scooby_pref_degree;
 	vector<bool> consensus_vec; // only required for featurewise engine
+	uint32_t conf = 0; /* only the featurewise engine reports a confidence */
 
 	if (knob::scooby_enable_featurewise_engine)
 	{
 		float max_to_avg_q_ratio = 1.0;
 		action_index = brain_featurewise->chooseAction(state, max_to_avg_q_ratio, consensus_vec);
+		conf = get_pref_conf(max_to_avg_q_ratio);
 		if(knob::scooby_enable_dyn_degree)
 		{
 			pref_degree = get_dyn_pref_degree(max_to_avg_q_ratio, page, Actions[action_index]);
@@ -421,26 +559,60 @@ uint32_t Scooby::predict(uint64_t base_address, uint64_t page, uint32_t offset,
 
 	MYLOG("act_idx %u act %d", action_index, Actions[action_index]);
 
+	/* a suppressed prediction is still tracked (and rewarded) to keep
+	 * training the agent and the throttle, but is never issued */
+	ThrottleDecision throttle_decision = throttle ? throttle->get_decision(state->pc, state->page, is_high_bw()) : Throttle_Normal;
+	if(throttle_decision == Throttle_Boost)
+	{
+		pref_degree = min(pref_degree + 1, (uint32_t)MAX_SCOOBY_DEGREE);
+	}
+
 	uint64_t addr = 0xdeadbeef;
 	Scooby_PTEntry *ptentry = NULL;
 	int32_t predicted_offset = 0;
 	if(Actions[action_index] != 0)
 	{
 		predicted_offset = (int32_t)offset + Actions[action_index];
-		if(predicted_offset >=0 && predicted_offset < 64) /* falls within the page */
+		bool in_page = (predicted_offset >=0 && predicted_offset < 64);
+		if(in_page || cross_page_target(page, predicted_offset, addr)) /* falls within the page, or in a mapped neighbour */
 		{
-			addr = (page << LOG2_PAGE_SIZE) + (predicted_offset << LOG2_BLOCK_SIZE);
+			if(in_page)
+			{
+				addr = (page << LOG2_PAGE_SIZE) + (predicted_offset << LOG2_BLOCK_SIZE);
+			}
 			MYLOG("pred_off %d pred_addr %lx", predicted_offset, addr);
 			/* track prefetch */
 			bool new_addr = track(addr, state, action_index, &ptentry);
-			if(new_addr)
+			if(new_addr && throttle_decision == Throttle_Suppress)
+			{
+				ptentry->throttled = true;
+				stats.predict.throttled++;
+				ptentry->consensus_vec = consensus_vec;
+			}
+			else if(new_addr)
 			{
 				pref_addr.push_back(addr);
+				append_pref_conf(pref_addr.size(), conf);
 				track_in_st(page, predicted_offset, Actions[action_index]);
 				stats.predict.issue_dist[action_index]++;
+				if(!in_page)
+				{
+					ptentry->cross_page = true;
+					stats.predict.cross_page++;
+				}
 				if(pref_degree > 1)
 				{
 					gen_multi_degree_pref(page, offset, Actions[action_index], pref_degree, pref_addr);
+					/* the deeper prefetches of a stream are one level less certain */
+					if(pf_conf_valid(conf))
+					{
+						uint32_t level = pf_conf_level(conf);
+						append_pref_conf(pref_addr.size(), pf_conf_encode(0, level ? level - 1 : 0));
+					}
+					else
+					{
+						append_pref_conf(pref_addr.size(), 0);
+					}
 				}
 				stats.predict.deg_histogram[pref_degree]++;
 				ptentry->consensus_vec = consensus_vec;
@@ -557,9 +729,17 @@ void Scooby::gen_multi_degree_pref(uint64_t page, uint32_t offset, int32_t actio
 		for(uint32_t degree = 2; degree <= pref_degree; ++degree)
 		{
 			predicted_offset = (int32_t)offset + degree * action;
-			if(predicted_offset >=0 && predicted_offset < 64)
+			bool in_page = (predicted_offset >=0 && predicted_offset < 64);
+			if(in_page || cross_page_target(page, predicted_offset, addr))
 			{
-				addr = (page << LOG2_PAGE_SIZE) + (predicted_offset << LOG2_BLOCK_SIZE);
+				if(in_page)
+				{
+					addr = (page << LOG2_PAGE_SIZE) + (predicted_offset << LOG2_BLOCK_SIZE);
+				}
+				else
+				{
+					stats.predict.cross_page++;
+				}
 				pref_addr.push_back(addr);
 				MYLOG("degree %u pred_off %d pred_addr %lx", degree, predicted_offset, addr);
 				stats.predict.multi_deg++;
@@ -569,6 +749,40 @@ void Scooby::gen_multi_degree_pref(uint64_t page, uint32_t offset, int32_t actio
 	}
 }
 
+/* The confidence level of a prediction is the number of
+ * scooby_pf_conf_q_ratio_thresholds its max-to-average Q-value ratio exceeds.
+ * An explored action has a ratio of 0, hence the lowest level. */
+uint32_t Scooby::get_pref_conf(float max_to_avg_q_ratio)
+{
+	if(knob::scooby_pf_conf_q_ratio_thresholds.empty())
+	{
+		return 0;
+	}
+
+	uint32_t level = 0;
+	for(uint32_t index = 0; index < knob::scooby_pf_conf_q_ratio_thresholds.size() && level < PF_CONF_LEVELS - 1; ++index)
+	{
+		if(max_to_avg_q_ratio > knob::scooby_pf_conf_q_ratio_thresholds[index])
+		{
+			level++;
+		}
+	}
+	return pf_conf_encode(0, level);
+}
+
+/* tags every prefetch up to the given size of pref_addr with the metadata */
+void Scooby::append_pref_conf(uint32_t size, uint32_t metadata)
+{
+	while(pref_conf.size() < size)
+	{
+		pref_conf.push_back(metadata);
+		if(pf_conf_valid(metadata))
+		{
+			stats.predict.conf_level[pf_conf_level(metadata)]++;
+		}
+	}
+}
+
 uint32_t Scooby::get_dyn_pref_degree(float max_to_avg_q_ratio, uint64_t page, int32_t action)
 {
 	uint32_t counted = false;
@@ -709,9 +923,19 @@ void Scooby::assign_reward(Scooby_PTEntry *ptentry, RewardType type)
 		case RewardType::none: 				stats.reward.no_pref++; break;
 		case RewardType::out_of_bounds: 	stats.reward.out_of_bounds++; break;
 		case RewardType::tracker_hit: 		stats.reward.tracker_hit++; break;
+		case RewardType::dropped: 			stats.reward.dropped++; break;
 		default:							assert(false);
 	}
 	stats.reward.dist[ptentry->action_index][type]++;
+	if(ptentry->cross_page)
+	{
+		stats.reward.cross_page_dist[type]++;
+	}
+	/* a dropped prefetch says nothing about accuracy */
+	if(throttle && ptentry->address != 0xdeadbeef && type != RewardType::dropped)
+	{
+		throttle->record_reward(ptentry->state->pc, ptentry->state->page, type, ptentry->throttled);
+	}
 }
 
 int32_t Scooby::compute_reward(Scooby_PTEntry *ptentry, RewardType type)
@@ -745,6 +969,10 @@ int32_t Scooby::compute_reward(Scooby_PTEntry *ptentry, RewardType type)
 	{
 		reward = high_bw ? knob::scooby_reward_hbw_tracker_hit : knob::scooby_reward_tracker_hit;
 	}
+	else if(type == RewardType::dropped)
+	{
+		reward = high_bw ? knob::scooby_reward_hbw_dropped : knob::scooby_reward_dropped;
+	}
 	else
 	{
 		cout << "Invalid reward type found " << type << endl;
@@ -788,6 +1016,14 @@ void Scooby::train(Scooby_PTEntry *curr_evicted, Scooby_PTEntry *last_evicted)
  * Do we need to set it for everyone? */
 void Scooby::register_fill(uint64_t address)
 {
+	LevelKnobScope scope(this);
+
+	if(knob::scooby_enable_va && !get_virtual_address(address, address))
+	{
+		/* no prefetch was tracked under an address without a virtual one */
+		return;
+	}
+
 	MYLOG("fill @ %lx", address);
 
 	stats.register_fill.called++;
@@ -806,6 +1042,14 @@ void Scooby::register_fill(uint64_t address)
 
 void Scooby::register_prefetch_hit(uint64_t address)
 {
+	LevelKnobScope scope(this);
+
+	if(knob::scooby_enable_va && !get_virtual_address(address, address))
+	{
+		/* no prefetch was tracked under an address without a virtual one */
+		return;
+	}
+
 	MYLOG("pref_hit @ %lx", address);
 
 	stats.register_prefetch_hit.called++;
@@ -822,6 +1066,34 @@ void Scooby::register_prefetch_hit(uint64_t address)
 	}
 }
 
+/* The memory controller dropped a prefetch to this address before servicing it.
+ * Reward the prediction now, so that a later demand to the address does not
+ * credit it as a correct but late prefetch. */
+void Scooby::register_drop(uint64_t address)
+{
+	LevelKnobScope scope(this);
+
+	if(knob::scooby_enable_va && !get_virtual_address(address, address))
+	{
+		/* no prefetch was tracked under an address without a virtual one */
+		return;
+	}
+
+	MYLOG("drop @ %lx", address);
+
+	stats.register_drop.called++;
+	vector<Scooby_PTEntry*> ptentries = search_pt(address, knob::scooby_enable_reward_all);
+	for(uint32_t index = 0; index < ptentries.size(); ++index)
+	{
+		if(!ptentries[index]->has_reward && !ptentries[index]->is_filled)
+		{
+			stats.register_drop.rewarded++;
+			assign_reward(ptentries[index], RewardType::dropped);
+			MYLOG("assigned reward dropped(%d)", ptentries[index]->reward);
+		}
+	}
+}
+
 vector<Scooby_PTEntry*> Scooby::search_pt(uint64_t address, bool search_all)
 {
 	vector<Scooby_PTEntry*> entries;
@@ -890,13 +1162,94 @@ int32_t Scooby::getAction(uint32_t action_index)
 	return Actions[action_index];
 }
 
-void Scooby::track_in_st(uint64_t page, uint32_t pred_offset, int32_t pref_offset)
+void Scooby::track_in_st(uint64_t page, int32_t pred_offset, int32_t pref_offset)
 {
 	auto st_index = find_if(signature_table.begin(), signature_table.end(), [page](Scooby_STEntry *stentry){return stentry->page == page;});
 	if(st_index != signature_table.end())
 	{
-		(*st_index)->track_prefetch(pred_offset, pref_offset);
+		if(pred_offset >= 0 && pred_offset < 64)
+		{
+			(*st_index)->track_prefetch(pred_offset, pref_offset);
+		}
+		else
+		{
+			/* cross-page prefetch: only feeds the degree confidence */
+			(*st_index)->insert_action_tracker(pref_offset);
+		}
+	}
+}
+
+/* Shadow translation through the page table: used when Scooby runs on
+ * virtual addresses behind a physically-addressed cache */
+bool Scooby::get_virtual_address(uint64_t address, uint64_t &va)
+{
+	if(lookup_pa_to_va(address, va))
+	{
+		stats.translation.pa_to_va++;
+		return true;
 	}
+	stats.translation.pa_to_va_miss++;
+	return false;
+}
+
+/* converts the virtual prefetch addresses generated from index start onwards
+ * into physical ones, dropping the ones whose page is not mapped */
+void Scooby::translate_prefetches(vector<uint64_t> &pref_addr, uint32_t start)
+{
+	uint32_t valid = start;
+	uint64_t pa = 0;
+	for(uint32_t index = start; index < pref_addr.size(); ++index)
+	{
+		if(lookup_va_to_pa(cpu, pref_addr[index], pa))
+		{
+			stats.translation.va_to_pa++;
+			pref_conf[valid] = pref_conf[index];
+			pref_addr[valid++] = pa;
+		}
+		else
+		{
+			stats.translation.va_to_pa_miss++;
+		}
+	}
+	pref_addr.resize(valid);
+	pref_conf.resize(valid);
+}
+
+/* A prediction that leaves the page is only meaningful in the virtual
+ * address space, and only if the target page is already mapped:
+ * prefetches never cause page faults. A physical page that is part of
+ * a 2MB frame can be left too, as long as the target stays in the frame. */
+bool Scooby::cross_page_target(uint64_t page, int32_t predicted_offset, uint64_t &addr)
+{
+	addr = (page << LOG2_PAGE_SIZE) + (int64_t)predicted_offset * BLOCK_SIZE;
+	if(knob::scooby_enable_huge_page && !knob::scooby_enable_va)
+	{
+		if((addr >> LOG2_HUGE_PAGE_SIZE) == (page >> (LOG2_HUGE_PAGE_SIZE - LOG2_PAGE_SIZE))
+			&& lookup_page_shift(page << LOG2_PAGE_SIZE) == LOG2_HUGE_PAGE_SIZE)
+		{
+			stats.predict.cross_page_huge++;
+			return true;
+		}
+		return false;
+	}
+
+	if(!knob::scooby_enable_cross_page)
+	{
+		return false;
+	}
+
+	uint64_t pa = 0;
+	if(!lookup_va_to_pa(cpu, addr, pa))
+	{
+		stats.predict.cross_page_unmapped++;
+		return false;
+	}
+	/* have the STLB walk the new page before the demand access gets there */
+	if(knob::scooby_enable_translation_prefetch)
+	{
+		request_translation(cpu, addr);
+	}
+	return true;
 }
 
 void Scooby::update_bw(uint8_t bw)
@@ -930,36 +1283,47 @@ bool Scooby::is_high_bw()
 
 void Scooby::dump_stats()
 {
-	cout << "scooby_st_lookup " << stats.st.lookup << endl
-		<< "scooby_st_hit " << stats.st.hit << endl
-		<< "scooby_st_evict " << stats.st.evict << endl
-		<< "scooby_st_insert " << stats.st.insert << endl
-		<< "scooby_st_streaming " << stats.st.streaming << endl
+	LevelKnobScope scope(this);
+
+	cout << stats_prefix << "_st_lookup " << stats.st.lookup << endl
+		<< stats_prefix << "_st_hit " << stats.st.hit << endl
+		<< stats_prefix << "_st_evict " << stats.st.evict << endl
+		<< stats_prefix << "_st_insert " << stats.st.insert << endl
+		<< stats_prefix << "_st_streaming " << stats.st.streaming << endl
 		<< endl
 
-		<< "scooby_predict_called " << stats.predict.called << endl
-		// << "scooby_predict_shaggy_called " << stats.predict.shaggy_called << endl
-		<< "scooby_predict_out_of_bounds " << stats.predict.out_of_bounds << endl;
+		<< stats_prefix << "_predict_called " << stats.predict.called << endl
+		// << stats_prefix << "_predict_shaggy_called " << stats.predict.shaggy_called << endl
+		<< stats_prefix << "_predict_out_of_bounds " << stats.predict.out_of_bounds << endl;
 
 	for(uint32_t index = 0; index < Actions.size(); ++index)
 	{
-		cout << "scooby_predict_action_" << Actions[index] << " " << stats.predict.action_dist[index] << endl;
-		cout << "scooby_predict_issue_action_" << Actions[index] << " " << stats.predict.issue_dist[index] << endl;
-		cout << "scooby_predict_hit_action_" << Actions[index] << " " << stats.predict.pred_hit[index] << endl;
-		cout << "scooby_predict_out_of_bounds_action_" << Actions[index] << " " << stats.predict.out_of_bounds_dist[index] << endl;
+		cout << stats_prefix << "_predict_action_" << Actions[index] << " " << stats.predict.action_dist[index] << endl;
+		cout << stats_prefix << "_predict_issue_action_" << Actions[index] << " " << stats.predict.issue_dist[index] << endl;
+		cout << stats_prefix << "_predict_hit_action_" << Actions[index] << " " << stats.predict.pred_hit[index] << endl;
+		cout << stats_prefix << "_predict_out_of_bounds_action_" << Actions[index] << " " << stats.predict.out_of_bounds_dist[index] << endl;
+	}
+
+	cout << stats_prefix << "_predict_cross_page " << stats.predict.cross_page << endl
+		<< stats_prefix << "_predict_cross_page_unmapped " << stats.predict.cross_page_unmapped << endl
+		<< stats_prefix << "_predict_cross_page_huge " << stats.predict.cross_page_huge << endl
+		<< stats_prefix << "_predict_throttled " << stats.predict.throttled << endl;
+	for(uint32_t index = 0; index < PF_CONF_LEVELS; ++index)
+	{
+		cout << stats_prefix << "_predict_conf_level_" << index << " " << stats.predict.conf_level[index] << endl;
 	}
 
-	cout << "scooby_predict_multi_deg_called " << stats.predict.multi_deg_called << endl
-		<< "scooby_predict_predicted " << stats.predict.predicted << endl
-		<< "scooby_predict_multi_deg " << stats.predict.multi_deg << endl;
+	cout << stats_prefix << "_predict_multi_deg_called " << stats.predict.multi_deg_called << endl
+		<< stats_prefix << "_predict_predicted " << stats.predict.predicted << endl
+		<< stats_prefix << "_predict_multi_deg " << stats.predict.multi_deg << endl;
 	for(uint32_t index = 2; index <= MAX_SCOOBY_DEGREE; ++index)
 	{
-		cout << "scooby_predict_multi_deg_" << index << " " << stats.predict.multi_deg_histogram[index] << endl;
+		cout << stats_prefix << "_predict_multi_deg_" << index << " " << stats.predict.multi_deg_histogram[index] << endl;
 	}
 	cout << endl;
 	for(uint32_t index = 1; index <= MAX_SCOOBY_DEGREE; ++index)
 	{
-		cout << "scooby_selected_deg_" << index << " " << stats.predict.deg_histogram[index] << endl;
+		cout << stats_prefix << "_selected_deg_" << index << " " << stats.predict.deg_histogram[index] << endl;
 	}
 	cout << endl;
 
@@ -973,7 +1337,7 @@ void Scooby::dump_stats()
 			sort(pairs.begin(), pairs.end(), [](std::pair<string, vector<uint64_t>>& a, std::pair<string, vector<uint64_t>>& b){return a.second[knob::scooby_max_actions] > b.second[knob::scooby_max_actions];});
 			for(auto it = pairs.begin(); it != pairs.end(); ++it)
 			{
-				cout << "scooby_state_" << hex << it->first << dec << " ";
+				cout << stats_prefix << "_state_" << hex << it->first << dec << " ";
 				for(uint32_t index = 0; index < it->second.size(); ++index)
 				{
 					cout << it->second[index] << ",";
@@ -985,7 +1349,7 @@ void Scooby::dump_stats()
 		{
 			for(auto it = state_action_dist.begin(); it != state_action_dist.end(); ++it)
 			{
-				cout << "scooby_state_" << hex << it->first << dec << " ";
+				cout << stats_prefix << "_state_" << hex << it->first << dec << " ";
 				for(uint32_t index = 0; index < it->second.size(); ++index)
 				{
 					cout << it->second[index] << ",";
@@ -998,7 +1362,7 @@ void Scooby::dump_stats()
 
 	for(auto it = action_deg_dist.begin(); it != action_deg_dist.end(); ++it)
 	{
-		cout << "scooby_action_" << it->first << "_deg_dist ";
+		cout << stats_prefix << "_action_" << it->first << "_deg_dist ";
 		for(uint32_t index = 0; index < MAX_SCOOBY_DEGREE; ++index)
 		{
 			cout << it->second[index] << ",";
@@ -1007,36 +1371,45 @@ void Scooby::dump_stats()
 	}
 	cout << endl;
 
-	cout << "scooby_track_called " << stats.track.called << endl
-		<< "scooby_track_same_address " << stats.track.same_address << endl
-		<< "scooby_track_evict " << stats.track.evict << endl
+	cout << stats_prefix << "_track_called " << stats.track.called << endl
+		<< stats_prefix << "_track_same_address " << stats.track.same_address << endl
+		<< stats_prefix << "_track_evict " << stats.track.evict << endl
 		<< endl
 
-		<< "scooby_reward_demand_called " << stats.reward.demand.called << endl
-		<< "scooby_reward_demand_pt_not_found " << stats.reward.demand.pt_not_found << endl
-		<< "scooby_reward_demand_pt_found " << stats.reward.demand.pt_found << endl
-		<< "scooby_reward_demand_pt_found_total " << stats.reward.demand.pt_found_total << endl
-		<< "scooby_reward_demand_has_reward " << stats.reward.demand.has_reward << endl
-		<< "scooby_reward_train_called " << stats.reward.train.called << endl
-		<< "scooby_reward_assign_reward_called " << stats.reward.assign_reward.called << endl
-		<< "scooby_reward_no_pref " << stats.reward.no_pref << endl
-		<< "scooby_reward_incorrect " << stats.reward.incorrect << endl
-		<< "scooby_reward_correct_untimely " << stats.reward.correct_untimely << endl
-		<< "scooby_reward_correct_timely " << stats.reward.correct_timely << endl
-		<< "scooby_reward_out_of_bounds " << stats.reward.out_of_bounds << endl
-		<< "scooby_reward_tracker_hit " << stats.reward.tracker_hit << endl
+		<< stats_prefix << "_reward_demand_called " << stats.reward.demand.called << endl
+		<< stats_prefix << "_reward_demand_pt_not_found " << stats.reward.demand.pt_not_found << endl
+		<< stats_prefix << "_reward_demand_pt_found " << stats.reward.demand.pt_found << endl
+		<< stats_prefix << "_reward_demand_pt_found_total " << stats.reward.demand.pt_found_total << endl
+		<< stats_prefix << "_reward_demand_has_reward " << stats.reward.demand.has_reward << endl
+		<< stats_prefix << "_reward_train_called " << stats.reward.train.called << endl
+		<< stats_prefix << "_reward_assign_reward_called " << stats.reward.assign_reward.called << endl
+		<< stats_prefix << "_reward_no_pref " << stats.reward.no_pref << endl
+		<< stats_prefix << "_reward_incorrect " << stats.reward.incorrect << endl
+		<< stats_prefix << "_reward_correct_untimely " << stats.reward.correct_untimely << endl
+		<< stats_prefix << "_reward_correct_timely " << stats.reward.correct_timely << endl
+		<< stats_prefix << "_reward_out_of_bounds " << stats.reward.out_of_bounds << endl
+		<< stats_prefix << "_reward_tracker_hit " << stats.reward.tracker_hit << endl
+		<< stats_prefix << "_reward_dropped " << stats.reward.dropped << endl
+		<< stats_prefix << "_register_drop_called " << stats.register_drop.called << endl
+		<< stats_prefix << "_register_drop_rewarded " << stats.register_drop.rewarded << endl
 		<< endl;
 
 	for(uint32_t reward = 0; reward < RewardType::num_rewards; ++reward)
 	{
-		cout << "scooby_reward_" << getRewardTypeString((RewardType)reward) << "_low_bw " << stats.reward.compute_reward.dist[reward][0] << endl
-			<< "scooby_reward_" << getRewardTypeString((RewardType)reward) << "_high_bw " << stats.reward.compute_reward.dist[reward][1] << endl;
+		cout << stats_prefix << "_reward_" << getRewardTypeString((RewardType)reward) << "_low_bw " << stats.reward.compute_reward.dist[reward][0] << endl
+			<< stats_prefix << "_reward_" << getRewardTypeString((RewardType)reward) << "_high_bw " << stats.reward.compute_reward.dist[reward][1] << endl;
+	}
+	cout << endl;
+
+	for(uint32_t reward = 0; reward < RewardType::num_rewards; ++reward)
+	{
+		cout << stats_prefix << "_reward_cross_page_" << getRewardTypeString((RewardType)reward) << " " << stats.reward.cross_page_dist[reward] << endl;
 	}
 	cout << endl;
 
 	for(uint32_t action = 0; action < Actions.size(); ++action)
 	{
-		cout << "scooby_reward_" << Actions[action] << " ";
+		cout << stats_prefix << "_reward_" << Actions[action] << " ";
 		for(uint32_t reward = 0; reward < RewardType::num_rewards; ++reward)
 		{
 			cout << stats.reward.dist[action][reward] << ",";
@@ -1046,22 +1419,29 @@ void Scooby::dump_stats()
 
 
 	cout << endl
-		<< "scooby_train_called " << stats.train.called << endl
-		<< "scooby_train_compute_reward " << stats.train.compute_reward << endl
+		<< stats_prefix << "_train_called " << stats.train.called << endl
+		<< stats_prefix << "_train_compute_reward " << stats.train.compute_reward << endl
 		<< endl
 
-		<< "scooby_register_fill_called " << stats.register_fill.called << endl
-		<< "scooby_register_fill_set " << stats.register_fill.set << endl
-		<< "scooby_register_fill_set_total " << stats.register_fill.set_total << endl
+		<< stats_prefix << "_register_fill_called " << stats.register_fill.called << endl
+		<< stats_prefix << "_register_fill_set " << stats.register_fill.set << endl
+		<< stats_prefix << "_register_fill_set_total " << stats.register_fill.set_total << endl
 		<< endl
 
-		<< "scooby_register_prefetch_hit_called " << stats.register_prefetch_hit.called << endl
-		<< "scooby_register_prefetch_hit_set " << stats.register_prefetch_hit.set << endl
-		<< "scooby_register_prefetch_hit_set_total " << stats.register_prefetch_hit.set_total << endl
+		<< stats_prefix << "_register_prefetch_hit_called " << stats.register_prefetch_hit.called << endl
+		<< stats_prefix << "_register_prefetch_hit_set " << stats.register_prefetch_hit.set << endl
+		<< stats_prefix << "_register_prefetch_hit_set_total " << stats.register_prefetch_hit.set_total << endl
 		<< endl
 
-		<< "scooby_pref_issue_scooby " << stats.pref_issue.scooby << endl
-		// << "scooby_pref_issue_shaggy " << stats.pref_issue.shaggy << endl
+		<< stats_prefix << "_pref_issue_scooby " << stats.pref_issue.scooby << endl
+		// << stats_prefix << "_pref_issue_shaggy " << stats.pref_issue.shaggy << endl
+		<< endl
+
+		<< stats_prefix << "_translation_pa_to_va " << stats.translation.pa_to_va << endl
+		<< stats_prefix << "_translation_pa_to_va_miss " << stats.translation.pa_to_va_miss << endl
+		<< stats_prefix << "_translation_untranslated_access " << stats.translation.untranslated_access << endl
+		<< stats_prefix << "_translation_va_to_pa " << stats.translation.va_to_pa << endl
+		<< stats_prefix << "_translation_va_to_pa_miss " << stats.translation.va_to_pa_miss << endl
 		<< endl;
 
 	std::vector<std::pair<string, uint64_t>> pairs;
@@ -1083,24 +1463,33 @@ void Scooby::dump_stats()
 	}
 	recorder->dump_stats();
 
-	cout << "scooby_bw_epochs " << stats.bandwidth.epochs << endl;
+	cout << stats_prefix << "_bw_epochs " << stats.bandwidth.epochs << endl;
+	for(uint32_t index = 0; index < DRAM_BW_LEVELS; ++index)
+	{
+		cout << stats_prefix << "_bw_level_" << index << " " << stats.bandwidth.histogram[index] << endl;
+	}
 	for(uint32_t index = 0; index < DRAM_BW_LEVELS; ++index)
 	{
-		cout << "scooby_bw_level_" << index << " " << stats.bandwidth.histogram[index] << endl;
+		cout << stats_prefix << "_bw_level_pulled_" << index << " " << stats.bandwidth.pulled[index] << endl;
 	}
 	cout << endl;
 
-	cout << "scooby_ipc_epochs " << stats.ipc.epochs << endl;
+	cout << stats_prefix << "_ipc_epochs " << stats.ipc.epochs << endl;
 	for(uint32_t index = 0; index < SCOOBY_MAX_IPC_LEVEL; ++index)
 	{
-		cout << "scooby_ipc_level_" << index << " " << stats.ipc.histogram[index] << endl;
+		cout << stats_prefix << "_ipc_level_" << index << " " << stats.ipc.histogram[index] << endl;
 	}
 	cout << endl;
 
-	cout << "scooby_cache_acc_epochs " << stats.cache_acc.epochs << endl;
+	cout << stats_prefix << "_cache_acc_epochs " << stats.cache_acc.epochs << endl;
 	for(uint32_t index = 0; index < CACHE_ACC_LEVELS; ++index)
 	{
-		cout << "scooby_cache_acc_level_" << index << " " << stats.cache_acc.histogram[index] << endl;
+		cout << stats_prefix << "_cache_acc_level_" << index << " " << stats.cache_acc.histogram[index] << endl;
 	}
 	cout << endl;
+
+	if(throttle)
+	{
+		throttle->dump_stats(stats_prefix, is_high_bw());
+	}
 }
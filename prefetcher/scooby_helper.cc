@@ -39,6 +39,12 @@ namespace knob
 	extern bool     scooby_enable_dyn_degree_detector;
 	extern bool     scooby_print_trace;
 	extern uint32_t scooby_action_tracker_size;
+	extern uint32_t scooby_throttle_log2_region_pages;
+	extern uint32_t scooby_throttle_epoch;
+	extern float    scooby_throttle_suppress_acc;
+	extern float    scooby_throttle_suppress_acc_hbw;
+	extern float    scooby_throttle_boost_acc;
+	extern float    scooby_throttle_boost_late;
 }
 
 uint32_t debug_print_count = 0;
@@ -50,7 +56,7 @@ const char* getFeatureString(Feature feature)
 	return MapFeatureString[(uint32_t)feature];
 }
 
-const char* MapRewardTypeString[] = {"none", "incorrect", "correct_untimely", "correct_timely", "out_of_bounds", "tracker_hit"};
+const char* MapRewardTypeString[] = {"none", "incorrect", "correct_untimely", "correct_timely", "out_of_bounds", "tracker_hit", "dropped"};
 const char* getRewardTypeString(RewardType type)
 {
 	assert(type < RewardType::num_rewards);
@@ -553,3 +559,145 @@ string print_active_features2(vector<int32_t> features)
 	}
 	return ss.str();
 }
+
+ScoobyThrottle::ScoobyThrottle(uint32_t pc_table_size, uint32_t region_table_size)
+{
+	assert(pc_table_size && region_table_size);
+	pc_table.resize(pc_table_size);
+	region_table.resize(region_table_size);
+	bzero(&stats, sizeof(stats));
+}
+
+ScoobyThrottleEntry* ScoobyThrottle::get_entry(vector<ScoobyThrottleEntry> &table, uint64_t key, bool allocate, uint64_t &evict)
+{
+	ScoobyThrottleEntry *entry = &table[key % table.size()];
+	if(entry->valid && entry->tag == key)
+	{
+		return entry;
+	}
+	if(!allocate)
+	{
+		return NULL;
+	}
+	if(entry->valid)
+	{
+		evict++;
+	}
+	entry->reset(key);
+	return entry;
+}
+
+void ScoobyThrottle::update_entry(ScoobyThrottleEntry *entry, RewardType type, bool throttled, uint64_t &epochs)
+{
+	if(isRewardCorrect(type))
+	{
+		entry->correct++;
+		/* a throttled prediction was never issued, so it says nothing about timeliness */
+		if(!throttled)
+		{
+			if(type == RewardType::correct_timely) entry->timely++;
+			else entry->untimely++;
+		}
+	}
+	else
+	{
+		entry->incorrect++;
+	}
+
+	if(entry->correct + entry->incorrect >= knob::scooby_throttle_epoch)
+	{
+		entry->accuracy = (float)entry->correct / (entry->correct + entry->incorrect);
+		entry->lateness = (entry->timely + entry->untimely) ? (float)entry->untimely / (entry->timely + entry->untimely) : 0.0;
+		entry->trained = true;
+		entry->correct = entry->incorrect = entry->timely = entry->untimely = 0;
+		epochs++;
+	}
+}
+
+ThrottleDecision ScoobyThrottle::decide(ScoobyThrottleEntry *entry, bool high_bw)
+{
+	if(!entry || !entry->trained)
+	{
+		return Throttle_Normal;
+	}
+	if(entry->accuracy < (high_bw ? knob::scooby_throttle_suppress_acc_hbw : knob::scooby_throttle_suppress_acc))
+	{
+		return Throttle_Suppress;
+	}
+	if(entry->accuracy >= knob::scooby_throttle_boost_acc && entry->lateness >= knob::scooby_throttle_boost_late)
+	{
+		return Throttle_Boost;
+	}
+	return Throttle_Normal;
+}
+
+/* Suppression from either table wins over a boost from the other */
+ThrottleDecision ScoobyThrottle::get_decision(uint64_t pc, uint64_t page, bool high_bw)
+{
+	uint64_t dummy = 0;
+	stats.lookup++;
+	ThrottleDecision pc_decision = decide(get_entry(pc_table, pc, false, dummy), high_bw);
+	ThrottleDecision region_decision = decide(get_entry(region_table, page >> knob::scooby_throttle_log2_region_pages, false, dummy), high_bw);
+
+	ThrottleDecision decision = Throttle_Normal;
+	if(pc_decision == Throttle_Suppress || region_decision == Throttle_Suppress)
+	{
+		decision = Throttle_Suppress;
+		if(pc_decision == Throttle_Suppress) stats.suppress_pc++;
+		if(region_decision == Throttle_Suppress) stats.suppress_region++;
+	}
+	else if(pc_decision == Throttle_Boost || region_decision == Throttle_Boost)
+	{
+		decision = Throttle_Boost;
+		if(pc_decision == Throttle_Boost) stats.boost_pc++;
+		if(region_decision == Throttle_Boost) stats.boost_region++;
+	}
+	stats.decision[decision]++;
+	return decision;
+}
+
+void ScoobyThrottle::record_reward(uint64_t pc, uint64_t page, RewardType type, bool throttled)
+{
+	if(!isRewardCorrect(type) && !isRewardIncorrect(type))
+	{
+		return;
+	}
+	stats.rewards++;
+	update_entry(get_entry(pc_table, pc, true, stats.evict_pc), type, throttled, stats.epochs_pc);
+	update_entry(get_entry(region_table, page >> knob::scooby_throttle_log2_region_pages, true, stats.evict_region), type, throttled, stats.epochs_region);
+}
+
+uint32_t ScoobyThrottle::count_decisions(vector<ScoobyThrottleEntry> &table, ThrottleDecision decision, bool high_bw)
+{
+	uint32_t count = 0;
+	for(uint32_t index = 0; index < table.size(); ++index)
+	{
+		if(table[index].valid && decide(&table[index], high_bw) == decision)
+		{
+			count++;
+		}
+	}
+	return count;
+}
+
+void ScoobyThrottle::dump_stats(string prefix, bool high_bw)
+{
+	cout << prefix << "_throttle_lookup " << stats.lookup << endl
+		<< prefix << "_throttle_normal " << stats.decision[Throttle_Normal] << endl
+		<< prefix << "_throttle_suppress " << stats.decision[Throttle_Suppress] << endl
+		<< prefix << "_throttle_boost " << stats.decision[Throttle_Boost] << endl
+		<< prefix << "_throttle_suppress_by_pc " << stats.suppress_pc << endl
+		<< prefix << "_throttle_suppress_by_region " << stats.suppress_region << endl
+		<< prefix << "_throttle_boost_by_pc " << stats.boost_pc << endl
+		<< prefix << "_throttle_boost_by_region " << stats.boost_region << endl
+		<< prefix << "_throttle_rewards " << stats.rewards << endl
+		<< prefix << "_throttle_epochs_pc " << stats.epochs_pc << endl
+		<< prefix << "_throttle_epochs_region " << stats.epochs_region << endl
+		<< prefix << "_throttle_evict_pc " << stats.evict_pc << endl
+		<< prefix << "_throttle_evict_region " << stats.evict_region << endl
+		<< prefix << "_throttle_final_suppressed_pcs " << count_decisions(pc_table, Throttle_Suppress, high_bw) << endl
+		<< prefix << "_throttle_final_boosted_pcs " << count_decisions(pc_table, Throttle_Boost, high_bw) << endl
+		<< prefix << "_throttle_final_suppressed_regions " << count_decisions(region_table, Throttle_Suppress, high_bw) << endl
+		<< prefix << "_throttle_final_boosted_regions " << count_decisions(region_table, Throttle_Boost, high_bw) << endl
+		<< endl;
+}
@@ -110,7 +110,9 @@ void SPP_dev2::invoke_prefetcher(uint64_t ip, uint64_t addr, uint8_t cache_hit,
 
                 if ((addr & ~(PAGE_SIZE - 1)) == (pf_addr & ~(PAGE_SIZE - 1))) { // Prefetch request is in the same physical page
                     if (FILTER.check(pf_addr, confidence_q[i] >= knob::spp_dev2_fill_threshold ? SPP_L2C_PREFETCH : SPP_LLC_PREFETCH, GHR)) {
-                        m_parent_cache->prefetch_line(ip, addr, pf_addr, ((confidence_q[i] >= knob::spp_dev2_fill_threshold) ? FILL_L2 : FILL_LLC), 0); // Use addr (not base_addr) to obey the same physical page boundary
+                        // The path confidence (0-100) doubles as the confidence level for the insertion policy
+                        uint32_t pf_metadata = pf_conf_encode(0, confidence_q[i] * PF_CONF_LEVELS / 101);
+                        m_parent_cache->prefetch_line(ip, addr, pf_addr, ((confidence_q[i] >= knob::spp_dev2_fill_threshold) ? FILL_L2 : FILL_LLC), pf_metadata); // Use addr (not base_addr) to obey the same physical page boundary
                         
                         stats.pref.total++;
                         if(confidence_q[i] >= knob::spp_dev2_fill_threshold) 
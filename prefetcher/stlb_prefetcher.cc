@@ -0,0 +1,21 @@
+#include "cache.h"
+
+void CACHE::stlb_prefetcher_initialize()
+{
+
+}
+
+void CACHE::stlb_prefetcher_operate(uint64_t vpage, uint64_t ip, uint8_t cache_hit, uint8_t type)
+{
+
+}
+
+void CACHE::stlb_prefetcher_final_stats()
+{
+
+}
+
+void CACHE::stlb_prefetcher_print_config()
+{
+
+}
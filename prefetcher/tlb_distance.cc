@@ -0,0 +1,134 @@
+#include <assert.h>
+#include <strings.h>
+#include <algorithm>
+#include <iostream>
+#include "tlb_distance.h"
+
+namespace knob
+{
+   extern uint32_t tlb_distance_table_size;
+   extern uint32_t tlb_distance_slots;
+}
+
+void TLBDistancePrefetcher::init_knobs()
+{
+   assert(knob::tlb_distance_slots >= 1 && knob::tlb_distance_slots <= MAX_TLB_DISTANCE_SLOTS);
+}
+
+void TLBDistancePrefetcher::init_stats()
+{
+   bzero(&stats, sizeof(stats));
+}
+
+TLBDistancePrefetcher::TLBDistancePrefetcher(string type) : Prefetcher(type)
+{
+   last_vpage = 0;
+   last_distance = 0;
+   init_knobs();
+   init_stats();
+}
+
+TLBDistancePrefetcher::~TLBDistancePrefetcher()
+{
+
+}
+
+void TLBDistancePrefetcher::print_config()
+{
+   cout << "tlb_distance_table_size " << knob::tlb_distance_table_size << endl
+      << "tlb_distance_slots " << knob::tlb_distance_slots << endl
+      ;
+}
+
+deque<DistanceEntry*>::iterator TLBDistancePrefetcher::search(int64_t distance)
+{
+   return find_if(table.begin(), table.end(), [distance](DistanceEntry *e){return e->distance == distance;});
+}
+
+/* records that distance was followed by next */
+void TLBDistancePrefetcher::train(int64_t distance, int64_t next)
+{
+   DistanceEntry *entry = NULL;
+   auto it = search(distance);
+   if(it == table.end())
+   {
+      if(table.size() >= knob::tlb_distance_table_size)
+      {
+         /* evict */
+         DistanceEntry *victim = table.back();
+         table.pop_back();
+         delete victim;
+         stats.table.evict++;
+      }
+      entry = new DistanceEntry();
+      entry->distance = distance;
+      stats.table.insert++;
+   }
+   else
+   {
+      entry = (*it);
+      table.erase(it);
+   }
+   table.push_front(entry);
+
+   auto slot = find(entry->next.begin(), entry->next.end(), next);
+   if(slot != entry->next.end())
+   {
+      entry->next.erase(slot);
+   }
+   entry->next.insert(entry->next.begin(), next);
+   if(entry->next.size() > knob::tlb_distance_slots)
+   {
+      entry->next.pop_back();
+   }
+}
+
+/* address is the virtual page that missed in the STLB, or hit on a prefetched translation */
+void TLBDistancePrefetcher::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr)
+{
+   uint64_t vpage = address;
+   stats.pref.called++;
+
+   if(last_vpage == 0)
+   {
+      last_vpage = vpage;
+      return;
+   }
+
+   int64_t distance = (int64_t)(vpage - last_vpage);
+   if(distance == 0)
+   {
+      return;
+   }
+   if(last_distance != 0)
+   {
+      train(last_distance, distance);
+   }
+   last_vpage = vpage;
+   last_distance = distance;
+
+   stats.table.lookup++;
+   auto it = search(distance);
+   if(it == table.end())
+   {
+      return;
+   }
+
+   stats.table.hit++;
+   for(uint32_t index = 0; index < (*it)->next.size(); ++index)
+   {
+      pref_addr.push_back(vpage + (*it)->next[index]);
+      stats.pref.generated++;
+   }
+}
+
+void TLBDistancePrefetcher::dump_stats()
+{
+   cout << "tlb_distance_table_lookup " << stats.table.lookup << endl
+      << "tlb_distance_table_evict " << stats.table.evict << endl
+      << "tlb_distance_table_insert " << stats.table.insert << endl
+      << "tlb_distance_table_hit " << stats.table.hit << endl
+      << "tlb_distance_pref_called " << stats.pref.called << endl
+      << "tlb_distance_pref_generated " << stats.pref.generated << endl
+      << endl;
+}
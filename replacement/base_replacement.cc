@@ -1,18 +1,35 @@
 #include "cache.h"
 
+namespace knob
+{
+	extern bool pf_conf_insertion;
+}
+
 uint32_t CACHE::find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type)
 {
     // baseline LRU replacement policy for other caches 
     return lru_victim(cpu, instr_id, set, current_set, ip, full_addr, type); 
 }
 
-void CACHE::update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit)
+void CACHE::update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit, uint32_t metadata)
 {
     if (type == WRITEBACK) {
         if (hit) // wrietback hit does not update LRU state
             return;
     }
 
+    // the less confident the prefetcher was, the closer to LRU its line goes;
+    // such a line moves up on its first demand hit, not on further prefetches
+    if (knob::pf_conf_insertion && ((cache_type == IS_L2C) || (cache_type == IS_LLC)) && (type == PREFETCH) && pf_conf_valid(metadata)) {
+        uint32_t level = pf_conf_level(metadata);
+        if (hit) {
+            if (level < PF_CONF_LEVELS-1)
+                return;
+        }
+        else
+            return lru_insert(set, way, (NUM_WAY-1) * (PF_CONF_LEVELS-1-level) / (PF_CONF_LEVELS-1));
+    }
+
     return lru_update(set, way);
 }
 
@@ -67,6 +84,19 @@ void CACHE::lru_update(uint32_t set, uint32_t way)
     block[set][way].lru = 0; // promote to the MRU position
 }
 
+void CACHE::lru_insert(uint32_t set, uint32_t way, uint32_t position)
+{
+    // move the block to the given LRU stack position, 0 being MRU
+    uint32_t current = block[set][way].lru;
+    for (uint32_t i=0; i<NUM_WAY; i++) {
+        if ((position < current) && (block[set][i].lru >= position) && (block[set][i].lru < current))
+            block[set][i].lru++;
+        else if ((position > current) && (block[set][i].lru > current) && (block[set][i].lru <= position))
+            block[set][i].lru--;
+    }
+    block[set][way].lru = position;
+}
+
 void CACHE::replacement_final_stats()
 {
 
@@ -0,0 +1,77 @@
+#include <assert.h>
+#include <strings.h>
+#include "cache.h"
+#include "drrip.h"
+
+DRRIP::DRRIP(std::string type, uint32_t sets, uint32_t ways, uint32_t num_cpus)
+	: SRRIP(type, sets, ways), picker(sets), sdm(picker, sets, num_cpus, DRRIP_SDM_SIZE, DRRIP_PSEL_WIDTH)
+{
+	bip_counter = 0;
+	bzero(&drrip_stats, sizeof(drrip_stats));
+}
+
+/* runs the BIP vs. SRRIP duel for a fill and returns the insertion RRPV */
+uint8_t DRRIP::insertion_rrpv(uint32_t cpu, uint32_t set)
+{
+	int leader = sdm.leader(cpu, set);
+	if(leader != -1)
+	{
+		sdm.record_miss(cpu, leader);
+	}
+
+	int policy = (leader == -1) ? sdm.winner(cpu) : leader;
+	if(policy == DRRIP_BIP)
+	{
+		drrip_stats.insert_bip++;
+		bip_counter++;
+		if(bip_counter == BIP_MAX)
+			bip_counter = 0;
+		return (bip_counter == 0) ? maxRRPV-1 : maxRRPV;
+	}
+
+	drrip_stats.insert_srrip++;
+	return maxRRPV-1;
+}
+
+void DRRIP::update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit, uint32_t metadata)
+{
+	/* do not update replacement state for writebacks */
+	if(type == WRITEBACK)
+	{
+		rrpv.set(set, way, maxRRPV-1);
+		return;
+	}
+
+	if(pf_conf_update(set, way, type, hit, metadata))
+		return;
+
+	/* for cache hit, DRRIP always promotes a cache line to the MRU position */
+	if(hit)
+	{
+		stats.promote++;
+		rrpv.set(set, way, 0);
+		return;
+	}
+
+	stats.insert++;
+	rrpv.set(set, way, insertion_rrpv(cpu, set));
+}
+
+void DRRIP::dump_stats()
+{
+	SRRIP::dump_stats();
+	cout << type << "_insert_bip " << drrip_stats.insert_bip << endl
+		<< type << "_insert_srrip " << drrip_stats.insert_srrip << endl;
+	for(uint32_t cpu = 0; cpu < NUM_CPUS; ++cpu)
+	{
+		cout << type << "_psel_cpu_" << cpu << " " << sdm.get_psel(cpu) << endl;
+	}
+}
+
+void DRRIP::print_config()
+{
+	SRRIP::print_config();
+	cout << type << "_sdm_size " << DRRIP_SDM_SIZE << endl
+		<< type << "_psel_width " << DRRIP_PSEL_WIDTH << endl
+		<< type << "_bip_max " << BIP_MAX << endl;
+}
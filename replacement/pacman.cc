@@ -0,0 +1,73 @@
+#include <assert.h>
+#include <strings.h>
+#include "cache.h"
+#include "pacman.h"
+
+/* the prefetch duel takes its leader sets from the same picker as the DRRIP
+ * duel, so the two never share a leader set */
+PACMan::PACMan(std::string type, uint32_t sets, uint32_t ways, uint32_t num_cpus)
+	: DRRIP(type, sets, ways, num_cpus), pf_sdm(picker, sets, num_cpus, DRRIP_SDM_SIZE, DRRIP_PSEL_WIDTH)
+{
+	bzero(&pacman_stats, sizeof(pacman_stats));
+}
+
+void PACMan::update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit, uint32_t metadata)
+{
+	if(type == WRITEBACK)
+	{
+		DRRIP::update_replacement_state(cpu, set, way, full_addr, ip, victim_addr, type, hit, metadata);
+		return;
+	}
+
+	int leader = pf_sdm.leader(cpu, set);
+	bool pacman = (leader == -1) ? (pf_sdm.winner(cpu) == PACMAN_HM) : (leader == PACMAN_HM);
+
+	/* only demand misses decide the prefetch duel */
+	if(!hit && leader != -1 && type != PREFETCH)
+	{
+		pf_sdm.record_miss(cpu, leader);
+	}
+
+	if(pf_conf_update(set, way, type, hit, metadata))
+		return;
+
+	if(type == PREFETCH && pacman)
+	{
+		if(hit)
+		{
+			/* PACMan-H: a prefetch hit says nothing about demand reuse */
+			pacman_stats.pf_hit_no_promote++;
+		}
+		else
+		{
+			/* PACMan-M: a prefetched line has to prove itself with a demand hit */
+			pacman_stats.pf_insert_distant++;
+			stats.insert++;
+			rrpv.set(set, way, maxRRPV);
+		}
+		return;
+	}
+
+	if(type == PREFETCH)
+	{
+		pacman_stats.pf_as_demand++;
+	}
+	DRRIP::update_replacement_state(cpu, set, way, full_addr, ip, victim_addr, type, hit, metadata);
+}
+
+void PACMan::dump_stats()
+{
+	DRRIP::dump_stats();
+	cout << type << "_pf_insert_distant " << pacman_stats.pf_insert_distant << endl
+		<< type << "_pf_hit_no_promote " << pacman_stats.pf_hit_no_promote << endl
+		<< type << "_pf_as_demand " << pacman_stats.pf_as_demand << endl;
+	for(uint32_t cpu = 0; cpu < NUM_CPUS; ++cpu)
+	{
+		cout << type << "_pf_psel_cpu_" << cpu << " " << pf_sdm.get_psel(cpu) << endl;
+	}
+}
+
+void PACMan::print_config()
+{
+	DRRIP::print_config();
+}
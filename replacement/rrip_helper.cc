@@ -0,0 +1,229 @@
+#include <assert.h>
+#include "rrip_helper.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+RRPVTable::RRPVTable(uint32_t _sets, uint32_t _ways, uint8_t _max_rrpv)
+{
+	sets = _sets;
+	ways = _ways;
+	stride = (ways + 15) / 16 * 16;
+	max_rrpv = _max_rrpv;
+
+	rrpv.assign(sets * stride, 0);
+	lane_mask.assign(stride, 0);
+	for(uint32_t way = 0; way < ways; ++way)
+	{
+		lane_mask[way] = 0xff;
+		for(uint32_t set = 0; set < sets; ++set)
+		{
+			rrpv[set * stride + way] = max_rrpv;
+		}
+	}
+}
+
+uint32_t RRPVTable::find_victim(uint32_t set)
+{
+	uint8_t *r = &rrpv[set * stride];
+
+	/* Instead of incrementing every way until one reaches max_rrpv, age the
+	 * whole set at once by the distance of its oldest way to max_rrpv */
+#ifdef __SSE2__
+	__m128i oldest = _mm_setzero_si128();
+	for(uint32_t way = 0; way < stride; way += 16)
+	{
+		oldest = _mm_max_epu8(oldest, _mm_loadu_si128((__m128i*)(r + way)));
+	}
+	oldest = _mm_max_epu8(oldest, _mm_srli_si128(oldest, 8));
+	oldest = _mm_max_epu8(oldest, _mm_srli_si128(oldest, 4));
+	oldest = _mm_max_epu8(oldest, _mm_srli_si128(oldest, 2));
+	oldest = _mm_max_epu8(oldest, _mm_srli_si128(oldest, 1));
+	uint8_t age = max_rrpv - (uint8_t)_mm_cvtsi128_si32(oldest);
+
+	__m128i target = _mm_set1_epi8(max_rrpv);
+	for(uint32_t way = 0; way < stride; way += 16)
+	{
+		__m128i v = _mm_loadu_si128((__m128i*)(r + way));
+		if(age)
+		{
+			__m128i mask = _mm_loadu_si128((__m128i*)&lane_mask[way]);
+			v = _mm_add_epi8(v, _mm_and_si128(_mm_set1_epi8(age), mask));
+			_mm_storeu_si128((__m128i*)(r + way), v);
+		}
+		uint32_t hits = _mm_movemask_epi8(_mm_cmpeq_epi8(v, target));
+		if(hits)
+		{
+			uint32_t victim = way + __builtin_ctz(hits);
+			if(age)
+			{
+				/* finish aging the rest of the set */
+				for(uint32_t rest = way + 16; rest < stride; rest += 16)
+				{
+					__m128i w = _mm_loadu_si128((__m128i*)(r + rest));
+					__m128i mask = _mm_loadu_si128((__m128i*)&lane_mask[rest]);
+					_mm_storeu_si128((__m128i*)(r + rest), _mm_add_epi8(w, _mm_and_si128(_mm_set1_epi8(age), mask)));
+				}
+			}
+			assert(victim < ways);
+			return victim;
+		}
+	}
+#else
+	uint8_t oldest = 0;
+	for(uint32_t way = 0; way < ways; ++way)
+	{
+		if(r[way] > oldest) oldest = r[way];
+	}
+	uint8_t age = max_rrpv - oldest;
+	uint32_t victim = ways;
+	for(uint32_t way = 0; way < ways; ++way)
+	{
+		r[way] += age;
+		if(r[way] == max_rrpv && victim == ways) victim = way;
+	}
+	if(victim < ways) return victim;
+#endif
+
+	/* WE SHOULD NOT REACH HERE */
+	assert(0);
+	return 0;
+}
+
+RandomSetPicker::RandomSetPicker(uint32_t _sets)
+{
+	sets = _sets;
+	rand_seed = 1;
+	picked.assign(sets, false);
+}
+
+uint32_t RandomSetPicker::next()
+{
+	unsigned long max_rand = 1048576;
+	uint32_t set;
+	do
+	{
+		rand_seed = rand_seed * 1103515245 + 12345;
+		set = ((unsigned) ((rand_seed/65536) % max_rand)) % sets;
+	} while(picked[set]);
+	picked[set] = true;
+	return set;
+}
+
+SetDuelingMonitor::SetDuelingMonitor(RandomSetPicker &picker, uint32_t sets, uint32_t num_cpus, uint32_t sdm_size, uint32_t psel_width)
+{
+	psel_max = (1 << psel_width) - 1;
+	psel.assign(num_cpus, 0);
+	leader_cpu.assign(sets, -1);
+	leader_policy.assign(sets, -1);
+
+	for(uint32_t cpu = 0; cpu < num_cpus; ++cpu)
+	{
+		for(int policy = 0; policy < 2; ++policy)
+		{
+			for(uint32_t index = 0; index < sdm_size; ++index)
+			{
+				uint32_t set = picker.next();
+				leader_cpu[set] = cpu;
+				leader_policy[set] = policy;
+			}
+		}
+	}
+}
+
+void SetDuelingMonitor::record_miss(uint32_t cpu, int policy)
+{
+	if(policy == 0)
+	{
+		if(psel[cpu] > 0) psel[cpu]--;
+	}
+	else
+	{
+		if(psel[cpu] < psel_max) psel[cpu]++;
+	}
+}
+
+SamplerSets::SamplerSets(RandomSetPicker &picker, uint32_t sets, uint32_t num_sampled, uint32_t _ways)
+{
+	ways = _ways;
+	index.assign(sets, -1);
+	entries.resize(num_sampled * ways);
+	for(uint32_t s_idx = 0; s_idx < num_sampled; ++s_idx)
+	{
+		index[picker.next()] = s_idx;
+		for(uint32_t way = 0; way < ways; ++way)
+		{
+			entries[s_idx * ways + way].lru = way;
+		}
+	}
+}
+
+SamplerEvent SamplerSets::access(int32_t s_idx, uint64_t tag, uint64_t ip, uint8_t type, uint64_t &trained_ip)
+{
+	SamplerEntry *s_set = &entries[s_idx * ways];
+	SamplerEvent event = SAMPLER_NONE;
+	uint32_t match;
+
+	/* check hit; the sampler keeps the inserting ip on a hit */
+	for(match = 0; match < ways; ++match)
+	{
+		if(s_set[match].valid && s_set[match].tag == tag)
+		{
+			trained_ip = s_set[match].ip;
+			event = SAMPLER_REUSE;
+			s_set[match].type = type;
+			s_set[match].used = 1;
+			break;
+		}
+	}
+
+	/* check invalid */
+	if(match == ways)
+	{
+		for(match = 0; match < ways; ++match)
+		{
+			if(s_set[match].valid == 0)
+			{
+				s_set[match].valid = 1;
+				s_set[match].tag = tag;
+				s_set[match].ip = ip;
+				s_set[match].type = type;
+				s_set[match].used = 0;
+				break;
+			}
+		}
+	}
+
+	/* miss, replace the LRU entry */
+	if(match == ways)
+	{
+		for(match = 0; match < ways; ++match)
+		{
+			if(s_set[match].lru == ways - 1)
+			{
+				if(s_set[match].used == 0)
+				{
+					trained_ip = s_set[match].ip;
+					event = SAMPLER_DEAD;
+				}
+				s_set[match].tag = tag;
+				s_set[match].ip = ip;
+				s_set[match].type = type;
+				s_set[match].used = 0;
+				break;
+			}
+		}
+	}
+	assert(match < ways);
+
+	/* update LRU state */
+	uint32_t curr_position = s_set[match].lru;
+	for(uint32_t way = 0; way < ways; ++way)
+	{
+		if(s_set[way].lru < curr_position)
+			s_set[way].lru++;
+	}
+	s_set[match].lru = 0;
+
+	return event;
+}
@@ -0,0 +1,81 @@
+#include <assert.h>
+#include <strings.h>
+#include "cache.h"
+#include "ship.h"
+
+SHiP::SHiP(std::string type, uint32_t _sets, uint32_t ways, uint32_t num_cpus)
+	: SRRIP(type, _sets, ways), sets(_sets), picker(_sets), sampler(picker, _sets, SHIP_SAMPLER_SETS_PER_CPU * num_cpus, ways)
+{
+	SHCT.assign(num_cpus * SHCT_SIZE, 0);
+	bzero(&ship_stats, sizeof(ship_stats));
+}
+
+void SHiP::update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit, uint32_t metadata)
+{
+	if((type == WRITEBACK) && ip)
+		assert(0);
+
+	/* handle writeback access */
+	if(type == WRITEBACK)
+	{
+		if(!hit)
+			rrpv.set(set, way, maxRRPV-1);
+		return;
+	}
+
+	/* train the SHCT from the sampler */
+	int32_t s_idx = sampler.lookup(set);
+	if(s_idx >= 0)
+	{
+		uint64_t trained_ip = 0;
+		SamplerEvent event = sampler.access(s_idx, full_addr / (BLOCK_SIZE * sets), ip, type, trained_ip);
+		uint32_t &counter = SHCT[cpu * SHCT_SIZE + trained_ip % SHCT_PRIME];
+		if(event == SAMPLER_REUSE)
+		{
+			ship_stats.sampler_reuse++;
+			if(counter > 0)
+				counter--;
+		}
+		else if(event == SAMPLER_DEAD)
+		{
+			ship_stats.sampler_dead++;
+			if(counter < SHCT_MAX)
+				counter++;
+		}
+	}
+
+	if(pf_conf_update(set, way, type, hit, metadata))
+		return;
+
+	if(hit)
+	{
+		stats.promote++;
+		rrpv.set(set, way, 0);
+	}
+	else
+	{
+		/* SHiP prediction */
+		stats.insert++;
+		rrpv.set(set, way, maxRRPV-1);
+		if(SHCT[cpu * SHCT_SIZE + ip % SHCT_PRIME] == SHCT_MAX)
+		{
+			ship_stats.insert_distant++;
+			rrpv.set(set, way, maxRRPV);
+		}
+	}
+}
+
+void SHiP::dump_stats()
+{
+	SRRIP::dump_stats();
+	cout << type << "_sampler_reuse " << ship_stats.sampler_reuse << endl
+		<< type << "_sampler_dead " << ship_stats.sampler_dead << endl
+		<< type << "_insert_distant " << ship_stats.insert_distant << endl;
+}
+
+void SHiP::print_config()
+{
+	SRRIP::print_config();
+	cout << type << "_shct_size " << SHCT_SIZE << endl
+		<< type << "_sampler_sets_per_cpu " << SHIP_SAMPLER_SETS_PER_CPU << endl;
+}
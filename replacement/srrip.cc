@@ -0,0 +1,76 @@
+#include <assert.h>
+#include <strings.h>
+#include "cache.h"
+#include "srrip.h"
+
+namespace knob
+{
+	extern bool pf_conf_insertion;
+}
+
+SRRIP::SRRIP(std::string type, uint32_t sets, uint32_t ways) : Replacement(type), rrpv(sets, ways, maxRRPV)
+{
+	bzero(&stats, sizeof(stats));
+}
+
+uint32_t SRRIP::find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type)
+{
+	stats.victim++;
+	return rrpv.find_victim(set);
+}
+
+/* Lines from low-confidence prefetches are filled at the distant RRPV and
+ * are not promoted by later prefetches. Returns true if it set the RRPV. */
+bool SRRIP::pf_conf_update(uint32_t set, uint32_t way, uint32_t type, uint8_t hit, uint32_t metadata)
+{
+	if(!knob::pf_conf_insertion || type != PREFETCH || !pf_conf_valid(metadata))
+		return false;
+	if(pf_conf_level(metadata) >= PF_CONF_LEVELS / 2)
+		return false;
+
+	if(hit)
+	{
+		stats.pf_conf_no_promote++;
+	}
+	else
+	{
+		stats.pf_conf_distant++;
+		stats.insert++;
+		rrpv.set(set, way, maxRRPV);
+	}
+	return true;
+}
+
+void SRRIP::update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit, uint32_t metadata)
+{
+	if((type == WRITEBACK) && ip)
+		assert(0);
+
+	if(pf_conf_update(set, way, type, hit, metadata))
+		return;
+
+	if(hit)
+	{
+		stats.promote++;
+		rrpv.set(set, way, 0);
+	}
+	else
+	{
+		stats.insert++;
+		rrpv.set(set, way, maxRRPV-1);
+	}
+}
+
+void SRRIP::dump_stats()
+{
+	cout << type << "_insert " << stats.insert << endl
+		<< type << "_promote " << stats.promote << endl
+		<< type << "_victim " << stats.victim << endl
+		<< type << "_pf_conf_distant " << stats.pf_conf_distant << endl
+		<< type << "_pf_conf_no_promote " << stats.pf_conf_no_promote << endl;
+}
+
+void SRRIP::print_config()
+{
+	cout << type << "_max_rrpv " << maxRRPV << endl;
+}
@@ -1,4 +1,5 @@
 #include "block.h"
+#include "interconnect.h"
 
 int PACKET_QUEUE::check_queue(PACKET *packet)
 {
@@ -89,11 +90,18 @@ void PACKET_QUEUE::add_queue(PACKET *packet)
     cout << " head: " << head << " tail: " << tail << " occupancy: " << occupancy << " event_cycle: " << entry[tail].event_cycle << endl; });
 
     occupancy++;
+    add_slice_occupancy(packet->address);
     tail++;
     if (tail >= SIZE)
         tail = 0;
 }
 
+void PACKET_QUEUE::add_slice_occupancy(uint64_t address)
+{
+    if (interconnect)
+        slice_occupancy[interconnect->get_slice(address)]++;
+}
+
 void PACKET_QUEUE::remove_queue(PACKET *packet)
 {
 #ifdef SANITY_CHECK
@@ -106,6 +114,9 @@ void PACKET_QUEUE::remove_queue(PACKET *packet)
     cout << " address: " << hex << packet->address << " full_addr: " << packet->full_addr << dec << " fill_level: " << packet->fill_level;
     cout << " head: " << head << " tail: " << tail << " occupancy: " << occupancy << " event_cycle: " << packet->event_cycle << endl; });
 
+    if (interconnect)
+        slice_occupancy[interconnect->get_slice(packet->address)]--;
+
     // reset entry
     PACKET empty_packet;
     *packet = empty_packet;
@@ -1,6 +1,7 @@
 #include <algorithm>
 #include "cache.h"
 #include "set.h"
+#include "compression.h"
 
 uint64_t l2pf_access = 0;
 
@@ -15,6 +16,15 @@ namespace knob
     extern uint32_t semi_perfect_cache_page_buffer_size;
     extern bool measure_cache_acc;
     extern uint32_t measure_cache_acc_epoch;
+    extern string llc_inclusion;
+    extern uint32_t llc_compression_tag_factor;
+    extern bool llc_compression;
+    extern uint32_t llc_slices;
+    extern string llc_slice_hash;
+    extern string llc_topology;
+    extern uint32_t llc_hop_latency;
+    extern uint32_t llc_link_bandwidth;
+    extern bool dram_demand_first;
 }
 
 void print_cache_config()
@@ -78,6 +88,13 @@ void print_cache_config()
         << "llc_pq_size " << LLC_PQ_SIZE << endl
         << "llc_mshr_size " << LLC_MSHR_SIZE << endl
         << "llc_latency " << LLC_LATENCY << endl
+        << "llc_compression " << knob::llc_compression << endl
+        << "llc_compression_tag_factor " << knob::llc_compression_tag_factor << endl
+        << "llc_slices " << knob::llc_slices << endl
+        << "llc_slice_hash " << knob::llc_slice_hash << endl
+        << "llc_topology " << knob::llc_topology << endl
+        << "llc_hop_latency " << knob::llc_hop_latency << endl
+        << "llc_link_bandwidth " << knob::llc_link_bandwidth << endl
         << endl;
 }
 
@@ -102,6 +119,44 @@ void CACHE::handle_fill()
 
         uint32_t mshr_index = MSHR.next_fill_index;
 
+        // an exclusive LLC does not keep the lines it hands up to the L2C
+        if ((cache_type == IS_LLC) && (inclusion == LLC_EXCLUSIVE) && (MSHR.entry[mshr_index].fill_level < fill_level))
+        {
+            excl_bypass_fill++;
+
+            // COLLECT STATS
+            if (!MSHR.entry[mshr_index].wrong_path || MSHR.entry[mshr_index].load_merged) // wrong-path misses are counted in wp_miss
+            {
+                sim_miss[fill_cpu][MSHR.entry[mshr_index].type]++;
+                sim_access[fill_cpu][MSHR.entry[mshr_index].type]++;
+            }
+
+            if (MSHR.entry[mshr_index].instruction)
+            {
+                upper_level_icache[fill_cpu]->return_data(&MSHR.entry[mshr_index]);
+            }
+            else // data
+            {
+                upper_level_dcache[fill_cpu]->return_data(&MSHR.entry[mshr_index]);
+            }
+
+            if ((NUM_CPUS > 1) && (cache_type == IS_LLC))
+                shared_llc_return(&MSHR.entry[mshr_index]);
+
+            if(warmup_complete[fill_cpu])
+            {
+                uint64_t current_miss_latency = (current_core_cycle[fill_cpu] - MSHR.entry[mshr_index].cycle_enqueued);
+                total_miss_latency += current_miss_latency;
+            }
+
+            MSHR.remove_queue(&MSHR.entry[mshr_index]);
+            MSHR.num_returned--;
+
+            update_fill_cycle();
+
+            return;
+        }
+
         // find victim
         uint32_t set = get_set(MSHR.entry[mshr_index].address), way;
         if (cache_type == IS_LLC)
@@ -114,21 +169,24 @@ void CACHE::handle_fill()
         }
 
 #ifdef LLC_BYPASS
-        if ((cache_type == IS_LLC) && (way == LLC_WAY)) // this is a bypass that does not fill the LLC
+        if ((cache_type == IS_LLC) && (way == NUM_WAY)) // this is a bypass that does not fill the LLC
         {
             // update replacement policy
             if (cache_type == IS_LLC)
             {
-                llc_update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, 0, MSHR.entry[mshr_index].type, 0);
+                llc_update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, 0, MSHR.entry[mshr_index].type, 0, MSHR.entry[mshr_index].pf_metadata);
             }
             else
             {
-                update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, 0, MSHR.entry[mshr_index].type, 0);
+                update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, 0, MSHR.entry[mshr_index].type, 0, MSHR.entry[mshr_index].pf_metadata);
             }
 
             // COLLECT STATS
-            sim_miss[fill_cpu][MSHR.entry[mshr_index].type]++;
-            sim_access[fill_cpu][MSHR.entry[mshr_index].type]++;
+            if (!MSHR.entry[mshr_index].wrong_path || MSHR.entry[mshr_index].load_merged) // wrong-path misses are counted in wp_miss
+            {
+                sim_miss[fill_cpu][MSHR.entry[mshr_index].type]++;
+                sim_access[fill_cpu][MSHR.entry[mshr_index].type]++;
+            }
 
             // check fill level
             if (MSHR.entry[mshr_index].fill_level < fill_level) 
@@ -141,8 +199,12 @@ void CACHE::handle_fill()
                 {
                     upper_level_dcache[fill_cpu]->return_data(&MSHR.entry[mshr_index]);
                 }
+                return_dual_fill(&MSHR.entry[mshr_index]);
             }
 
+            if ((NUM_CPUS > 1) && (cache_type == IS_LLC))
+                shared_llc_return(&MSHR.entry[mshr_index]);
+
             if(warmup_complete[fill_cpu])
             {
                 uint64_t current_miss_latency = (current_core_cycle[fill_cpu] - MSHR.entry[mshr_index].cycle_enqueued);	
@@ -160,8 +222,22 @@ void CACHE::handle_fill()
 
         uint8_t  do_fill = 1;
 
+        // a compressed LLC may have to evict more lines for the new one to fit
+        if ((cache_type == IS_LLC) && comp_set_segments && !make_compressed_room(set, way, &MSHR.entry[mshr_index]))
+        {
+            do_fill = 0;
+            STALL[MSHR.entry[mshr_index].type]++;
+        }
+
+        // an inclusive LLC takes over the dirty data of the private copies it
+        // evicts, and an exclusive LLC takes the clean L2C victims as well
+        uint8_t victim_dirty = block[set][way].dirty,
+                victim_fill = (cache_type == IS_L2C) && block[set][way].valid && exclusive_llc();
+        if ((cache_type == IS_LLC) && (inclusion == LLC_INCLUSIVE) && block[set][way].valid && !victim_dirty)
+            victim_dirty = upper_level_dirty(block[set][way].address);
+
         // is this dirty?
-        if (block[set][way].dirty) 
+        if (do_fill && (victim_dirty || victim_fill))
         {
             // check if the lower level WQ has enough room to keep this writeback request
             if (lower_level)
@@ -191,6 +267,7 @@ void CACHE::handle_fill()
                     writeback_packet.ip = 0; // writeback does not have ip
                     writeback_packet.type = WRITEBACK;
                     writeback_packet.event_cycle = current_core_cycle[fill_cpu];
+                    writeback_packet.clean_victim = !victim_dirty;
 
                     lower_level->add_wq(&writeback_packet);
                 }
@@ -206,7 +283,16 @@ void CACHE::handle_fill()
 
         if (do_fill)
         {
+            if ((cache_type == IS_LLC) && (inclusion == LLC_INCLUSIVE) && block[set][way].valid)
+            {
+                back_invalidate(block[set][way].address, MSHR.entry[mshr_index].type);
+            }
+
             // update prefetcher
+            if (cache_type == IS_L1I)
+            {
+                l1i_prefetcher_cache_fill(MSHR.entry[mshr_index].full_addr, set, way, (MSHR.entry[mshr_index].type == PREFETCH) ? 1 : 0, block[set][way].address<<LOG2_BLOCK_SIZE, MSHR.entry[mshr_index].pf_metadata);
+            }
             if (cache_type == IS_L1D)
             {
                 l1d_prefetcher_cache_fill(MSHR.entry[mshr_index].full_addr, set, way, (MSHR.entry[mshr_index].type == PREFETCH) ? 1 : 0, block[set][way].address<<LOG2_BLOCK_SIZE, MSHR.entry[mshr_index].pf_metadata);
@@ -225,16 +311,19 @@ void CACHE::handle_fill()
             // update replacement policy
             if (cache_type == IS_LLC)
             {
-                llc_update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, block[set][way].full_addr, MSHR.entry[mshr_index].type, 0);
+                llc_update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, block[set][way].full_addr, MSHR.entry[mshr_index].type, 0, MSHR.entry[mshr_index].pf_metadata);
             }
             else
             {
-                update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, block[set][way].full_addr, MSHR.entry[mshr_index].type, 0);
+                update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, block[set][way].full_addr, MSHR.entry[mshr_index].type, 0, MSHR.entry[mshr_index].pf_metadata);
             }
 
             // COLLECT STATS
-            sim_miss[fill_cpu][MSHR.entry[mshr_index].type]++;
-            sim_access[fill_cpu][MSHR.entry[mshr_index].type]++;
+            if (!MSHR.entry[mshr_index].wrong_path || MSHR.entry[mshr_index].load_merged) // wrong-path misses are counted in wp_miss
+            {
+                sim_miss[fill_cpu][MSHR.entry[mshr_index].type]++;
+                sim_access[fill_cpu][MSHR.entry[mshr_index].type]++;
+            }
 
             fill_cache(set, way, &MSHR.entry[mshr_index]);
 
@@ -244,6 +333,10 @@ void CACHE::handle_fill()
                 if (MSHR.entry[mshr_index].type == RFO)
                 {
                     block[set][way].dirty = 1;
+
+                    // the RFO may have merged into another core's read at the LLC
+                    if (directory)
+                        directory->upgrade(fill_cpu, MSHR.entry[mshr_index].address);
                 }
             }
 
@@ -258,8 +351,12 @@ void CACHE::handle_fill()
                 {
                     upper_level_dcache[fill_cpu]->return_data(&MSHR.entry[mshr_index]);
                 }
+                return_dual_fill(&MSHR.entry[mshr_index]);
             }
 
+            if ((NUM_CPUS > 1) && (cache_type == IS_LLC))
+                shared_llc_return(&MSHR.entry[mshr_index]);
+
             // update processed packets
             if (cache_type == IS_ITLB)
             { 
@@ -277,7 +374,7 @@ void CACHE::handle_fill()
                     PROCESSED.add_queue(&MSHR.entry[mshr_index]);
                 }
             }
-            else if (cache_type == IS_L1I)
+            else if ((cache_type == IS_L1I) && (MSHR.entry[mshr_index].type != PREFETCH))
             {
                 if (PROCESSED.occupancy < PROCESSED.SIZE)
                 {
@@ -325,18 +422,23 @@ void CACHE::handle_writeback()
         if (way >= 0) { // writeback hit (or RFO hit for L1D)
 
             if (cache_type == IS_LLC) {
-                llc_update_replacement_state(writeback_cpu, set, way, block[set][way].full_addr, WQ.entry[index].ip, 0, WQ.entry[index].type, 1);
+                llc_update_replacement_state(writeback_cpu, set, way, block[set][way].full_addr, WQ.entry[index].ip, 0, WQ.entry[index].type, 1, block[set][way].pf_metadata);
 
             }
             else
-                update_replacement_state(writeback_cpu, set, way, block[set][way].full_addr, WQ.entry[index].ip, 0, WQ.entry[index].type, 1);
+                update_replacement_state(writeback_cpu, set, way, block[set][way].full_addr, WQ.entry[index].ip, 0, WQ.entry[index].type, 1, block[set][way].pf_metadata);
 
             // COLLECT STATS
             sim_hit[writeback_cpu][WQ.entry[index].type]++;
             sim_access[writeback_cpu][WQ.entry[index].type]++;
 
             // mark dirty
-            block[set][way].dirty = 1;
+            if (!WQ.entry[index].clean_victim)
+                block[set][way].dirty = 1;
+
+            // a store to a Shared line takes ownership first
+            if (directory && (cache_type == IS_L1D))
+                directory->upgrade(writeback_cpu, WQ.entry[index].address);
 
             if (cache_type == IS_ITLB)
                 WQ.entry[index].instruction_pa = block[set][way].data;
@@ -374,7 +476,7 @@ void CACHE::handle_writeback()
                 uint8_t miss_handled = 1;
                 int mshr_index = check_mshr(&WQ.entry[index]);
 
-                if ((mshr_index == -1) && (MSHR.occupancy < MSHR_SIZE)) { // this is a new miss
+                if ((mshr_index == -1) && !mshr_full(WQ.entry[index].address)) { // this is a new miss
 
 		  if(cache_type == IS_LLC)
 		    {
@@ -400,7 +502,7 @@ void CACHE::handle_writeback()
 		    }
                 }
                 else {
-                    if ((mshr_index == -1) && (MSHR.occupancy == MSHR_SIZE)) { // not enough MSHR resource
+                    if ((mshr_index == -1) && mshr_full(WQ.entry[index].address)) { // not enough MSHR resource
                         
                         // cannot handle miss request until one of MSHRs is available
                         miss_handled = 0;
@@ -416,11 +518,15 @@ void CACHE::handle_writeback()
                         if (MSHR.entry[mshr_index].type == PREFETCH) {
                             uint8_t  prior_returned = MSHR.entry[mshr_index].returned;
                             uint64_t prior_event_cycle = MSHR.entry[mshr_index].event_cycle;
+                            uint64_t prior_data = MSHR.entry[mshr_index].data;
 			    MSHR.entry[mshr_index] = WQ.entry[index];
 
                             // in case request is already returned, we should keep event_cycle and retunred variables
                             MSHR.entry[mshr_index].returned = prior_returned;
                             MSHR.entry[mshr_index].event_cycle = prior_event_cycle;
+                            // and the data it brought back, which the writeback does not carry
+                            if (prior_returned == COMPLETED)
+                                MSHR.entry[mshr_index].data = prior_data;
                         }
 
                         MSHR_MERGED[WQ.entry[index].type]++;
@@ -458,7 +564,7 @@ void CACHE::handle_writeback()
                     way = find_victim(writeback_cpu, WQ.entry[index].instr_id, set, block[set], WQ.entry[index].ip, WQ.entry[index].full_addr, WQ.entry[index].type);
 
 #ifdef LLC_BYPASS
-                if ((cache_type == IS_LLC) && (way == LLC_WAY)) {
+                if ((cache_type == IS_LLC) && (way == NUM_WAY)) {
                     cerr << "LLC bypassing for writebacks is not allowed!" << endl;
                     assert(0);
                 }
@@ -466,8 +572,19 @@ void CACHE::handle_writeback()
 
                 uint8_t  do_fill = 1;
 
+                // a compressed LLC may have to evict more lines for the new one to fit
+                if ((cache_type == IS_LLC) && comp_set_segments && !make_compressed_room(set, way, &WQ.entry[index])) {
+                    do_fill = 0;
+                    STALL[WQ.entry[index].type]++;
+                }
+
+                uint8_t victim_dirty = block[set][way].dirty,
+                        victim_fill = (cache_type == IS_L2C) && block[set][way].valid && exclusive_llc();
+                if ((cache_type == IS_LLC) && (inclusion == LLC_INCLUSIVE) && block[set][way].valid && !victim_dirty)
+                    victim_dirty = upper_level_dirty(block[set][way].address);
+
                 // is this dirty?
-                if (block[set][way].dirty) {
+                if (do_fill && (victim_dirty || victim_fill)) {
 
                     // check if the lower level WQ has enough room to keep this writeback request
                     if (lower_level) { 
@@ -495,6 +612,7 @@ void CACHE::handle_writeback()
                             writeback_packet.ip = 0;
                             writeback_packet.type = WRITEBACK;
                             writeback_packet.event_cycle = current_core_cycle[writeback_cpu];
+                            writeback_packet.clean_victim = !victim_dirty;
 
                             lower_level->add_wq(&writeback_packet);
                         }
@@ -509,6 +627,9 @@ void CACHE::handle_writeback()
                 }
 
                 if (do_fill) {
+                    if ((cache_type == IS_LLC) && (inclusion == LLC_INCLUSIVE) && block[set][way].valid)
+                        back_invalidate(block[set][way].address, WQ.entry[index].type);
+
                     // update prefetcher
                     if (cache_type == IS_L1D)
 		      l1d_prefetcher_cache_fill(WQ.entry[index].full_addr, set, way, 0, block[set][way].address<<LOG2_BLOCK_SIZE, WQ.entry[index].pf_metadata);
@@ -525,10 +646,10 @@ void CACHE::handle_writeback()
 
                     // update replacement policy
                     if (cache_type == IS_LLC) {
-                        llc_update_replacement_state(writeback_cpu, set, way, WQ.entry[index].full_addr, WQ.entry[index].ip, block[set][way].full_addr, WQ.entry[index].type, 0);
+                        llc_update_replacement_state(writeback_cpu, set, way, WQ.entry[index].full_addr, WQ.entry[index].ip, block[set][way].full_addr, WQ.entry[index].type, 0, WQ.entry[index].pf_metadata);
                     }
                     else
-                        update_replacement_state(writeback_cpu, set, way, WQ.entry[index].full_addr, WQ.entry[index].ip, block[set][way].full_addr, WQ.entry[index].type, 0);
+                        update_replacement_state(writeback_cpu, set, way, WQ.entry[index].full_addr, WQ.entry[index].ip, block[set][way].full_addr, WQ.entry[index].type, 0, WQ.entry[index].pf_metadata);
 
                     // COLLECT STATS
                     sim_miss[writeback_cpu][WQ.entry[index].type]++;
@@ -537,7 +658,10 @@ void CACHE::handle_writeback()
                     fill_cache(set, way, &WQ.entry[index]);
 
                     // mark dirty
-                    block[set][way].dirty = 1; 
+                    if (WQ.entry[index].clean_victim)
+                        excl_victim_fill++;
+                    else
+                        block[set][way].dirty = 1;
 
                     // check fill level
                     if (WQ.entry[index].fill_level < fill_level) {
@@ -596,6 +720,10 @@ void CACHE::handle_read()
                 else if (cache_type == IS_STLB) 
                 {
                     RQ.entry[index].data = block[set][way].data;
+
+                    // a prefetched translation hides a miss, the TLB prefetcher still sees it as one
+                    if (block[set][way].prefetch)
+                        stlb_prefetcher_operate(RQ.entry[index].address, RQ.entry[index].ip, 1, RQ.entry[index].type);
                 }
                 else if (cache_type == IS_L1I) 
                 {
@@ -612,7 +740,9 @@ void CACHE::handle_read()
                 // update prefetcher on load instruction
                 if (RQ.entry[index].type == LOAD) 
                 {
-                    if (cache_type == IS_L1D) 
+                    if (cache_type == IS_L1I) 
+                        l1i_prefetcher_operate(RQ.entry[index].full_addr, RQ.entry[index].ip, 1, RQ.entry[index].type);
+                    else if (cache_type == IS_L1D) 
                         l1d_prefetcher_operate(RQ.entry[index].full_addr, RQ.entry[index].ip, 1, RQ.entry[index].type);
                     else if (cache_type == IS_L2C)
                         l2c_prefetcher_operate(block[set][way].address<<LOG2_BLOCK_SIZE, RQ.entry[index].ip, 1, RQ.entry[index].type, 0);
@@ -626,13 +756,23 @@ void CACHE::handle_read()
 
                 // update replacement policy
                 if (cache_type == IS_LLC)
-                    llc_update_replacement_state(read_cpu, set, way, block[set][way].full_addr, RQ.entry[index].ip, 0, RQ.entry[index].type, 1);
+                    llc_update_replacement_state(read_cpu, set, way, block[set][way].full_addr, RQ.entry[index].ip, 0, RQ.entry[index].type, 1, block[set][way].pf_metadata);
                 else
-                    update_replacement_state(read_cpu, set, way, block[set][way].full_addr, RQ.entry[index].ip, 0, RQ.entry[index].type, 1);
+                    update_replacement_state(read_cpu, set, way, block[set][way].full_addr, RQ.entry[index].ip, 0, RQ.entry[index].type, 1, block[set][way].pf_metadata);
 
                 // COLLECT STATS
-                sim_hit[read_cpu][RQ.entry[index].type]++;
-                sim_access[read_cpu][RQ.entry[index].type]++;
+                // a wrong-path load only counts as a demand load once a correct-path one merged into it
+                uint8_t wrong_path_only = RQ.entry[index].wrong_path && !RQ.entry[index].load_merged;
+                if (wrong_path_only)
+                {
+                    wp_hit++;
+                    wp_access++;
+                }
+                else
+                {
+                    sim_hit[read_cpu][RQ.entry[index].type]++;
+                    sim_access[read_cpu][RQ.entry[index].type]++;
+                }
 
                 // check fill level
                 if (RQ.entry[index].fill_level < fill_level)
@@ -641,19 +781,37 @@ void CACHE::handle_read()
                         upper_level_icache[read_cpu]->return_data(&RQ.entry[index]);
                     else // data
                         upper_level_dcache[read_cpu]->return_data(&RQ.entry[index]);
+                    return_dual_fill(&RQ.entry[index]);
                 }
 
+                if ((NUM_CPUS > 1) && (cache_type == IS_LLC))
+                    shared_llc_return(&RQ.entry[index]);
+
                 // update prefetch stats and reset prefetch bit
                 if (block[set][way].prefetch)
                 {
                     pf_useful++;
                     pf_useful_epoch++;
+                    if (pf_conf_valid(block[set][way].pf_metadata))
+                        pf_conf_useful[pf_conf_level(block[set][way].pf_metadata)]++;
                     block[set][way].prefetch = 0;
+                    block[set][way].pf_metadata = 0;
                 }
                 block[set][way].used = 1;
 
-                HIT[RQ.entry[index].type]++;
-                ACCESS[RQ.entry[index].type]++;
+                // an exclusive LLC hands a clean line over to the L2C; a dirty
+                // one stays, as the fill would not carry its dirty data up
+                if ((cache_type == IS_LLC) && (inclusion == LLC_EXCLUSIVE) && (RQ.entry[index].fill_level < fill_level) && !block[set][way].dirty)
+                {
+                    block[set][way].valid = 0;
+                    excl_hit_move++;
+                }
+
+                if (!wrong_path_only)
+                {
+                    HIT[RQ.entry[index].type]++;
+                    ACCESS[RQ.entry[index].type]++;
+                }
                 
                 // remove this entry from RQ
                 RQ.remove_queue(&RQ.entry[index]);
@@ -671,7 +829,7 @@ void CACHE::handle_read()
                 uint8_t miss_handled = 1;
                 int mshr_index = check_mshr(&RQ.entry[index]);
 
-                if ((mshr_index == -1) && (MSHR.occupancy < MSHR_SIZE)) // this is a new miss
+                if ((mshr_index == -1) && !mshr_full(RQ.entry[index].address)) // this is a new miss
                 {
                     if(cache_type == IS_LLC)
                     {
@@ -689,12 +847,28 @@ void CACHE::handle_read()
                             }
                         }
                     }
+                    else if (interconnect && (cache_type == IS_L2C) && (lower_level->get_occupancy(1, RQ.entry[index].address) == lower_level->get_size(1, RQ.entry[index].address)))
+                    {
+                        // the LLC slice this miss goes to has no room in its share of the RQ
+                        miss_handled = 0;
+                    }
                     else
                     {
                         // add it to mshr (read miss)
                         add_mshr(&RQ.entry[index]);
+
+                        if (cache_type == IS_STLB)
+                            stlb_prefetcher_operate(RQ.entry[index].address, RQ.entry[index].ip, 0, RQ.entry[index].type);
 		      
-                        if (lower_level) // add it to the next level's read queue
+                        uint64_t huge_pa;
+                        if ((cache_type == IS_STLB) && stlb_huge_lookup(read_cpu, RQ.entry[index].address, RQ.entry[index].full_addr, huge_pa))
+                        {
+                            // a 2MB entry covers the page, no walk; the 4KB translation is filled as usual
+                            RQ.entry[index].data = huge_pa >> LOG2_PAGE_SIZE;
+                            RQ.entry[index].event_cycle = current_core_cycle[read_cpu];
+                            return_data(&RQ.entry[index]);
+                        }
+                        else if (lower_level) // add it to the next level's read queue
                         {
                             lower_level->add_rq(&RQ.entry[index]);
                         }
@@ -715,12 +889,35 @@ void CACHE::handle_read()
                 }
                 else 
                 {
-                    if ((mshr_index == -1) && (MSHR.occupancy == MSHR_SIZE)) // not enough MSHR resource
+                    if ((mshr_index == -1) && mshr_full(RQ.entry[index].address)) // not enough MSHR resource
                     {
                         // cannot handle miss request until one of MSHRs is available
                         miss_handled = 0;
                         STALL[RQ.entry[index].type]++;
                     }
+                    else if ((NUM_CPUS > 1) && (mshr_index != -1) && merge_other_cpu(&MSHR.entry[mshr_index], &RQ.entry[index]))
+                    {
+                        // a demand from another core caught a prefetch in flight: the prefetch was late,
+                        // and the demand takes the entry over as the same-core merge does
+                        if ((MSHR.entry[mshr_index].type == PREFETCH) && (RQ.entry[index].type != PREFETCH))
+                        {
+                            pf_late++;
+
+                            if (knob::dram_demand_first && lower_level)
+                                lower_level->promote_prefetch(RQ.entry[index].address);
+                            PACKET prior = MSHR.entry[mshr_index];
+                            MSHR.entry[mshr_index] = RQ.entry[index];
+                            MSHR.entry[mshr_index].returned = prior.returned;
+                            MSHR.entry[mshr_index].event_cycle = prior.event_cycle;
+
+                            // the prefetching core still gets the line if its prefetch was headed above the LLC
+                            MSHR.entry[mshr_index].merged_cpus = prior.merged_cpus;
+                            if (prior.fill_level < fill_level)
+                                MSHR.entry[mshr_index].merged_cpus |= 1u << prior.cpu;
+                        }
+
+                        MSHR_MERGED[RQ.entry[index].type]++;
+                    }
                     else if (mshr_index != -1) // already in-flight miss
                     {
                         // mark merged consumer
@@ -765,8 +962,11 @@ void CACHE::handle_read()
                             else 
                             {
                                 uint32_t lq_index = RQ.entry[index].lq_index;
-                                MSHR.entry[mshr_index].load_merged = 1;
-                                MSHR.entry[mshr_index].lq_index_depend_on_me.insert (lq_index);
+                                if (!RQ.entry[index].wrong_path) // wrong-path loads have no LQ entry to wake up
+                                {
+                                    MSHR.entry[mshr_index].load_merged = 1;
+                                    MSHR.entry[mshr_index].lq_index_depend_on_me.insert (lq_index);
+                                }
 
                                 DP (if (warmup_complete[read_cpu]) {
                                 cout << "[DATA_MERGED] " << __func__ << " cpu: " << read_cpu << " instr_id: " << RQ.entry[index].instr_id;
@@ -781,6 +981,7 @@ void CACHE::handle_read()
                         }
 
                         // update fill_level
+                        merge_dual_fill(&MSHR.entry[mshr_index], &RQ.entry[index]);
                         if (RQ.entry[index].fill_level < MSHR.entry[mshr_index].fill_level)
                         {
                             MSHR.entry[mshr_index].fill_level = RQ.entry[index].fill_level;
@@ -791,13 +992,34 @@ void CACHE::handle_read()
                         {
                             // RBERA: add late prefetch stats here
                             pf_late++;
+
+                            // the prefetch now has a demand waiting on it
+                            if (knob::dram_demand_first && lower_level)
+                                lower_level->promote_prefetch(RQ.entry[index].address);
                             uint8_t  prior_returned = MSHR.entry[mshr_index].returned;
                             uint64_t prior_event_cycle = MSHR.entry[mshr_index].event_cycle;
+                            uint32_t prior_merged_cpus = MSHR.entry[mshr_index].merged_cpus;
+                            uint64_t prior_data = MSHR.entry[mshr_index].data;
+                            uint32_t prior_pf_metadata = MSHR.entry[mshr_index].pf_metadata;
+                            int      prior_pf_origin_level = MSHR.entry[mshr_index].pf_origin_level;
+                            uint8_t  prior_dual_fill = MSHR.entry[mshr_index].dual_fill;
                             MSHR.entry[mshr_index] = RQ.entry[index];
+                            MSHR.entry[mshr_index].dual_fill = prior_dual_fill;
                             
                             // in case request is already returned, we should keep event_cycle and retunred variables
                             MSHR.entry[mshr_index].returned = prior_returned;
                             MSHR.entry[mshr_index].event_cycle = prior_event_cycle;
+                            MSHR.entry[mshr_index].merged_cpus = prior_merged_cpus;
+
+                            // a returned translation prefetch already holds the page number the demand has not looked up yet
+                            if (prior_returned == COMPLETED)
+                                MSHR.entry[mshr_index].data = prior_data;
+
+                            // and the TLB prefetcher still owns the entry it issued
+                            if ((cache_type == IS_ITLB) || (cache_type == IS_DTLB) || (cache_type == IS_STLB)) {
+                                MSHR.entry[mshr_index].pf_metadata = prior_pf_metadata;
+                                MSHR.entry[mshr_index].pf_origin_level = prior_pf_origin_level;
+                            }
                         }
 
                         MSHR_MERGED[RQ.entry[index].type]++;
@@ -821,6 +1043,10 @@ void CACHE::handle_read()
                     // update prefetcher on load instruction
                     if (RQ.entry[index].type == LOAD) 
                     {
+                        if (cache_type == IS_L1I)
+                        {
+                            l1i_prefetcher_operate(RQ.entry[index].full_addr, RQ.entry[index].ip, 0, RQ.entry[index].type);
+                        }
                         if (cache_type == IS_L1D)
                         {
                             l1d_prefetcher_operate(RQ.entry[index].full_addr, RQ.entry[index].ip, 0, RQ.entry[index].type);
@@ -837,8 +1063,16 @@ void CACHE::handle_read()
                         }
                     }
 
-                    MISS[RQ.entry[index].type]++;
-                    ACCESS[RQ.entry[index].type]++;
+                    if (RQ.entry[index].wrong_path && !RQ.entry[index].load_merged)
+                    {
+                        wp_miss++;
+                        wp_access++;
+                    }
+                    else
+                    {
+                        MISS[RQ.entry[index].type]++;
+                        ACCESS[RQ.entry[index].type]++;
+                    }
 
                     // remove this entry from RQ
                     RQ.remove_queue(&RQ.entry[index]);
@@ -883,11 +1117,11 @@ void CACHE::handle_prefetch()
                 // update replacement policy
                 if (cache_type == IS_LLC)
                 {
-                    llc_update_replacement_state(prefetch_cpu, set, way, block[set][way].full_addr, PQ.entry[index].ip, 0, PQ.entry[index].type, 1);
+                    llc_update_replacement_state(prefetch_cpu, set, way, block[set][way].full_addr, PQ.entry[index].ip, 0, PQ.entry[index].type, 1, block[set][way].pf_metadata);
                 }
                 else
                 {
-                    update_replacement_state(prefetch_cpu, set, way, block[set][way].full_addr, PQ.entry[index].ip, 0, PQ.entry[index].type, 1);
+                    update_replacement_state(prefetch_cpu, set, way, block[set][way].full_addr, PQ.entry[index].ip, 0, PQ.entry[index].type, 1, block[set][way].pf_metadata);
                 }
 
                 // COLLECT STATS
@@ -937,8 +1171,18 @@ void CACHE::handle_prefetch()
                     {
                         upper_level_dcache[prefetch_cpu]->return_data(&PQ.entry[index]);
                     }
+                    return_dual_fill(&PQ.entry[index]);
+
+                    if ((cache_type == IS_LLC) && (inclusion == LLC_EXCLUSIVE) && !block[set][way].dirty)
+                    {
+                        block[set][way].valid = 0;
+                        excl_hit_move++;
+                    }
                 }
 
+                if ((NUM_CPUS > 1) && (cache_type == IS_LLC))
+                    shared_llc_return(&PQ.entry[index]);
+
                 HIT[PQ.entry[index].type]++;
                 ACCESS[PQ.entry[index].type]++;
                 
@@ -958,16 +1202,37 @@ void CACHE::handle_prefetch()
                 uint8_t miss_handled = 1;
                 int mshr_index = check_mshr(&PQ.entry[index]);
 
-                if ((mshr_index == -1) && (MSHR.occupancy < MSHR_SIZE)) // this is a new miss
+                if ((mshr_index == -1) && !mshr_full(PQ.entry[index].address)) // this is a new miss
                 {
                     DP ( if (warmup_complete[PQ.entry[index].cpu]) {
                     cout << "[" << NAME << "_PQ] " <<  __func__ << " want to add instr_id: " << PQ.entry[index].instr_id << " address: " << hex << PQ.entry[index].address;
                     cout << " full_addr: " << PQ.entry[index].full_addr << dec;
                     cout << " occupancy: " << lower_level->get_occupancy(3, PQ.entry[index].address) << " SIZE: " << lower_level->get_size(3, PQ.entry[index].address) << endl; });
 
+                    if (cache_type == IS_STLB)
+                    {
+                        // translation prefetch: the walker takes it like a demand miss, without
+                        // a walker the translation arrives PAGE_TABLE_LATENCY later without stalling the core
+                        uint64_t pa;
+                        if (lookup_vpage_to_pa(prefetch_cpu, PQ.entry[index].address, PQ.entry[index].full_addr, pa))
+                        {
+                            if (lower_level)
+                            {
+                                add_mshr(&PQ.entry[index]);
+                                lower_level->add_rq(&PQ.entry[index]);
+                            }
+                            else
+                            {
+                                PQ.entry[index].data = pa >> LOG2_PAGE_SIZE;
+                                PQ.entry[index].event_cycle = current_core_cycle[prefetch_cpu] + PAGE_TABLE_LATENCY;
+                                add_mshr(&PQ.entry[index]);
+                                return_data(&PQ.entry[index]);
+                            }
+                        }
+                    }
                     // first check if the lower level PQ is full or not
                     // this is possible since multiple prefetchers can exist at each level of caches
-                    if (lower_level)
+                    else if (lower_level)
                     {
                         if (cache_type == IS_LLC)
                         {
@@ -1030,7 +1295,7 @@ void CACHE::handle_prefetch()
                 }
                 else 
                 {
-                    if ((mshr_index == -1) && (MSHR.occupancy == MSHR_SIZE)) // not enough MSHR resource
+                    if ((mshr_index == -1) && mshr_full(PQ.entry[index].address)) // not enough MSHR resource
                     {
                         // TODO: should we allow prefetching with lower fill level at this case?
                         
@@ -1038,13 +1303,19 @@ void CACHE::handle_prefetch()
                         miss_handled = 0;
                         STALL[PQ.entry[index].type]++;
                     }
+                    else if ((NUM_CPUS > 1) && (mshr_index != -1) && merge_other_cpu(&MSHR.entry[mshr_index], &PQ.entry[index]))
+                    {
+                        MSHR_MERGED[PQ.entry[index].type]++;
+                    }
                     else if (mshr_index != -1) // already in-flight miss
                     {
                         // no need to update request except fill_level
                         // update fill_level
+                        merge_dual_fill(&MSHR.entry[mshr_index], &PQ.entry[index]);
                         if (PQ.entry[index].fill_level < MSHR.entry[mshr_index].fill_level)
                         {
                             MSHR.entry[mshr_index].fill_level = PQ.entry[index].fill_level;
+                            MSHR.entry[mshr_index].instruction = PQ.entry[index].instruction;
                         }
 
                         MSHR_MERGED[PQ.entry[index].type]++;
@@ -1152,7 +1423,10 @@ void CACHE::fill_cache(uint32_t set, uint32_t way, PACKET *packet)
     {
         pf_filled++;
         pf_filled_epoch++;
+        if (pf_conf_valid(packet->pf_metadata))
+            pf_conf_filled[pf_conf_level(packet->pf_metadata)]++;
     }
+    block[set][way].pf_metadata = block[set][way].prefetch ? packet->pf_metadata : 0;
 
     block[set][way].delta = packet->delta;
     block[set][way].depth = packet->depth;
@@ -1166,6 +1440,13 @@ void CACHE::fill_cache(uint32_t set, uint32_t way, PACKET *packet)
     block[set][way].cpu = packet->cpu;
     block[set][way].instr_id = packet->instr_id;
 
+    if (comp_set_segments) {
+        block[set][way].comp_size = compressed_segments(packet->address);
+        block[set][way].last_touch = ++comp_clock;
+        comp_fills++;
+        comp_fill_segments += block[set][way].comp_size;
+    }
+
     DP ( if (warmup_complete[packet->cpu]) {
     cout << "[" << NAME << "] " << __func__ << " set: " << set << " way: " << way;
     cout << " lru: " << block[set][way].lru << " tag: " << hex << block[set][way].tag << " full_addr: " << block[set][way].full_addr;
@@ -1213,6 +1494,8 @@ int CACHE::check_hit(PACKET *packet)
         if (block[set][way].valid && (block[set][way].tag == packet->address)) {
 
             match_way = way;
+            if (comp_set_segments)
+                block[set][way].last_touch = ++comp_clock;
 
             DP ( if (warmup_complete[packet->cpu]) {
             cout << "[" << NAME << "] " << __func__ << " instr_id: " << packet->instr_id << " type: " << +packet->type << hex << " addr: " << packet->address;
@@ -1258,6 +1541,347 @@ int CACHE::invalidate_entry(uint64_t inval_addr)
     return match_way;
 }
 
+// returns the valid block holding this line, NULL if there is none
+static BLOCK* find_block(CACHE *cache, uint64_t address)
+{
+    uint32_t set = cache->get_set(address);
+    for (uint32_t way=0; way<cache->NUM_WAY; way++) {
+        if (cache->block[set][way].valid && (cache->block[set][way].tag == address))
+            return &cache->block[set][way];
+    }
+    return NULL;
+}
+
+void CACHE::llc_initialize_inclusion()
+{
+    if (!knob::llc_inclusion.compare("non_inclusive"))
+        inclusion = LLC_NON_INCLUSIVE;
+    else if (!knob::llc_inclusion.compare("inclusive"))
+        inclusion = LLC_INCLUSIVE;
+    else if (!knob::llc_inclusion.compare("exclusive"))
+        inclusion = LLC_EXCLUSIVE;
+    else {
+        cout << "unsupported LLC inclusion policy " << knob::llc_inclusion << endl;
+        exit(1);
+    }
+    cout << "LLC_INCLUSION: " << knob::llc_inclusion << endl;
+}
+
+// the L2C sends its clean victims down too when the LLC is exclusive
+bool CACHE::exclusive_llc()
+{
+    return lower_level && (((CACHE*)lower_level)->inclusion == LLC_EXCLUSIVE);
+}
+
+// does any core hold a dirty copy of this LLC line in its L2C or L1D?
+bool CACHE::upper_level_dirty(uint64_t address)
+{
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        CACHE *l2c = (CACHE*)upper_level_dcache[i];
+        CACHE *l1d = (CACHE*)l2c->upper_level_dcache[i];
+        BLOCK *l2c_block = find_block(l2c, address), *l1d_block = find_block(l1d, address);
+        if ((l2c_block && l2c_block->dirty) || (l1d_block && l1d_block->dirty))
+            return true;
+    }
+    return false;
+}
+
+// an inclusive LLC removes the line it evicts from every core's private
+// caches; the caller has already made the LLC victim dirty if any copy was
+void CACHE::back_invalidate(uint64_t address, uint32_t type)
+{
+    uint64_t removed = 0;
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        CACHE *l2c = (CACHE*)upper_level_dcache[i];
+        CACHE *private_caches[3] = {l2c, (CACHE*)l2c->upper_level_dcache[i], (CACHE*)l2c->upper_level_icache[i]};
+        for (uint32_t level=0; level<3; level++) {
+            BLOCK *victim = find_block(private_caches[level], address);
+            if (victim == NULL)
+                continue;
+
+            removed++;
+            if (victim->dirty)
+                incl_back_inval_dirty++;
+            if ((level == 0) && victim->prefetch && !victim->used)
+                incl_back_inval_unused_pf++;
+            victim->valid = 0;
+            victim->dirty = 0;
+        }
+    }
+
+    if (removed) {
+        incl_victims++;
+        incl_back_inval += removed;
+        if (type == PREFETCH)
+            incl_back_inval_pf += removed;
+    }
+}
+
+void CACHE::llc_inclusion_final_stats()
+{
+    cout << NAME << "_inclusion_victims " << incl_victims << endl
+        << NAME << "_back_invalidations " << incl_back_inval << endl
+        << NAME << "_back_invalidations_dirty " << incl_back_inval_dirty << endl
+        << NAME << "_back_invalidations_on_prefetch_fill " << incl_back_inval_pf << endl
+        << NAME << "_back_invalidations_unused_prefetch " << incl_back_inval_unused_pf << endl
+        << NAME << "_exclusive_bypass_fills " << excl_bypass_fill << endl
+        << NAME << "_exclusive_hit_moves " << excl_hit_move << endl
+        << NAME << "_exclusive_victim_fills " << excl_victim_fill << endl
+        << endl;
+}
+
+// with a shared address space two cores can ask the LLC for the same line; the later request
+// rides on the earlier one and its core is noted in merged_cpus so the data goes to it too.
+// The owner's own bit stays set: an LLC-only prefetch does not hand the line up to its core.
+// Returns whether the request came from another core
+bool CACHE::merge_other_cpu(PACKET *into, PACKET *packet)
+{
+    if (cache_type != IS_LLC)
+        return false;
+
+    into->merged_cpus |= packet->merged_cpus;
+    if ((packet->cpu != into->cpu) && (packet->fill_level < fill_level))
+        into->merged_cpus |= 1u << packet->cpu;
+
+    return packet->cpu != into->cpu;
+}
+
+// the LLC handed a line to the requesting core; tell the directory and hand it to every core
+// whose request merged into this one
+void CACHE::shared_llc_return(PACKET *packet)
+{
+    if (directory && (packet->fill_level < fill_level)) {
+        if (packet->type == RFO)
+            directory->write(packet->cpu, packet->address);
+        else
+            directory->read(packet->cpu, packet->address);
+    }
+
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        if ((packet->merged_cpus & (1u << i)) == 0)
+            continue;
+        if ((i == packet->cpu) && (packet->fill_level < fill_level)) // the caller already returned it
+            continue;
+
+        PACKET merged = *packet;
+        merged.cpu = i;
+        merged.merged_cpus = 0;
+        if (directory)
+            directory->read(i, packet->address);
+
+        if (merged.instruction)
+            upper_level_icache[i]->return_data(&merged);
+        else // data
+            upper_level_dcache[i]->return_data(&merged);
+    }
+    packet->merged_cpus = 0;
+}
+
+// at the L2C an L1I and an L1D request for the same line can merge, as can an ITLB and a DTLB
+// request for the same page at the STLB; both upper levels are then waiting for it, whichever
+// of them the merged request's instruction bit names
+void CACHE::merge_dual_fill(PACKET *into, PACKET *packet)
+{
+    into->dual_fill |= packet->dual_fill;
+    if (((cache_type == IS_L2C) || (cache_type == IS_STLB)) && (into->fill_level < fill_level) && (packet->fill_level < fill_level) && (into->instruction != packet->instruction))
+        into->dual_fill = 1;
+}
+
+// the caller returned the line to the L1 named by packet->instruction, give it to the other one too
+void CACHE::return_dual_fill(PACKET *packet)
+{
+    if (!packet->dual_fill)
+        return;
+
+    PACKET other = *packet;
+    other.instruction = !packet->instruction;
+    other.dual_fill = 0;
+    if (other.instruction)
+        upper_level_icache[packet->cpu]->return_data(&other);
+    else // data
+        upper_level_dcache[packet->cpu]->return_data(&other);
+}
+
+// a compressed LLC keeps knob::llc_compression_tag_factor tags per line of data capacity; this runs
+// before the replacement policy and the prefetchers size their state by NUM_WAY
+void CACHE::llc_initialize_compression()
+{
+    if (!knob::llc_compression)
+        return;
+
+    assert(knob::llc_compression_tag_factor >= 1);
+    comp_set_segments = NUM_WAY * COMPRESSION_SEGMENTS;
+    NUM_WAY *= knob::llc_compression_tag_factor;
+    for (uint32_t i=0; i<NUM_SET; i++) {
+        delete[] block[i];
+        block[i] = new BLOCK[NUM_WAY];
+        for (uint32_t j=0; j<NUM_WAY; j++)
+            block[i][j].lru = j;
+    }
+    cout << "LLC_COMPRESSION: " << NUM_WAY << " tags and " << comp_set_segments << " data segments per set" << endl;
+}
+
+// besides the victim the fill replaces, evicts the least recently touched lines of the set until the
+// new line fits in its data budget. Returns false if a dirty line cannot be written back yet, the
+// fill then stalls like it does on its own victim
+bool CACHE::make_compressed_room(uint32_t set, uint32_t way, PACKET *packet)
+{
+    uint32_t used = compressed_segments(packet->address);
+    for (uint32_t i=0; i<NUM_WAY; i++) {
+        if ((i != way) && block[set][i].valid)
+            used += block[set][i].comp_size;
+    }
+
+    while (used > comp_set_segments) {
+        uint32_t victim = NUM_WAY;
+        for (uint32_t i=0; i<NUM_WAY; i++) {
+            if ((i == way) || !block[set][i].valid)
+                continue;
+            if ((victim == NUM_WAY) || (block[set][i].last_touch < block[set][victim].last_touch))
+                victim = i;
+        }
+        assert(victim < NUM_WAY);
+        BLOCK &line = block[set][victim];
+
+        uint8_t victim_dirty = line.dirty;
+        if ((inclusion == LLC_INCLUSIVE) && !victim_dirty)
+            victim_dirty = upper_level_dirty(line.address);
+
+        if (victim_dirty) {
+            if (lower_level->get_occupancy(2, line.address) == lower_level->get_size(2, line.address)) {
+                lower_level->increment_WQ_FULL(line.address);
+                return false;
+            }
+
+            PACKET writeback_packet;
+
+            writeback_packet.fill_level = fill_level << 1;
+            writeback_packet.cpu = packet->cpu;
+            writeback_packet.address = line.address;
+            writeback_packet.full_addr = line.full_addr;
+            writeback_packet.data = line.data;
+            writeback_packet.instr_id = packet->instr_id;
+            writeback_packet.ip = 0;
+            writeback_packet.type = WRITEBACK;
+            writeback_packet.event_cycle = current_core_cycle[packet->cpu];
+
+            lower_level->add_wq(&writeback_packet);
+            comp_evictions_dirty++;
+        }
+
+        if (inclusion == LLC_INCLUSIVE)
+            back_invalidate(line.address, packet->type);
+
+        comp_evictions++;
+        if (packet->type == PREFETCH)
+            comp_evictions_pf++;
+        if (line.prefetch && !line.used) {
+            comp_evictions_unused_pf++;
+            pf_useless++;
+        }
+
+        line.valid = 0;
+        line.dirty = 0;
+        line.prefetch = 0;
+        used -= line.comp_size;
+    }
+
+    return true;
+}
+
+void CACHE::llc_compression_final_stats()
+{
+    if (!comp_set_segments)
+        return;
+
+    // resident lines against an uncompressed cache of the same data capacity
+    uint64_t resident = 0;
+    for (uint32_t i=0; i<NUM_SET; i++) {
+        for (uint32_t j=0; j<NUM_WAY; j++)
+            resident += block[i][j].valid;
+    }
+
+    cout << NAME << "_compression_fills " << comp_fills << endl
+        << NAME << "_compression_avg_fill_segments " << (comp_fills ? (float)comp_fill_segments / comp_fills : 0) << endl
+        << NAME << "_compression_evictions " << comp_evictions << endl
+        << NAME << "_compression_evictions_dirty " << comp_evictions_dirty << endl
+        << NAME << "_compression_evictions_on_prefetch_fill " << comp_evictions_pf << endl
+        << NAME << "_compression_evictions_unused_prefetch " << comp_evictions_unused_pf << endl
+        << NAME << "_compression_effective_capacity " << (float)resident * COMPRESSION_SEGMENTS / (NUM_SET * comp_set_segments) << endl
+        << endl;
+}
+
+void CACHE::llc_initialize_slices(LLC_INTERCONNECT *slices)
+{
+    interconnect = slices;
+
+    PACKET_QUEUE *queues[4] = {&MSHR, &RQ, &WQ, &PQ};
+    for (uint32_t i=0; i<4; i++) {
+        queues[i]->interconnect = slices;
+        queues[i]->slice_occupancy.assign(slices->num_slices, 0);
+    }
+}
+
+bool CACHE::mshr_full(uint64_t address)
+{
+    if (MSHR.interconnect)
+        return get_occupancy(0, address) >= get_size(0, address);
+
+    return MSHR.occupancy == MSHR_SIZE;
+}
+
+// the memory controller wants to drop this in-flight prefetch; it may only go if no demand
+// merged into it here or in any upper level it was headed to, and then every level drops its MSHR entry.
+// A prefetch that other cores' requests merged into at the LLC is never dropped: only the owner's
+// upper levels would be told, so it is kept and counted instead
+int CACHE::drop_prefetch(PACKET *packet)
+{
+    int mshr_index = check_mshr(packet);
+    if (mshr_index == -1)
+        return 1;
+
+    PACKET *entry = &MSHR.entry[mshr_index];
+    if ((entry->type != PREFETCH) || (entry->returned == COMPLETED) || entry->dual_fill)
+        return 0;
+    if (entry->merged_cpus) {
+        pf_drop_refused_shared++;
+        return 0;
+    }
+
+    if (entry->fill_level < fill_level) {
+        MEMORY *upper = entry->instruction ? upper_level_icache[entry->cpu] : upper_level_dcache[entry->cpu];
+        if (upper->drop_prefetch(entry) == 0)
+            return 0;
+    }
+    else {
+        // the top of the chain tells the cache that issued the prefetch
+        CACHE *origin = this;
+        while (origin && (origin->fill_level > entry->pf_origin_level))
+            origin = (CACHE*)(entry->instruction ? origin->upper_level_icache[entry->cpu] : origin->upper_level_dcache[entry->cpu]);
+
+        if (origin && (origin->fill_level == entry->pf_origin_level)) {
+            uint64_t pf_addr = entry->address << LOG2_BLOCK_SIZE;
+            if (origin->cache_type == IS_L1D)
+                origin->l1d_prefetcher_prefetch_drop(pf_addr, entry->pf_metadata);
+            else if (origin->cache_type == IS_L2C)
+                origin->l2c_prefetcher_prefetch_drop(pf_addr, entry->pf_metadata);
+            else if (origin->cache_type == IS_LLC)
+                origin->llc_prefetcher_prefetch_drop(pf_addr, entry->pf_metadata);
+        }
+    }
+
+    MSHR.remove_queue(entry);
+    update_fill_cycle();
+
+    return 1;
+}
+
+void CACHE::promote_prefetch(uint64_t address)
+{
+    if (lower_level)
+        lower_level->promote_prefetch(address);
+}
+
 int CACHE::add_rq(PACKET *packet)
 {
     // check for the latest wirtebacks in the write queue
@@ -1272,6 +1896,9 @@ int CACHE::add_rq(PACKET *packet)
                 upper_level_icache[packet->cpu]->return_data(packet);
             else // data
                 upper_level_dcache[packet->cpu]->return_data(packet);
+
+            if ((NUM_CPUS > 1) && (cache_type == IS_LLC))
+                shared_llc_return(packet);
         }
 
 #ifdef SANITY_CHECK
@@ -1293,8 +1920,16 @@ int CACHE::add_rq(PACKET *packet)
             cout << " index: " << MAX_READ << " rob_signal: " << packet->rob_signal << endl; });
         }
 
-        HIT[packet->type]++;
-        ACCESS[packet->type]++;
+        if (packet->wrong_path && !packet->load_merged)
+        {
+            wp_hit++;
+            wp_access++;
+        }
+        else
+        {
+            HIT[packet->type]++;
+            ACCESS[packet->type]++;
+        }
 
         WQ.FORWARD++;
         RQ.ACCESS++;
@@ -1304,8 +1939,15 @@ int CACHE::add_rq(PACKET *packet)
 
     // check for duplicates in the read queue
     int index = RQ.check_queue(packet);
+    if ((NUM_CPUS > 1) && (index != -1) && merge_other_cpu(&RQ.entry[index], packet)) {
+        RQ.MERGED++;
+        RQ.ACCESS++;
+
+        return index; // merged index
+    }
     if (index != -1) {
-        
+
+        merge_dual_fill(&RQ.entry[index], packet);
         if (packet->instruction) {
             uint32_t rob_index = packet->rob_index;
             RQ.entry[index].rob_index_depend_on_me.insert (rob_index);
@@ -1326,8 +1968,10 @@ int CACHE::add_rq(PACKET *packet)
             }
             else {
                 uint32_t lq_index = packet->lq_index; 
-                RQ.entry[index].lq_index_depend_on_me.insert (lq_index);
-                RQ.entry[index].load_merged = 1;
+                if (!packet->wrong_path) {
+                    RQ.entry[index].lq_index_depend_on_me.insert (lq_index);
+                    RQ.entry[index].load_merged = 1;
+                }
 
                 DP (if (warmup_complete[packet->cpu]) {
                 cout << "[DATA_MERGED] " << __func__ << " cpu: " << packet->cpu << " instr_id: " << RQ.entry[index].instr_id;
@@ -1342,7 +1986,7 @@ int CACHE::add_rq(PACKET *packet)
     }
 
     // check occupancy
-    if (RQ.occupancy == RQ_SIZE) {
+    if ((RQ.occupancy == RQ_SIZE) || (RQ.interconnect && (get_occupancy(1, packet->address) >= get_size(1, packet->address)))) {
         RQ.FULL++;
 
         return -2; // cannot handle this request
@@ -1362,6 +2006,10 @@ int CACHE::add_rq(PACKET *packet)
 
     RQ.entry[index] = *packet;
 
+    // the request crosses the interconnect to its LLC slice first
+    if (interconnect && (cache_type == IS_LLC))
+        RQ.entry[index].event_cycle = interconnect->to_slice(packet->cpu, packet->address, max(RQ.entry[index].event_cycle, current_core_cycle[packet->cpu]));
+
     // ADD LATENCY
     if (RQ.entry[index].event_cycle < current_core_cycle[packet->cpu])
         RQ.entry[index].event_cycle = current_core_cycle[packet->cpu] + LATENCY;
@@ -1369,6 +2017,7 @@ int CACHE::add_rq(PACKET *packet)
         RQ.entry[index].event_cycle += LATENCY;
 
     RQ.occupancy++;
+    RQ.add_slice_occupancy(packet->address);
     RQ.tail++;
     if (RQ.tail >= RQ.SIZE)
         RQ.tail = 0;
@@ -1390,6 +2039,10 @@ int CACHE::add_rq(PACKET *packet)
 
 int CACHE::add_wq(PACKET *packet)
 {
+    // the core's L2C gave the line up
+    if (directory && (cache_type == IS_LLC))
+        directory->writeback(packet->cpu, packet->address);
+
     // check for duplicates in the write queue
     int index = WQ.check_queue(packet);
     if (index != -1) {
@@ -1400,8 +2053,8 @@ int CACHE::add_wq(PACKET *packet)
         return index; // merged index
     }
 
-    // sanity check
-    if (WQ.occupancy >= WQ.SIZE)
+    // sanity check, callers wait for room in the WQ (in the slice's share of it for a sliced LLC)
+    if ((WQ.occupancy >= WQ.SIZE) || (WQ.interconnect && (get_occupancy(2, packet->address) >= get_size(2, packet->address))))
         assert(0);
 
     // if there is no duplicate, add it to the write queue
@@ -1415,6 +2068,10 @@ int CACHE::add_wq(PACKET *packet)
 
     WQ.entry[index] = *packet;
 
+    // writebacks cross the interconnect to their LLC slice first
+    if (interconnect && (cache_type == IS_LLC))
+        WQ.entry[index].event_cycle = interconnect->to_slice(packet->cpu, packet->address, max(WQ.entry[index].event_cycle, current_core_cycle[packet->cpu]));
+
     // ADD LATENCY
     if (WQ.entry[index].event_cycle < current_core_cycle[packet->cpu])
         WQ.entry[index].event_cycle = current_core_cycle[packet->cpu] + LATENCY;
@@ -1422,6 +2079,7 @@ int CACHE::add_wq(PACKET *packet)
         WQ.entry[index].event_cycle += LATENCY;
 
     WQ.occupancy++;
+    WQ.add_slice_occupancy(packet->address);
     WQ.tail++;
     if (WQ.tail >= WQ.SIZE)
         WQ.tail = 0;
@@ -1446,6 +2104,7 @@ int CACHE::prefetch_line(uint64_t ip, uint64_t base_addr, uint64_t pf_addr, int
     if (PQ.occupancy < PQ.SIZE) 
     {
         PACKET pf_packet;
+        pf_packet.instruction = (cache_type == IS_L1I) ? 1 : 0; // routes the fill back to L1I
         pf_packet.fill_level = pf_fill_level;
         pf_packet.pf_origin_level = fill_level;
         pf_packet.pf_metadata = prefetch_metadata;
@@ -1474,6 +2133,41 @@ int CACHE::prefetch_line(uint64_t ip, uint64_t base_addr, uint64_t pf_addr, int
     return 0;
 }
 
+// prefetches the translation of a virtual page into the STLB. Prefetches never fault, so pages
+// that are not mapped yet are skipped
+int CACHE::prefetch_translation(uint64_t ip, uint64_t pf_vpage)
+{
+    uint64_t pa;
+    if (!lookup_vpage_to_pa(cpu, pf_vpage, pf_vpage << LOG2_PAGE_SIZE, pa))
+        return 0;
+
+    pf_requested++;
+
+    if (PQ.occupancy < PQ.SIZE) 
+    {
+        PACKET pf_packet;
+        pf_packet.fill_level = fill_level;
+        pf_packet.pf_origin_level = fill_level;
+        pf_packet.cpu = cpu;
+        pf_packet.address = pf_vpage;
+        pf_packet.full_addr = pf_vpage << LOG2_PAGE_SIZE;
+        pf_packet.ip = ip;
+        pf_packet.type = PREFETCH;
+        pf_packet.event_cycle = current_core_cycle[cpu];
+
+        add_pq(&pf_packet);
+        pf_issued++;
+
+        return 1;
+    } 
+    else 
+    {
+        pf_dropped++;
+    }
+
+    return 0;
+}
+
 int CACHE::kpc_prefetch_line(uint64_t base_addr, uint64_t pf_addr, int pf_fill_level, int delta, int depth, int signature, int confidence, uint32_t prefetch_metadata)
 {
     if (PQ.occupancy < PQ.SIZE) {
@@ -1528,6 +2222,9 @@ int CACHE::add_pq(PACKET *packet)
             {
                 upper_level_dcache[packet->cpu]->return_data(packet);
             }
+
+            if ((NUM_CPUS > 1) && (cache_type == IS_LLC))
+                shared_llc_return(packet);
         }
 
         HIT[packet->type]++;
@@ -1541,11 +2238,20 @@ int CACHE::add_pq(PACKET *packet)
 
     // check for duplicates in the PQ
     int index = PQ.check_queue(packet);
+    if ((NUM_CPUS > 1) && (index != -1) && merge_other_cpu(&PQ.entry[index], packet))
+    {
+        PQ.MERGED++;
+        PQ.ACCESS++;
+
+        return index; // merged index
+    }
     if (index != -1)
     {
+        merge_dual_fill(&PQ.entry[index], packet);
         if (packet->fill_level < PQ.entry[index].fill_level)
         {
             PQ.entry[index].fill_level = packet->fill_level;
+            PQ.entry[index].instruction = packet->instruction; // the new requester decides which upper level gets the fill
         }
 
         PQ.MERGED++;
@@ -1555,7 +2261,7 @@ int CACHE::add_pq(PACKET *packet)
     }
 
     // check occupancy
-    if (PQ.occupancy == PQ_SIZE)
+    if ((PQ.occupancy == PQ_SIZE) || (PQ.interconnect && (get_occupancy(3, packet->address) >= get_size(3, packet->address))))
     {
         PQ.FULL++;
 
@@ -1579,6 +2285,10 @@ int CACHE::add_pq(PACKET *packet)
 
     PQ.entry[index] = *packet;
 
+    // prefetches from the levels above cross the interconnect to their LLC slice first
+    if (interconnect && (cache_type == IS_LLC) && (packet->pf_origin_level < fill_level))
+        PQ.entry[index].event_cycle = interconnect->to_slice(packet->cpu, packet->address, max(PQ.entry[index].event_cycle, current_core_cycle[packet->cpu]));
+
     // ADD LATENCY
     if (PQ.entry[index].event_cycle < current_core_cycle[packet->cpu])
     {
@@ -1590,6 +2300,7 @@ int CACHE::add_pq(PACKET *packet)
     }
 
     PQ.occupancy++;
+    PQ.add_slice_occupancy(packet->address);
     PQ.tail++;
     if (PQ.tail >= PQ.SIZE)
     {
@@ -1634,6 +2345,10 @@ void CACHE::return_data(PACKET *packet)
     MSHR.entry[mshr_index].data = packet->data;
     MSHR.entry[mshr_index].pf_metadata = packet->pf_metadata;
 
+    // the line crosses the interconnect back from its LLC slice
+    if (interconnect && (cache_type == IS_L2C))
+        MSHR.entry[mshr_index].event_cycle = interconnect->to_core(packet->address, cpu, max(MSHR.entry[mshr_index].event_cycle, current_core_cycle[cpu]));
+
     // ADD LATENCY
     if (MSHR.entry[mshr_index].event_cycle < current_core_cycle[packet->cpu])
         MSHR.entry[mshr_index].event_cycle = current_core_cycle[packet->cpu] + LATENCY;
@@ -1723,6 +2438,9 @@ void CACHE::add_mshr(PACKET *packet)
             MSHR.entry[index] = *packet;
             MSHR.entry[index].returned = INFLIGHT;
             MSHR.occupancy++;
+            MSHR.add_slice_occupancy(packet->address);
+            if (interconnect && (cache_type == IS_LLC))
+                interconnect->slice_misses[interconnect->get_slice(packet->address)]++;
 
             DP ( if (warmup_complete[packet->cpu]) {
             cout << "[" << NAME << "_MSHR] " << __func__ << " instr_id: " << packet->instr_id;
@@ -1803,6 +2521,12 @@ void CACHE::broadcast_bw(uint8_t bw_level)
 
 uint32_t CACHE::get_occupancy(uint8_t queue_type, uint64_t address)
 {
+    // a sliced LLC reports the address's slice
+    if (MSHR.interconnect && (queue_type <= 3)) {
+        PACKET_QUEUE *queues[4] = {&MSHR, &RQ, &WQ, &PQ};
+        return queues[queue_type]->slice_occupancy[interconnect->get_slice(address)];
+    }
+
     if (queue_type == 0)
         return MSHR.occupancy;
     else if (queue_type == 1)
@@ -1817,6 +2541,12 @@ uint32_t CACHE::get_occupancy(uint8_t queue_type, uint64_t address)
 
 uint32_t CACHE::get_size(uint8_t queue_type, uint64_t address)
 {
+    // each slice of a sliced LLC gets an even share of every queue
+    if (MSHR.interconnect && (queue_type <= 3)) {
+        PACKET_QUEUE *queues[4] = {&MSHR, &RQ, &WQ, &PQ};
+        return queues[queue_type]->SIZE / interconnect->num_slices;
+    }
+
     if (queue_type == 0)
         return MSHR.SIZE;
     else if (queue_type == 1)
@@ -0,0 +1,50 @@
+#include <vector>
+#include "compression.h"
+
+namespace knob
+{
+    extern vector<float> compression_size_dist;
+}
+
+// share of lines per size in segments when knob::compression_size_dist is not given
+static const float default_size_dist[COMPRESSION_SEGMENTS] = {0.20, 0.10, 0.15, 0, 0.15, 0, 0, 0.40};
+
+// cumulative share of lines of up to i+1 segments, scaled to 2^24
+static uint64_t size_cdf[COMPRESSION_SEGMENTS];
+
+void initialize_compression()
+{
+    vector<float> dist = knob::compression_size_dist;
+    if (dist.empty())
+        dist.assign(default_size_dist, default_size_dist + COMPRESSION_SEGMENTS);
+    if (dist.size() != COMPRESSION_SEGMENTS) {
+        cout << "compression_size_dist needs " << COMPRESSION_SEGMENTS << " entries, one per line size in segments" << endl;
+        exit(1);
+    }
+
+    float total = 0;
+    for (uint32_t i=0; i<COMPRESSION_SEGMENTS; i++)
+        total += dist[i];
+    assert(total > 0);
+
+    float sum = 0;
+    cout << "compression_size_dist";
+    for (uint32_t i=0; i<COMPRESSION_SEGMENTS; i++) {
+        sum += dist[i];
+        size_cdf[i] = (uint64_t)(sum / total * (1ull << 24));
+        cout << " " << dist[i] / total;
+    }
+    size_cdf[COMPRESSION_SEGMENTS-1] = 1ull << 24;
+    cout << endl;
+}
+
+uint32_t compressed_segments(uint64_t block_address)
+{
+    uint64_t hash = (block_address * 0x9E3779B97F4A7C15ull) >> 40;
+    for (uint32_t i=0; i<COMPRESSION_SEGMENTS; i++) {
+        if (hash < size_cdf[i])
+            return i + 1;
+    }
+
+    return COMPRESSION_SEGMENTS;
+}
@@ -0,0 +1,167 @@
+#include "directory.h"
+#include "cache.h"
+
+COHERENCE_DIRECTORY::COHERENCE_DIRECTORY()
+{
+    // sharers and PACKET::merged_cpus keep one bit per core
+    assert(NUM_CPUS <= 32);
+
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        L1I[i] = NULL;
+        L1D[i] = NULL;
+        L2C[i] = NULL;
+    }
+    LLC = NULL;
+
+    reset_stats();
+}
+
+// called at the end of warmup; the sharer state and the lines taken from each core are kept
+void COHERENCE_DIRECTORY::reset_stats()
+{
+    reads = 0;
+    writes = 0;
+    upgrades = 0;
+    invalidations = 0;
+    invalidations_dirty = 0;
+    downgrades = 0;
+    downgrades_dirty = 0;
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        coherence_misses[i] = 0;
+        lines_invalidated[i] = 0;
+    }
+}
+
+// the core missed on a line coherence had taken from it
+void COHERENCE_DIRECTORY::check_coherence_miss(uint32_t cpu, uint64_t address)
+{
+    if (invalidated[cpu].erase(address))
+        coherence_misses[cpu]++;
+}
+
+// invalidates or, for a downgrade, cleans the core's private copies of the line and returns
+// whether one was dirty. The LLC takes the dirty data if it holds the line; a downgraded copy
+// otherwise stays dirty and writes it back when evicted
+uint8_t COHERENCE_DIRECTORY::remove_copies(uint32_t cpu, uint64_t address, uint8_t invalidate)
+{
+    uint32_t llc_set = LLC->get_set(address), llc_way = LLC->get_way(address, llc_set);
+    uint8_t  llc_holds = (llc_way < LLC->NUM_WAY), found = 0, dirty = 0;
+
+    CACHE *private_caches[3] = {L2C[cpu], L1D[cpu], L1I[cpu]};
+    for (uint32_t level=0; level<3; level++) {
+        CACHE *cache = private_caches[level];
+        uint32_t set = cache->get_set(address), way = cache->get_way(address, set);
+        if (way == cache->NUM_WAY)
+            continue;
+
+        BLOCK &line = cache->block[set][way];
+        found = 1;
+        if (line.dirty)
+            dirty = 1;
+        if (invalidate) {
+            line.valid = 0;
+            line.dirty = 0;
+        }
+        else if (llc_holds)
+            line.dirty = 0;
+    }
+
+    if (dirty && llc_holds)
+        LLC->block[llc_set][llc_way].dirty = 1;
+
+    if (invalidate && found) {
+        invalidated[cpu].insert(address);
+        lines_invalidated[cpu]++;
+        invalidations++;
+        if (dirty)
+            invalidations_dirty++;
+    }
+
+    return dirty;
+}
+
+// the LLC hands a line to a core for reading: an owner elsewhere drops to Shared, and the core
+// gets the line Exclusive if no other core holds it
+void COHERENCE_DIRECTORY::read(uint32_t cpu, uint64_t address)
+{
+    reads++;
+    check_coherence_miss(cpu, address);
+
+    DIRECTORY_ENTRY &entry = entries[address];
+    if ((entry.owner >= 0) && (entry.owner != (int32_t)cpu)) {
+        downgrades++;
+        if (remove_copies(entry.owner, address, 0))
+            downgrades_dirty++;
+        entry.owner = -1;
+    }
+
+    if ((entry.sharers & ~(1u << cpu)) == 0)
+        entry.owner = cpu;
+    entry.sharers |= 1u << cpu;
+}
+
+// the LLC hands a line to a core for writing (RFO): every other copy is invalidated
+void COHERENCE_DIRECTORY::write(uint32_t cpu, uint64_t address)
+{
+    writes++;
+    check_coherence_miss(cpu, address);
+    take_ownership(cpu, address);
+}
+
+// the core's L1D takes a store to a line it already holds; Exclusive and Modified lines need
+// nothing, Shared ones invalidate the other copies first
+void COHERENCE_DIRECTORY::upgrade(uint32_t cpu, uint64_t address)
+{
+    DIRECTORY_ENTRY &entry = entries[address];
+    if (entry.owner == (int32_t)cpu)
+        return;
+
+    upgrades++;
+    take_ownership(cpu, address);
+}
+
+void COHERENCE_DIRECTORY::take_ownership(uint32_t cpu, uint64_t address)
+{
+    DIRECTORY_ENTRY &entry = entries[address];
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        if ((i != cpu) && (entry.sharers & (1u << i)))
+            remove_copies(i, address, 1);
+    }
+
+    entry.sharers = 1u << cpu;
+    entry.owner = cpu;
+}
+
+// the core's L2C wrote the line back; it is gone from the core unless its L1s still hold it
+void COHERENCE_DIRECTORY::writeback(uint32_t cpu, uint64_t address)
+{
+    unordered_map<uint64_t, DIRECTORY_ENTRY>::iterator it = entries.find(address);
+    if (it == entries.end())
+        return;
+
+    uint32_t l1d_set = L1D[cpu]->get_set(address), l1i_set = L1I[cpu]->get_set(address);
+    if ((L1D[cpu]->get_way(address, l1d_set) < L1D[cpu]->NUM_WAY) || (L1I[cpu]->get_way(address, l1i_set) < L1I[cpu]->NUM_WAY))
+        return;
+
+    it->second.sharers &= ~(1u << cpu);
+    if (it->second.owner == (int32_t)cpu)
+        it->second.owner = -1;
+    if (it->second.sharers == 0)
+        entries.erase(it);
+}
+
+void COHERENCE_DIRECTORY::final_stats()
+{
+    cout << "DIRECTORY_reads " << reads << endl
+        << "DIRECTORY_writes " << writes << endl
+        << "DIRECTORY_upgrades " << upgrades << endl
+        << "DIRECTORY_invalidations " << invalidations << endl
+        << "DIRECTORY_invalidations_dirty " << invalidations_dirty << endl
+        << "DIRECTORY_downgrades " << downgrades << endl
+        << "DIRECTORY_downgrades_dirty " << downgrades_dirty << endl
+        << "DIRECTORY_entries " << entries.size() << endl;
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        cout << "Core_" << i << "_coherence_misses " << coherence_misses[i] << endl
+            << "Core_" << i << "_lines_invalidated " << lines_invalidated[i] << endl;
+    cout << endl;
+}
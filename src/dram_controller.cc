@@ -1,9 +1,85 @@
 #include "dram_controller.h"
+#include "compression.h"
 
 // initialized in main.cc
 uint32_t DRAM_MTPS, DRAM_DBUS_RETURN_TIME, DRAM_DBUS_MAX_CAS,
          tRP, tRCD, tCAS;
 
+// initialized in dram_initialize_timing()
+uint32_t tRRD_S, tRRD_L, tFAW, tCCD_S, tCCD_L, tREFI, tRFC,
+         DRAM_BANK_GROUPS = 1, DRAM_SUB_CHANNELS = 1;
+
+// initialized in NUMA_INTERCONNECT::initialize()
+uint32_t DRAM_INTERLEAVE_SHIFT = 0, DRAM_NODE_SHIFT, NUMA_REMOTE_LATENCY = 0;
+
+namespace knob
+{
+    extern bool     dram_detailed_timing;
+    extern string   dram_standard;
+    extern uint32_t dram_bank_groups;
+    extern float    dram_tRRD_S;
+    extern float    dram_tRRD_L;
+    extern float    dram_tFAW;
+    extern float    dram_tCCD_S;
+    extern float    dram_tCCD_L;
+    extern float    dram_tREFI;
+    extern float    dram_tRFC;
+    extern bool     dram_demand_first;
+    extern uint64_t dram_prefetch_promote_age;
+    extern bool     dram_prefetch_drop;
+    extern uint32_t dram_prefetch_drop_watermark;
+    extern uint64_t dram_prefetch_drop_age;
+    extern uint32_t dram_telemetry_cycle_shift;
+    extern uint32_t dram_telemetry_event_shift;
+    extern uint32_t dram_controllers;
+    extern uint32_t dram_interleave_granularity;
+    extern string   numa_placement;
+    extern float    numa_remote_latency;
+    extern bool     dram_compression;
+}
+
+// a timing knob left at 0 takes the default of the selected standard
+static uint32_t dram_ns_to_cycles(float knob_ns, float default_ns)
+{
+    return (uint32_t)((1.0 * (knob_ns ? knob_ns : default_ns) * CPU_FREQ) / 1000);
+}
+
+void dram_initialize_timing()
+{
+    if (!knob::dram_detailed_timing)
+        return;
+
+    // defaults are DDR4-2400 x16 (two bank groups of four banks) and DDR5-4800 x8, 16Gb devices
+    bool ddr5;
+    if (!knob::dram_standard.compare("ddr4"))
+        ddr5 = false;
+    else if (!knob::dram_standard.compare("ddr5"))
+        ddr5 = true;
+    else {
+        cout << "unsupported DRAM standard " << knob::dram_standard << endl;
+        exit(1);
+    }
+
+    tRRD_S = dram_ns_to_cycles(knob::dram_tRRD_S, ddr5 ? 3.3  : 5.3);
+    tRRD_L = dram_ns_to_cycles(knob::dram_tRRD_L, ddr5 ? 5.0  : 6.4);
+    tFAW   = dram_ns_to_cycles(knob::dram_tFAW,   ddr5 ? 13.3 : 30.0);
+    tCCD_S = dram_ns_to_cycles(knob::dram_tCCD_S, ddr5 ? 3.3  : 3.3);
+    tCCD_L = dram_ns_to_cycles(knob::dram_tCCD_L, ddr5 ? 5.0  : 5.0);
+    tREFI  = dram_ns_to_cycles(knob::dram_tREFI,  ddr5 ? 3900 : 7800);
+    tRFC   = dram_ns_to_cycles(knob::dram_tRFC,   ddr5 ? 295  : 350);
+
+    DRAM_SUB_CHANNELS = ddr5 ? 2 : 1;
+    DRAM_BANK_GROUPS = knob::dram_bank_groups;
+    if (DRAM_BANK_GROUPS == 0 || (DRAM_BANK_GROUPS & (DRAM_BANK_GROUPS - 1)) || DRAM_BANK_GROUPS > DRAM_BANKS / DRAM_SUB_CHANNELS) {
+        cout << "dram_bank_groups must be a power of two no larger than " << DRAM_BANKS / DRAM_SUB_CHANNELS << endl;
+        exit(1);
+    }
+
+    cout << "DRAM_DETAILED_TIMING: " << knob::dram_standard << " sub_channels " << DRAM_SUB_CHANNELS << " bank_groups " << DRAM_BANK_GROUPS
+        << " tRRD_S " << tRRD_S << " tRRD_L " << tRRD_L << " tFAW " << tFAW << " tCCD_S " << tCCD_S << " tCCD_L " << tCCD_L
+        << " tREFI " << tREFI << " tRFC " << tRFC << " (CPU cycles)" << endl;
+}
+
 void print_dram_config()
 {
     cout << "dram_channel_width " << DRAM_CHANNEL_WIDTH << endl
@@ -18,6 +94,21 @@ void print_dram_config()
         << "min_dram_writes_per_switch " << MIN_DRAM_WRITES_PER_SWITCH << endl
         << "dram_mtps " << DRAM_MTPS << endl
         << "dram_dbus_return_time " << DRAM_DBUS_RETURN_TIME << endl
+        << "dram_detailed_timing " << knob::dram_detailed_timing << endl
+        << "dram_standard " << knob::dram_standard << endl
+        << "dram_bank_groups " << knob::dram_bank_groups << endl
+        << "dram_demand_first " << knob::dram_demand_first << endl
+        << "dram_prefetch_promote_age " << knob::dram_prefetch_promote_age << endl
+        << "dram_prefetch_drop " << knob::dram_prefetch_drop << endl
+        << "dram_prefetch_drop_watermark " << knob::dram_prefetch_drop_watermark << endl
+        << "dram_prefetch_drop_age " << knob::dram_prefetch_drop_age << endl
+        << "dram_telemetry_cycle_shift " << knob::dram_telemetry_cycle_shift << endl
+        << "dram_telemetry_event_shift " << knob::dram_telemetry_event_shift << endl
+        << "dram_controllers " << knob::dram_controllers << endl
+        << "dram_interleave_granularity " << knob::dram_interleave_granularity << endl
+        << "numa_placement " << knob::numa_placement << endl
+        << "numa_remote_latency " << knob::numa_remote_latency << endl
+        << "dram_compression " << knob::dram_compression << endl
         << endl;
 }
 
@@ -43,6 +134,10 @@ void MEMORY_CONTROLLER::reset_remain_requests(PACKET_QUEUE *queue, uint32_t chan
             else
                 bank_request[op_channel][op_rank][op_bank].open_row = UINT32_MAX;
 
+            // the activate and column command it had not issued yet are not held against later requests
+            if (knob::dram_detailed_timing)
+                cancel_reservation(op_channel, op_rank, op_bank, current_core_cycle[op_cpu]);
+
             // this bank is ready for another DRAM request
             bank_request[op_channel][op_rank][op_bank].request_index = -1;
             bank_request[op_channel][op_rank][op_bank].row_buffer_hit = 0;
@@ -86,6 +181,12 @@ void MEMORY_CONTROLLER::reset_remain_requests(PACKET_QUEUE *queue, uint32_t chan
 void MEMORY_CONTROLLER::operate()
 {
     for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
+        channel_cycle[i]++;
+        if (knob::dram_detailed_timing)
+            operate_refresh(i);
+
+        update_telemetry(i);
+
         //if ((write_mode[i] == 0) && (WQ[i].occupancy >= DRAM_WRITE_HIGH_WM)) {
       if ((write_mode[i] == 0) && ((WQ[i].occupancy >= DRAM_WRITE_HIGH_WM) || ((RQ[i].occupancy == 0) && (WQ[i].occupancy > 0)))) { // use idle cycles to perform writes
             write_mode[i] = 1;
@@ -94,6 +195,8 @@ void MEMORY_CONTROLLER::operate()
             reset_remain_requests(&RQ[i], i);
             // add data bus turn-around time
             dbus_cycle_available[i] += DRAM_DBUS_TURN_AROUND_TIME;
+            for (uint32_t j=0; j<DRAM_SUB_CHANNELS; j++)
+                sub_dbus_cycle_available[i][j] += DRAM_DBUS_TURN_AROUND_TIME;
         } else if (write_mode[i]) {
 
             if (WQ[i].occupancy == 0)
@@ -106,6 +209,8 @@ void MEMORY_CONTROLLER::operate()
                 reset_remain_requests(&WQ[i], i);
                 // add data bus turnaround time
                 dbus_cycle_available[i] += DRAM_DBUS_TURN_AROUND_TIME;
+                for (uint32_t j=0; j<DRAM_SUB_CHANNELS; j++)
+                    sub_dbus_cycle_available[i][j] += DRAM_DBUS_TURN_AROUND_TIME;
             }
         }
 
@@ -123,6 +228,10 @@ void MEMORY_CONTROLLER::operate()
         }
 
         // handle read
+        // make room for demands by dropping prefetches that waited too long
+        if (knob::dram_prefetch_drop && (write_mode[i] == 0) && (RQ[i].occupancy >= knob::dram_prefetch_drop_watermark))
+            drop_stale_prefetch(i);
+
         // schedule new entry
         if ((write_mode[i] == 0) && (RQ[i].next_schedule_index < RQ[i].SIZE)) {
             if (RQ[i].next_schedule_cycle <= current_core_cycle[RQ[i].entry[RQ[i].next_schedule_index].cpu])
@@ -146,6 +255,22 @@ void MEMORY_CONTROLLER::schedule(PACKET_QUEUE *queue)
     int oldest_index = -1;
     uint64_t oldest_cycle = UINT64_MAX;
 
+    // demand-first: while a demand (or an aged prefetch) can be scheduled, prefetches wait
+    uint8_t critical_only = 0;
+    if (knob::dram_demand_first && !queue->is_WQ) {
+        for (uint32_t i=0; i<queue->SIZE; i++) {
+            read_addr = queue->entry[i].address;
+            if (queue->entry[i].scheduled || (read_addr == 0))
+                continue;
+            if (bank_request[dram_get_channel(read_addr)][dram_get_rank(read_addr)][dram_get_bank(read_addr)].working)
+                continue;
+            if (is_critical(&queue->entry[i])) {
+                critical_only = 1;
+                break;
+            }
+        }
+    }
+
     // first, search for the oldest open row hit
     for (uint32_t i=0; i<queue->SIZE; i++) {
 
@@ -153,6 +278,9 @@ void MEMORY_CONTROLLER::schedule(PACKET_QUEUE *queue)
         if (queue->entry[i].scheduled) 
             continue;
 
+        if (critical_only && !is_critical(&queue->entry[i]))
+            continue;
+
         // empty entry
         read_addr = queue->entry[i].address;
         if (read_addr == 0) 
@@ -174,6 +302,10 @@ void MEMORY_CONTROLLER::schedule(PACKET_QUEUE *queue)
             continue;
         }
 
+        // rank is refreshing or about to
+        if (knob::dram_detailed_timing && (refresh_pending[read_channel][read_rank] || (refresh_until[read_channel][read_rank] > channel_cycle[read_channel])))
+            continue;
+
         read_row = dram_get_row(read_addr);
         //read_column = dram_get_column(read_addr);
 
@@ -208,6 +340,9 @@ void MEMORY_CONTROLLER::schedule(PACKET_QUEUE *queue)
             if (queue->entry[i].scheduled)
                 continue;
 
+            if (critical_only && !is_critical(&queue->entry[i]))
+                continue;
+
             // empty entry
             read_addr = queue->entry[i].address;
             if (read_addr == 0) 
@@ -219,6 +354,8 @@ void MEMORY_CONTROLLER::schedule(PACKET_QUEUE *queue)
             read_bank = dram_get_bank(read_addr);
             if (bank_request[read_channel][read_rank][read_bank].working) 
                 continue;
+            if (knob::dram_detailed_timing && (refresh_pending[read_channel][read_rank] || (refresh_until[read_channel][read_rank] > channel_cycle[read_channel])))
+                continue;
 
             //read_row = dram_get_row(read_addr);
             //read_column = dram_get_column(read_addr);
@@ -234,12 +371,6 @@ void MEMORY_CONTROLLER::schedule(PACKET_QUEUE *queue)
     // at this point, the scheduler knows which bank to access and if the request is a row buffer hit or miss
     if (oldest_index != -1) { // scheduler might not find anything if all requests are already scheduled or all banks are busy
 
-        uint64_t LATENCY = 0;
-        if (row_buffer_hit)  
-            LATENCY = tCAS;
-        else 
-            LATENCY = tRP + tRCD + tCAS;
-
         uint64_t op_addr = queue->entry[oldest_index].address;
         uint32_t op_cpu = queue->entry[oldest_index].cpu,
                  op_channel = dram_get_channel(op_addr), 
@@ -250,6 +381,14 @@ void MEMORY_CONTROLLER::schedule(PACKET_QUEUE *queue)
         uint32_t op_column = dram_get_column(op_addr);
 #endif
 
+        uint64_t LATENCY = 0;
+        if (knob::dram_detailed_timing)
+            LATENCY = detailed_latency(op_channel, op_rank, op_bank, row_buffer_hit, current_core_cycle[op_cpu]);
+        else if (row_buffer_hit)  
+            LATENCY = tCAS;
+        else 
+            LATENCY = tRP + tRCD + tCAS;
+
         // this bank is now busy
         bank_request[op_channel][op_rank][op_bank].working = 1;
         bank_request[op_channel][op_rank][op_bank].working_type = queue->entry[oldest_index].type;
@@ -268,6 +407,8 @@ void MEMORY_CONTROLLER::schedule(PACKET_QUEUE *queue)
             scheduled_reads[op_channel]++;
         }
 
+        record_schedule(op_channel, &queue->entry[oldest_index], !queue->is_WQ, row_buffer_hit);
+
         // update open row
         bank_request[op_channel][op_rank][op_bank].open_row = op_row;
 
@@ -312,15 +453,27 @@ void MEMORY_CONTROLLER::process(PACKET_QUEUE *queue)
         assert(0);
     }
 
+    // a DDR5 sub-channel is half as wide, so a block takes twice as long on its data bus
+    uint64_t &dbus_cycle = dbus_available(op_channel, op_bank);
+    uint32_t dbus_return_time = DRAM_DBUS_RETURN_TIME * DRAM_SUB_CHANNELS, dbus_saved = 0;
+
+    // a compressed line only takes the half bursts it fills
+    if (knob::dram_compression) {
+        uint32_t bursts = (compressed_segments(op_addr) + COMPRESSION_DRAM_BURST_SEGMENTS - 1) / COMPRESSION_DRAM_BURST_SEGMENTS;
+        dbus_saved = dbus_return_time - dbus_return_time * bursts * COMPRESSION_DRAM_BURST_SEGMENTS / COMPRESSION_SEGMENTS;
+        dbus_return_time -= dbus_saved;
+    }
+
     // paid all DRAM access latency, data is ready to be processed
     if (bank_request[op_channel][op_rank][op_bank].cycle_available <= current_core_cycle[op_cpu]) {
 
         // check if data bus is available
-        if (dbus_cycle_available[op_channel] <= current_core_cycle[op_cpu]) {
+        if (dbus_cycle <= current_core_cycle[op_cpu]) {
 
             if (queue->is_WQ) {
                 // update data bus cycle time
-                dbus_cycle_available[op_channel] = current_core_cycle[op_cpu] + DRAM_DBUS_RETURN_TIME;
+                dbus_cycle = current_core_cycle[op_cpu] + dbus_return_time;
+                dbus_cycles_saved[op_channel] += dbus_saved;
 
                 if (bank_request[op_channel][op_rank][op_bank].row_buffer_hit)
                     queue->ROW_BUFFER_HIT++;
@@ -337,8 +490,9 @@ void MEMORY_CONTROLLER::process(PACKET_QUEUE *queue)
                 scheduled_writes[op_channel]--;
             } else {
                 // update data bus cycle time
-                dbus_cycle_available[op_channel] = current_core_cycle[op_cpu] + DRAM_DBUS_RETURN_TIME;
-                queue->entry[request_index].event_cycle = dbus_cycle_available[op_channel]; 
+                dbus_cycle = current_core_cycle[op_cpu] + dbus_return_time;
+                dbus_cycles_saved[op_channel] += dbus_saved;
+                queue->entry[request_index].event_cycle = dbus_cycle; 
 
                 DP ( if (warmup_complete[op_cpu]) {
                 cout << "[" << queue->NAME << "] " <<  __func__ << " return data" << hex;
@@ -349,6 +503,7 @@ void MEMORY_CONTROLLER::process(PACKET_QUEUE *queue)
 
                 // send data back to the core cache hierarchy
                 upper_level_dcache[op_cpu]->return_data(&queue->entry[request_index]);
+                record_latency(&queue->entry[request_index]);
 
                 if (bank_request[op_channel][op_rank][op_bank].row_buffer_hit)
                     queue->ROW_BUFFER_HIT++;
@@ -413,8 +568,8 @@ void MEMORY_CONTROLLER::process(PACKET_QUEUE *queue)
             }
 #endif
 
-            dbus_cycle_congested[op_channel] += (dbus_cycle_available[op_channel] - current_core_cycle[op_cpu]);
-            bank_request[op_channel][op_rank][op_bank].cycle_available = dbus_cycle_available[op_channel];
+            dbus_cycle_congested[op_channel] += (dbus_cycle - current_core_cycle[op_cpu]);
+            bank_request[op_channel][op_rank][op_bank].cycle_available = dbus_cycle;
             dbus_congested[op_channel][NUM_TYPES][NUM_TYPES]++;
             dbus_congested[op_channel][NUM_TYPES][op_type]++;
             dbus_congested[op_channel][bank_request[op_channel][op_rank][op_bank].working_type][NUM_TYPES]++;
@@ -430,6 +585,255 @@ void MEMORY_CONTROLLER::process(PACKET_QUEUE *queue)
     }
 }
 
+// an all-bank refresh waits for the rank's in-flight requests to finish, then blacks the rank out for tRFC
+void MEMORY_CONTROLLER::operate_refresh(uint32_t channel)
+{
+    uint64_t cycle = channel_cycle[channel];
+
+    for (uint32_t rank=0; rank<DRAM_RANKS; rank++) {
+        if (next_refresh[channel][rank] == 0)
+            next_refresh[channel][rank] = cycle + tREFI;
+
+        if (refresh_until[channel][rank] > cycle)
+            continue;
+
+        if (refresh_pending[channel][rank] == 0) {
+            if (cycle < next_refresh[channel][rank])
+                continue;
+            refresh_pending[channel][rank] = 1;
+        }
+
+        uint8_t busy = 0;
+        for (uint32_t bank=0; bank<DRAM_BANKS; bank++) {
+            if (bank_request[channel][rank][bank].working) {
+                busy = 1;
+                break;
+            }
+        }
+        if (busy)
+            continue;
+
+        // refresh precharges every bank
+        for (uint32_t bank=0; bank<DRAM_BANKS; bank++)
+            bank_request[channel][rank][bank].open_row = UINT32_MAX;
+
+        refresh_pending[channel][rank] = 0;
+        refresh_until[channel][rank] = cycle + tRFC;
+        next_refresh[channel][rank] += tREFI;
+        refreshes[channel]++;
+        refresh_cycles[channel] += tRFC;
+    }
+}
+
+// returns the cycles until the column command's data is ready, honoring tRRD_S/L and tFAW between activates
+// and tCCD_S/L between column commands of the same rank (sub-channel) and bank group
+uint64_t MEMORY_CONTROLLER::detailed_latency(uint32_t channel, uint32_t rank, uint32_t bank, uint8_t row_buffer_hit, uint64_t cycle)
+{
+    DRAM_TIMING_STATE *state = &timing[channel][rank][dram_get_sub_channel(bank)];
+    uint32_t group = dram_get_bank_group(bank);
+    uint64_t cas_cycle = cycle;
+
+    // reservations whose windows have all closed no longer matter, even if they were taken back
+    uint64_t act_span = max((uint64_t)tFAW, (uint64_t)max(tRRD_S, tRRD_L)), cas_span = max(tCCD_S, tCCD_L);
+    while (!state->reserved.empty()) {
+        DRAM_RESERVATION *oldest = &state->reserved.front();
+        if ((oldest->activate && (oldest->act_cycle + act_span > cycle)) || (oldest->column && (oldest->cas_cycle + cas_span > cycle)))
+            break;
+        state->reserved.pop_front();
+    }
+
+    DRAM_RESERVATION reservation;
+    reservation.bank = bank;
+    reservation.group = group;
+
+    if (row_buffer_hit == 0) {
+        // a closed bank needs no precharge
+        uint64_t act_cycle = cycle;
+        if (bank_request[channel][rank][bank].open_row != UINT32_MAX)
+            act_cycle += tRP;
+
+        uint64_t rrd_cycle = max(state->next_act, state->next_act_bg[group]);
+        if (rrd_cycle > act_cycle) {
+            act_cycle = rrd_cycle;
+            act_delayed_rrd[channel]++;
+        }
+        // the oldest of the last four activates
+        uint64_t faw_cycle = state->act_window[state->act_window_head] + tFAW;
+        if (faw_cycle > act_cycle) {
+            act_cycle = faw_cycle;
+            act_delayed_faw[channel]++;
+        }
+
+        reservation.activate = 1;
+        reservation.act_cycle = act_cycle;
+        cas_cycle = act_cycle + tRCD;
+    }
+
+    uint64_t ccd_cycle = max(state->next_cas, state->next_cas_bg[group]);
+    if (ccd_cycle > cas_cycle) {
+        cas_cycle = ccd_cycle;
+        cas_delayed_ccd[channel]++;
+    }
+    reservation.column = 1;
+    reservation.cas_cycle = cas_cycle;
+
+    apply_reservation(state, &reservation);
+    state->reserved.push_back(reservation);
+
+    return cas_cycle + tCAS - cycle;
+}
+
+// commands are reserved in issue order, so the latest reservation sets each window
+void MEMORY_CONTROLLER::apply_reservation(DRAM_TIMING_STATE *state, DRAM_RESERVATION *reservation)
+{
+    if (reservation->activate) {
+        state->next_act = reservation->act_cycle + tRRD_S;
+        state->next_act_bg[reservation->group] = reservation->act_cycle + tRRD_L;
+        state->act_window[state->act_window_head] = reservation->act_cycle;
+        state->act_window_head = (state->act_window_head + 1) % DRAM_ACT_WINDOW;
+    }
+    if (reservation->column) {
+        state->next_cas = reservation->cas_cycle + tCCD_S;
+        state->next_cas_bg[reservation->group] = reservation->cas_cycle + tCCD_L;
+    }
+}
+
+// the bank's request was un-scheduled at this cycle: the commands it had not issued yet never happen,
+// so drop them and rebuild the windows from the reservations that are left
+void MEMORY_CONTROLLER::cancel_reservation(uint32_t channel, uint32_t rank, uint32_t bank, uint64_t cycle)
+{
+    DRAM_TIMING_STATE *state = &timing[channel][rank][dram_get_sub_channel(bank)];
+
+    deque<DRAM_RESERVATION>::reverse_iterator it = state->reserved.rbegin();
+    while ((it != state->reserved.rend()) && (it->bank != bank))
+        it++;
+    if ((it == state->reserved.rend()) || (it->cas_cycle <= cycle))
+        return;
+
+    if (it->activate && (it->act_cycle <= cycle))
+        it->column = 0;
+    else
+        state->reserved.erase(next(it).base());
+
+    state->reset_windows();
+    for (uint32_t i=0; i<state->reserved.size(); i++)
+        apply_reservation(state, &state->reserved[i]);
+}
+
+// utilization decays every cycle with a time constant of 2^dram_telemetry_cycle_shift cycles;
+// a DDR5 channel counts each busy sub-channel bus as half busy
+void MEMORY_CONTROLLER::update_telemetry(uint32_t channel)
+{
+    DRAM_TELEMETRY *t = &telemetry[channel];
+    uint64_t cycle = current_core_cycle[0];
+
+    int64_t busy = 0;
+    if (DRAM_SUB_CHANNELS == 1)
+        busy = (dbus_cycle_available[channel] > cycle) ? (1 << DRAM_TELEMETRY_FRAC_BITS) : 0;
+    else {
+        for (uint32_t i=0; i<DRAM_SUB_CHANNELS; i++) {
+            if (sub_dbus_cycle_available[channel][i] > cycle)
+                busy += (1 << DRAM_TELEMETRY_FRAC_BITS) / DRAM_SUB_CHANNELS;
+        }
+    }
+
+    t->utilization += (busy - t->utilization) >> knob::dram_telemetry_cycle_shift;
+    t->cycles++;
+    if (busy)
+        t->busy_cycles++;
+}
+
+// queueing delay and row hits move by 2^-dram_telemetry_event_shift per scheduled request
+void MEMORY_CONTROLLER::record_schedule(uint32_t channel, PACKET *packet, uint8_t is_read, uint8_t row_buffer_hit)
+{
+    DRAM_TELEMETRY *t = &telemetry[channel];
+
+    int64_t hit = row_buffer_hit ? (1 << DRAM_TELEMETRY_FRAC_BITS) : 0;
+    t->row_hit_rate += (hit - t->row_hit_rate) >> knob::dram_telemetry_event_shift;
+
+    if (is_read) {
+        int64_t delay = (int64_t)(current_core_cycle[packet->cpu] - packet->cycle_enqueued) << DRAM_TELEMETRY_FRAC_BITS;
+        t->queueing_delay += (delay - t->queueing_delay) >> knob::dram_telemetry_event_shift;
+    }
+}
+
+// demands, and prefetches that have waited at least dram_prefetch_promote_age cycles
+uint8_t MEMORY_CONTROLLER::is_critical(PACKET *packet)
+{
+    if (packet->type != PREFETCH)
+        return 1;
+
+    return (current_core_cycle[packet->cpu] - packet->cycle_enqueued) >= knob::dram_prefetch_promote_age;
+}
+
+// drops the oldest unscheduled prefetch that has waited at least dram_prefetch_drop_age cycles.
+// The caches above release their MSHRs and the issuing prefetcher is told; if a demand has
+// merged into the prefetch somewhere above, it is kept and served as a demand instead.
+void MEMORY_CONTROLLER::drop_stale_prefetch(uint32_t channel)
+{
+    int oldest_index = -1;
+    uint64_t oldest_cycle = UINT64_MAX;
+
+    for (uint32_t i=0; i<RQ[channel].SIZE; i++) {
+        PACKET *packet = &RQ[channel].entry[i];
+        if ((packet->address == 0) || packet->scheduled || (packet->type != PREFETCH))
+            continue;
+        if ((current_core_cycle[packet->cpu] - packet->cycle_enqueued) < knob::dram_prefetch_drop_age)
+            continue;
+        if (packet->cycle_enqueued < oldest_cycle) {
+            oldest_cycle = packet->cycle_enqueued;
+            oldest_index = i;
+        }
+    }
+
+    if (oldest_index == -1)
+        return;
+
+    PACKET *packet = &RQ[channel].entry[oldest_index];
+    MEMORY *upper = packet->instruction ? upper_level_icache[packet->cpu] : upper_level_dcache[packet->cpu];
+    if (upper->drop_prefetch(packet)) {
+        pf_dropped++;
+        RQ[channel].remove_queue(packet);
+        update_schedule_cycle(&RQ[channel]);
+    }
+    else {
+        pf_drop_refused++;
+        packet->type = LOAD;
+    }
+}
+
+// a demand merged into an in-flight prefetch above, so schedule it as a demand from now on
+void MEMORY_CONTROLLER::promote_prefetch(uint64_t address)
+{
+    uint32_t channel = dram_get_channel(address);
+    for (uint32_t i=0; i<RQ[channel].SIZE; i++) {
+        if ((RQ[channel].entry[i].address == address) && (RQ[channel].entry[i].type == PREFETCH)) {
+            RQ[channel].entry[i].type = LOAD;
+            pf_promoted++;
+        }
+    }
+}
+
+// promoted prefetches are counted as demands, from the cycle the prefetch arrived
+void MEMORY_CONTROLLER::record_latency(PACKET *packet)
+{
+    uint64_t latency = packet->event_cycle - packet->cycle_enqueued;
+    uint32_t bucket = 0;
+    while ((bucket < DRAM_LATENCY_BUCKETS - 1) && (latency >> (bucket + 1)))
+        bucket++;
+
+    if (packet->type == PREFETCH) {
+        prefetch_latency_hist[bucket]++;
+        prefetch_latency_total += latency;
+        prefetch_returned++;
+    }
+    else {
+        demand_latency_hist[bucket]++;
+        demand_latency_total += latency;
+        demand_returned++;
+    }
+}
+
 int MEMORY_CONTROLLER::add_rq(PACKET *packet)
 {
     // simply return read requests with dummy response before the warmup
@@ -481,6 +885,7 @@ int MEMORY_CONTROLLER::add_rq(PACKET *packet)
         if (RQ[channel].entry[index].address == 0) {
             
             RQ[channel].entry[index] = *packet;
+            RQ[channel].entry[index].cycle_enqueued = current_core_cycle[packet->cpu];
             RQ[channel].occupancy++;
 
             /* keep a track of added entries */
@@ -650,19 +1055,28 @@ uint32_t MEMORY_CONTROLLER::dram_get_channel(uint64_t address)
     if (LOG2_DRAM_CHANNELS == 0)
         return 0;
 
-    int shift = 0;
+    int shift = DRAM_INTERLEAVE_SHIFT;
 
     return (uint32_t) (address >> shift) & (DRAM_CHANNELS - 1);
 }
 
+// the address with the channel bits taken out, so that the blocks of one interleave chunk stay in the same row
+uint64_t MEMORY_CONTROLLER::dram_strip_channel(uint64_t address)
+{
+    if (LOG2_DRAM_CHANNELS == 0)
+        return address;
+
+    uint64_t chunk_offset = address & ((1ull << DRAM_INTERLEAVE_SHIFT) - 1);
+
+    return ((address >> (DRAM_INTERLEAVE_SHIFT + LOG2_DRAM_CHANNELS)) << DRAM_INTERLEAVE_SHIFT) | chunk_offset;
+}
+
 uint32_t MEMORY_CONTROLLER::dram_get_bank(uint64_t address)
 {
     if (LOG2_DRAM_BANKS == 0)
         return 0;
 
-    int shift = LOG2_DRAM_CHANNELS;
-
-    return (uint32_t) (address >> shift) & (DRAM_BANKS - 1);
+    return (uint32_t) dram_strip_channel(address) & (DRAM_BANKS - 1);
 }
 
 uint32_t MEMORY_CONTROLLER::dram_get_column(uint64_t address)
@@ -670,9 +1084,9 @@ uint32_t MEMORY_CONTROLLER::dram_get_column(uint64_t address)
     if (LOG2_DRAM_COLUMNS == 0)
         return 0;
 
-    int shift = LOG2_DRAM_BANKS + LOG2_DRAM_CHANNELS;
+    int shift = LOG2_DRAM_BANKS;
 
-    return (uint32_t) (address >> shift) & (DRAM_COLUMNS - 1);
+    return (uint32_t) (dram_strip_channel(address) >> shift) & (DRAM_COLUMNS - 1);
 }
 
 uint32_t MEMORY_CONTROLLER::dram_get_rank(uint64_t address)
@@ -680,9 +1094,9 @@ uint32_t MEMORY_CONTROLLER::dram_get_rank(uint64_t address)
     if (LOG2_DRAM_RANKS == 0)
         return 0;
 
-    int shift = LOG2_DRAM_COLUMNS + LOG2_DRAM_BANKS + LOG2_DRAM_CHANNELS;
+    int shift = LOG2_DRAM_COLUMNS + LOG2_DRAM_BANKS;
 
-    return (uint32_t) (address >> shift) & (DRAM_RANKS - 1);
+    return (uint32_t) (dram_strip_channel(address) >> shift) & (DRAM_RANKS - 1);
 }
 
 uint32_t MEMORY_CONTROLLER::dram_get_row(uint64_t address)
@@ -690,9 +1104,29 @@ uint32_t MEMORY_CONTROLLER::dram_get_row(uint64_t address)
     if (LOG2_DRAM_ROWS == 0)
         return 0;
 
-    int shift = LOG2_DRAM_RANKS + LOG2_DRAM_COLUMNS + LOG2_DRAM_BANKS + LOG2_DRAM_CHANNELS;
+    int shift = LOG2_DRAM_RANKS + LOG2_DRAM_COLUMNS + LOG2_DRAM_BANKS;
 
-    return (uint32_t) (address >> shift) & (DRAM_ROWS - 1);
+    return (uint32_t) (dram_strip_channel(address) >> shift) & (DRAM_ROWS - 1);
+}
+
+// DDR5 sub-channels interleave on the lowest bank bit so that consecutive blocks alternate between them,
+// and bank groups interleave on the next bits
+uint32_t MEMORY_CONTROLLER::dram_get_sub_channel(uint32_t bank)
+{
+    return bank % DRAM_SUB_CHANNELS;
+}
+
+uint32_t MEMORY_CONTROLLER::dram_get_bank_group(uint32_t bank)
+{
+    return (bank / DRAM_SUB_CHANNELS) & (DRAM_BANK_GROUPS - 1);
+}
+
+uint64_t &MEMORY_CONTROLLER::dbus_available(uint32_t channel, uint32_t bank)
+{
+    if (DRAM_SUB_CHANNELS == 1)
+        return dbus_cycle_available[channel];
+
+    return sub_dbus_cycle_available[channel][dram_get_sub_channel(bank)];
 }
 
 uint32_t MEMORY_CONTROLLER::get_occupancy(uint8_t queue_type, uint64_t address)
@@ -722,3 +1156,135 @@ void MEMORY_CONTROLLER::increment_WQ_FULL(uint64_t address)
     uint32_t channel = dram_get_channel(address);
     WQ[channel].FULL++;
 }
+
+void NUMA_INTERCONNECT::initialize()
+{
+    num_nodes = knob::dram_controllers;
+    if ((num_nodes == 0) || (num_nodes > DRAM_MAX_CONTROLLERS)) {
+        cout << "dram_controllers must be between 1 and " << DRAM_MAX_CONTROLLERS << endl;
+        exit(1);
+    }
+
+    uint32_t granularity = knob::dram_interleave_granularity;
+    if ((granularity < BLOCK_SIZE) || (granularity > PAGE_SIZE) || (granularity & (granularity - 1))) {
+        cout << "dram_interleave_granularity must be a power of two between " << BLOCK_SIZE << " and " << PAGE_SIZE << endl;
+        exit(1);
+    }
+    DRAM_INTERLEAVE_SHIFT = lg2(granularity) - LOG2_BLOCK_SIZE;
+
+    if (knob::numa_placement.compare("none") && knob::numa_placement.compare("first_touch") && knob::numa_placement.compare("interleave")) {
+        cout << "unsupported NUMA placement " << knob::numa_placement << endl;
+        exit(1);
+    }
+
+    // in block address bits
+    DRAM_NODE_SHIFT = lg2(DRAM_PAGES) + LOG2_PAGE_SIZE - LOG2_BLOCK_SIZE;
+    NUMA_REMOTE_LATENCY = (uint32_t)((1.0 * knob::numa_remote_latency * CPU_FREQ) / 1000);
+
+    for (uint32_t i=1; i<num_nodes; i++)
+        node[i] = new MEMORY_CONTROLLER("DRAM" + to_string(i));
+
+    if (num_nodes > 1)
+        cout << "DRAM_NUMA: controllers " << num_nodes << " channels_per_controller " << DRAM_CHANNELS
+            << " placement " << knob::numa_placement << " remote_latency " << NUMA_REMOTE_LATENCY << " (CPU cycles)" << endl;
+}
+
+uint32_t NUMA_INTERCONNECT::get_node(uint64_t address)
+{
+    if (num_nodes == 1)
+        return 0;
+
+    return (address >> DRAM_NODE_SHIFT) % num_nodes;
+}
+
+// cores are split evenly over the sockets, in order
+uint32_t NUMA_INTERCONNECT::home_node(uint32_t cpu)
+{
+    return cpu * num_nodes / NUM_CPUS;
+}
+
+int NUMA_INTERCONNECT::add_rq(PACKET *packet)
+{
+    uint32_t n = get_node(packet->address);
+    if (n == home_node(packet->cpu))
+        local_reads[n]++;
+    else
+        remote_reads[n]++;
+
+    return node[n]->add_rq(packet);
+}
+
+int NUMA_INTERCONNECT::add_wq(PACKET *packet)
+{
+    uint32_t n = get_node(packet->address);
+    writes[n]++;
+
+    return node[n]->add_wq(packet);
+}
+
+int NUMA_INTERCONNECT::add_pq(PACKET *packet)
+{
+    return -1;
+}
+
+int NUMA_INTERCONNECT::drop_prefetch(PACKET *packet)
+{
+    MEMORY *upper = packet->instruction ? upper_level_icache[packet->cpu] : upper_level_dcache[packet->cpu];
+    return upper->drop_prefetch(packet);
+}
+
+void NUMA_INTERCONNECT::return_data(PACKET *packet)
+{
+    MEMORY *upper = packet->instruction ? upper_level_icache[packet->cpu] : upper_level_dcache[packet->cpu];
+    if (get_node(packet->address) == home_node(packet->cpu)) {
+        upper->return_data(packet);
+        return;
+    }
+
+    in_flight.push(make_pair(current_core_cycle[packet->cpu] + NUMA_REMOTE_LATENCY, *packet));
+}
+
+void NUMA_INTERCONNECT::operate()
+{
+    // every response takes the same time across, so they arrive in order
+    while (!in_flight.empty() && (in_flight.front().first <= current_core_cycle[in_flight.front().second.cpu])) {
+        PACKET *packet = &in_flight.front().second;
+        if (packet->instruction)
+            upper_level_icache[packet->cpu]->return_data(packet);
+        else
+            upper_level_dcache[packet->cpu]->return_data(packet);
+        in_flight.pop();
+    }
+
+    for (uint32_t i=0; i<num_nodes; i++)
+        node[i]->operate();
+}
+
+void NUMA_INTERCONNECT::increment_WQ_FULL(uint64_t address)
+{
+    node[get_node(address)]->increment_WQ_FULL(address);
+}
+
+void NUMA_INTERCONNECT::promote_prefetch(uint64_t address)
+{
+    node[get_node(address)]->promote_prefetch(address);
+}
+
+uint32_t NUMA_INTERCONNECT::get_occupancy(uint8_t queue_type, uint64_t address)
+{
+    return node[get_node(address)]->get_occupancy(queue_type, address);
+}
+
+uint32_t NUMA_INTERCONNECT::get_size(uint8_t queue_type, uint64_t address)
+{
+    return node[get_node(address)]->get_size(queue_type, address);
+}
+
+uint64_t NUMA_INTERCONNECT::rq_enqueue_count()
+{
+    uint64_t count = 0;
+    for (uint32_t i=0; i<num_nodes; i++)
+        count += node[i]->rq_enqueue_count;
+
+    return count;
+}
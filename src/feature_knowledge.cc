@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <assert.h>
+#include <math.h>
 #include "feature_knowledge.h"
 #include "feature_knowledge_helper.h"
 
@@ -75,6 +76,8 @@ FeatureKnowledge::FeatureKnowledge(FeatureType feature_type, float alpha, float
 	min_weight = 1000000;
 	max_weight = 0;
 
+	resolve_tile_kernel();
+
 	/* reward tracing */
 	if(knob::le_featurewise_enable_trace)
 	{
@@ -91,6 +94,46 @@ FeatureKnowledge::~FeatureKnowledge()
 
 }
 
+/* Federated averaging: replaces every Q-value of the given tables with
+ * their mean. Returns the mean absolute deviation from that mean before
+ * merging, which tells how far the private copies had drifted apart. */
+float FeatureKnowledge::average(std::vector<FeatureKnowledge*> &knowledges)
+{
+	assert(!knowledges.empty());
+	FeatureKnowledge *first = knowledges[0];
+	for(uint32_t index = 1; index < knowledges.size(); ++index)
+	{
+		assert(knowledges[index]->m_num_tilings == first->m_num_tilings
+			&& knowledges[index]->m_num_tiles == first->m_num_tiles
+			&& knowledges[index]->m_actions == first->m_actions);
+	}
+
+	double deviation = 0.0;
+	uint32_t count = knowledges.size();
+	for(uint32_t tiling = 0; tiling < first->m_num_tilings; ++tiling)
+	{
+		for(uint32_t tile = 0; tile < first->m_num_tiles; ++tile)
+		{
+			for(uint32_t action = 0; action < first->m_actions; ++action)
+			{
+				float sum = 0.0;
+				for(uint32_t index = 0; index < count; ++index)
+				{
+					sum += knowledges[index]->m_qtable[tiling][tile][action];
+				}
+				float mean = sum / count;
+				for(uint32_t index = 0; index < count; ++index)
+				{
+					deviation += fabs(knowledges[index]->m_qtable[tiling][tile][action] - mean);
+					knowledges[index]->m_qtable[tiling][tile][action] = mean;
+				}
+			}
+		}
+	}
+
+	return deviation / ((double)count * first->m_num_tilings * first->m_num_tiles * first->m_actions);
+}
+
 float FeatureKnowledge::getQ(uint32_t tiling, uint32_t tile_index, uint32_t action)
 {
 	assert(tiling < m_num_tilings);
@@ -109,13 +152,18 @@ void FeatureKnowledge::setQ(uint32_t tiling, uint32_t tile_index, uint32_t actio
 
 float FeatureKnowledge::retrieveQ(State *state, uint32_t action)
 {
-	uint32_t tile_index = 0;
+	uint32_t tile_index[FK_MAX_TILINGS];
+	get_tile_indices(state, tile_index);
+	return retrieveQ(tile_index, action);
+}
+
+float FeatureKnowledge::retrieveQ(uint32_t *tile_index, uint32_t action)
+{
 	float q_value = 0.0;
 
 	for(uint32_t tiling = 0; tiling < m_num_tilings; ++tiling)
 	{
-		tile_index = get_tile_index(tiling, state);
-		q_value += getQ(tiling, tile_index, action);
+		q_value += getQ(tiling, tile_index[tiling], action);
 	}
 
 	return m_weight * q_value;
@@ -123,26 +171,26 @@ float FeatureKnowledge::retrieveQ(State *state, uint32_t action)
 
 void FeatureKnowledge::updateQ(State *state1, uint32_t action1, int32_t reward, State *state2, uint32_t action2)
 {
-	uint32_t tile_index1 = 0, tile_index2 = 0;
+	uint32_t tile_index1[FK_MAX_TILINGS], tile_index2[FK_MAX_TILINGS];
 	float Qsa1, Qsa2, Qsa1_old;
 
-	float QSa1_old_overall = retrieveQ(state1, action1);
-	float QSa2_old_overall = retrieveQ(state2, action2);
+	get_tile_indices(state1, tile_index1);
+	get_tile_indices(state2, tile_index2);
+	float QSa1_old_overall = retrieveQ(tile_index1, action1);
+	float QSa2_old_overall = retrieveQ(tile_index2, action2);
 
 	for(uint32_t tiling = 0; tiling < m_num_tilings; ++tiling)
 	{
-		tile_index1 = get_tile_index(tiling, state1);
-		tile_index2 = get_tile_index(tiling, state2);
-		Qsa1 = getQ(tiling, tile_index1, action1);
-		Qsa2 = getQ(tiling, tile_index2, action2);
+		Qsa1 = getQ(tiling, tile_index1[tiling], action1);
+		Qsa2 = getQ(tiling, tile_index2[tiling], action2);
 		Qsa1_old = Qsa1;
 		/* SARSA */
 		Qsa1 = Qsa1 + m_alpha * ((float)reward + m_gamma * Qsa2 - Qsa1);
-		setQ(tiling, tile_index1, action1, Qsa1);
+		setQ(tiling, tile_index1[tiling], action1, Qsa1);
 		MYLOG("<tiling %u> Q(%s,%u) = %0.2f, R = %d, Q(%s,%u) = %0.2f, Q(%s,%u) = %0.2f", tiling, state1->to_string().c_str(), action1, Qsa1_old, reward, state2->to_string().c_str(), action2, Qsa2, state1->to_string().c_str(), action1, Qsa1);
 	}
 
-	float QSa1_new_overall = retrieveQ(state1, action1);
+	float QSa1_new_overall = retrieveQ(tile_index1, action1);
 	MYLOG("<feature %s> Q(%s,%u) = %0.2f, R = %d, Q(%s,%u) = %0.2f, Q(%s,%u) = %0.2f", getFeatureString(m_feature_type).c_str(), state1->to_string().c_str(), action1, QSa1_old_overall, reward, state2->to_string().c_str(), action2, QSa2_old_overall, state1->to_string().c_str(), action1, QSa1_new_overall);
 
 	/* tracing Q-values */
@@ -195,20 +243,71 @@ uint32_t FeatureKnowledge::get_tile_index(uint32_t tiling, State *state)
 	}
 }
 
+/* the generic path: a switch over the feature type per tiling, and
+ * HashZoo's switch over the hash type inside every process_* helper */
+void FeatureKnowledge::generic_tile_kernel(FeatureKnowledge *knowledge, State *state, uint32_t *tile_index)
+{
+	for(uint32_t tiling = 0; tiling < knowledge->m_num_tilings; ++tiling)
+	{
+		tile_index[tiling] = knowledge->get_tile_index(tiling, state);
+	}
+}
+
+template <FeatureType F, uint32_t H>
+void FeatureKnowledge::tile_kernel(FeatureKnowledge *knowledge, State *state, uint32_t *tile_index)
+{
+	uint32_t raw_index = feature_raw_index<F>(state);
+	for(uint32_t tiling = 0; tiling < knowledge->m_num_tilings; ++tiling)
+	{
+		uint32_t index = knowledge->m_enable_tiling_offset ? (raw_index ^ tiling_offset[tiling]) : raw_index;
+		tile_index[tiling] = feature_hash<H>(index) % knowledge->m_num_tiles;
+	}
+}
+
+/* Precompiled kernels for common configurations: the feature set and hash type of the MICRO'21
+ * config/pythia.ini. Adding a configuration takes a feature_raw_index and a feature_hash
+ * specialization in feature_knowledge_helper.h and an entry here. */
+void FeatureKnowledge::resolve_tile_kernel()
+{
+	static const struct
+	{
+		FeatureType feature_type;
+		uint32_t hash_type;
+		TileKernel kernel;
+	} kernel_table[] = {
+		{F_PC,			2,	&FeatureKnowledge::tile_kernel<F_PC, 2>},
+		{F_PC_Delta,	2,	&FeatureKnowledge::tile_kernel<F_PC_Delta, 2>},
+	};
+
+	m_tile_kernel = &FeatureKnowledge::generic_tile_kernel;
+	m_specialized_kernel = false;
+	for(uint32_t index = 0; index < sizeof(kernel_table)/sizeof(kernel_table[0]); ++index)
+	{
+		if(kernel_table[index].feature_type == m_feature_type && kernel_table[index].hash_type == m_hash_type)
+		{
+			m_tile_kernel = kernel_table[index].kernel;
+			m_specialized_kernel = true;
+			break;
+		}
+	}
+}
+
 uint32_t FeatureKnowledge::getMaxAction(State *state)
 {
 	float max_q_value = 0.0, q_value = 0.0;
 	uint32_t selected_action = 0, init_index = 0;
+	uint32_t tile_index[FK_MAX_TILINGS];
 
+	get_tile_indices(state, tile_index);
 	if(!knob::le_featurewise_enable_action_fallback)
 	{
-		max_q_value = retrieveQ(state, 0);
+		max_q_value = retrieveQ(tile_index, 0);
 		init_index = 1;
 	}
 
 	for(uint32_t action = init_index; action < m_actions; ++action)
 	{
-		q_value = retrieveQ(state, action);
+		q_value = retrieveQ(tile_index, action);
 		if(q_value > max_q_value)
 		{
 			max_q_value = q_value;
@@ -0,0 +1,178 @@
+#include <math.h>
+#include "interconnect.h"
+#include "cache.h"
+
+namespace knob
+{
+    extern uint32_t llc_slices;
+    extern string   llc_slice_hash;
+    extern string   llc_topology;
+    extern uint32_t llc_hop_latency;
+    extern uint32_t llc_link_bandwidth;
+}
+
+LLC_INTERCONNECT::LLC_INTERCONNECT()
+{
+    num_slices = 1;
+    num_stops = 1;
+    mesh_width = 1;
+    xor_hash = 0;
+    mesh = 0;
+
+    reset_stats();
+}
+
+// called at the end of warmup; link reservations are timing state and are kept
+void LLC_INTERCONNECT::reset_stats()
+{
+    messages = 0;
+    hops = 0;
+    transit_cycles = 0;
+    link_wait_cycles = 0;
+    slice_requests.assign(num_slices, 0);
+    slice_misses.assign(num_slices, 0);
+}
+
+void LLC_INTERCONNECT::initialize()
+{
+    // every slice needs at least one entry of each LLC queue
+    num_slices = knob::llc_slices;
+    if ((num_slices == 0) || (num_slices > LLC_RQ_SIZE) || (num_slices > LLC_WQ_SIZE) || (num_slices > LLC_PQ_SIZE) || (num_slices > LLC_MSHR_SIZE)) {
+        cout << "llc_slices must be between 1 and the smallest LLC queue (" << LLC_PQ_SIZE << ")" << endl;
+        exit(1);
+    }
+    if (knob::llc_slice_hash.compare("modulo") && knob::llc_slice_hash.compare("xor")) {
+        cout << "unsupported LLC slice hash " << knob::llc_slice_hash << endl;
+        exit(1);
+    }
+    if (knob::llc_topology.compare("ring") && knob::llc_topology.compare("mesh")) {
+        cout << "unsupported LLC topology " << knob::llc_topology << endl;
+        exit(1);
+    }
+    if (knob::llc_link_bandwidth == 0) {
+        cout << "llc_link_bandwidth must be at least 1" << endl;
+        exit(1);
+    }
+
+    xor_hash = !knob::llc_slice_hash.compare("xor");
+    mesh = !knob::llc_topology.compare("mesh");
+
+    // a stop per core or per slice, whichever there are more of; the mesh fills rows of mesh_width
+    num_stops = (NUM_CPUS > num_slices) ? NUM_CPUS : num_slices;
+    mesh_width = mesh ? (uint32_t)ceil(sqrt((double)num_stops)) : num_stops;
+    uint32_t grid_stops = mesh ? mesh_width * ((num_stops + mesh_width - 1) / mesh_width) : num_stops;
+
+    // two directed links out of each ring stop, four out of each mesh stop
+    link_cycle.assign(grid_stops * (mesh ? 4 : 2), 0);
+    link_used.assign(grid_stops * (mesh ? 4 : 2), 0);
+    reset_stats();
+
+    cout << "LLC_SLICES: " << num_slices << " slices on a " << knob::llc_topology << " of " << num_stops << " stops"
+        << " hash " << knob::llc_slice_hash << " hop_latency " << knob::llc_hop_latency
+        << " link_bandwidth " << knob::llc_link_bandwidth << endl;
+}
+
+uint32_t LLC_INTERCONNECT::get_slice(uint64_t address)
+{
+    // xor folds the higher block address bits in, so that strides do not camp on one slice
+    if (xor_hash)
+        address ^= (address >> 11) ^ (address >> 22) ^ (address >> 33);
+
+    return address % num_slices;
+}
+
+// cores and slices are each spread evenly over the stops, in order
+uint32_t LLC_INTERCONNECT::core_stop(uint32_t cpu)
+{
+    return cpu * num_stops / NUM_CPUS;
+}
+
+uint32_t LLC_INTERCONNECT::slice_stop(uint32_t slice)
+{
+    return slice * num_stops / num_slices;
+}
+
+// the link a message at stop from takes towards stop to, and the stop it leads to. The ring goes
+// the shorter way round, the mesh routes along the row first and then along the column
+uint32_t LLC_INTERCONNECT::next_link(uint32_t from, uint32_t to, uint32_t &next)
+{
+    if (!mesh) {
+        uint32_t clockwise = (to + num_stops - from) % num_stops;
+        if (clockwise <= num_stops - clockwise) {
+            next = (from + 1) % num_stops;
+            return 2 * from;
+        }
+        next = (from + num_stops - 1) % num_stops;
+        return 2 * from + 1;
+    }
+
+    uint32_t x = from % mesh_width, y = from / mesh_width,
+             to_x = to % mesh_width, to_y = to / mesh_width;
+    if (to_x > x) {
+        next = from + 1;
+        return 4 * from;
+    }
+    if (to_x < x) {
+        next = from - 1;
+        return 4 * from + 1;
+    }
+    if (to_y > y) {
+        next = from + mesh_width;
+        return 4 * from + 2;
+    }
+    next = from - mesh_width;
+    return 4 * from + 3;
+}
+
+// cycle a message leaving stop from at this cycle reaches stop to
+uint64_t LLC_INTERCONNECT::traverse(uint32_t from, uint32_t to, uint64_t cycle)
+{
+    uint64_t arrival = cycle;
+    while (from != to) {
+        uint32_t next, link = next_link(from, to, next);
+        if (link_cycle[link] < arrival) {
+            link_cycle[link] = arrival;
+            link_used[link] = 0;
+        }
+        if (link_used[link] == knob::llc_link_bandwidth) {
+            link_cycle[link]++;
+            link_used[link] = 0;
+        }
+        link_used[link]++;
+
+        link_wait_cycles += link_cycle[link] - arrival;
+        arrival = link_cycle[link] + knob::llc_hop_latency;
+        from = next;
+        hops++;
+    }
+
+    messages++;
+    transit_cycles += arrival - cycle;
+
+    return arrival;
+}
+
+uint64_t LLC_INTERCONNECT::to_slice(uint32_t cpu, uint64_t address, uint64_t cycle)
+{
+    uint32_t slice = get_slice(address);
+    slice_requests[slice]++;
+
+    return traverse(core_stop(cpu), slice_stop(slice), cycle);
+}
+
+uint64_t LLC_INTERCONNECT::to_core(uint64_t address, uint32_t cpu, uint64_t cycle)
+{
+    return traverse(slice_stop(get_slice(address)), core_stop(cpu), cycle);
+}
+
+void LLC_INTERCONNECT::final_stats()
+{
+    cout << "LLC_INTERCONNECT_messages " << messages << endl
+        << "LLC_INTERCONNECT_avg_hops " << (messages ? (float)hops / messages : 0) << endl
+        << "LLC_INTERCONNECT_avg_transit_cycles " << (messages ? (float)transit_cycles / messages : 0) << endl
+        << "LLC_INTERCONNECT_link_wait_cycles " << link_wait_cycles << endl;
+    for (uint32_t i=0; i<num_slices; i++)
+        cout << "LLC_slice_" << i << "_requests " << slice_requests[i] << endl
+            << "LLC_slice_" << i << "_misses " << slice_misses[i] << endl;
+    cout << endl;
+}
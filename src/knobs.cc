@@ -2,6 +2,7 @@
 #include <string>
 #include <string.h>
 #include <math.h>
+#include <map>
 #include "knobs.h"
 #include "ini.h"
 using namespace std;
@@ -14,8 +15,35 @@ namespace knob
 	uint64_t simulation_instructions = 1000000;
 	bool  	 knob_cloudsuite = false;
 	bool     knob_low_bandwidth = false;
+	bool     legacy_rob_scan_scheduling = false;
+	bool     wrong_path_enable = false;
+	uint32_t wrong_path_budget = 16;
+	uint32_t wrong_path_width = 2;
+	uint32_t wrong_path_history_size = 64;
+	uint32_t ftq_size = 0;
+
+	/* hashed perceptron branch predictor */
+	uint32_t hashed_perceptron_num_tables = 16;
+	uint32_t hashed_perceptron_log_table_size = 12;
+	uint32_t hashed_perceptron_min_history = 3;
+	uint32_t hashed_perceptron_max_history = 232;
+	vector<int32_t> hashed_perceptron_history_lengths;
+
+	/* TAGE-SC-L branch predictor */
+	uint32_t tage_sc_l_budget_kb = 64;
+	uint32_t tage_sc_l_num_tables = 12;
+	uint32_t tage_sc_l_min_history = 4;
+	uint32_t tage_sc_l_max_history = 640;
+
 	vector<string> 	 l2c_prefetcher_types;
 	vector<string> 	 l1d_prefetcher_types;
+	vector<string> 	 l1i_prefetcher_types;
+	vector<string> 	 llc_prefetcher_types;
+	vector<string> 	 stlb_prefetcher_types;
+	string   llc_replacement_type = std::string("ship");
+	bool     pf_conf_insertion = false;
+	string   llc_inclusion = std::string("non_inclusive");
+	map<string, vector<pair<string, string> > > cache_level_knobs;
 	bool     l1d_perfect = false;
 	bool     l2c_perfect = false;
 	bool     llc_perfect = false;
@@ -26,6 +54,45 @@ namespace knob
 	bool     measure_ipc = false;
 	uint64_t measure_ipc_epoch = 1000;
 	uint32_t dram_io_freq = 2400;
+	bool     dram_detailed_timing = false;
+	string   dram_standard = std::string("ddr4");
+	uint32_t dram_bank_groups = 2;
+	float    dram_tRRD_S = 0; /* timings in ns, 0 takes the standard's default */
+	float    dram_tRRD_L = 0;
+	float    dram_tFAW = 0;
+	float    dram_tCCD_S = 0;
+	float    dram_tCCD_L = 0;
+	float    dram_tREFI = 0;
+	float    dram_tRFC = 0;
+	bool     dram_demand_first = false;
+	uint64_t dram_prefetch_promote_age = 2000;
+	bool     dram_prefetch_drop = false;
+	uint32_t dram_prefetch_drop_watermark = 48;
+	uint64_t dram_prefetch_drop_age = 500;
+	uint32_t dram_telemetry_cycle_shift = 8;
+	uint32_t dram_telemetry_event_shift = 4;
+	uint32_t dram_controllers = 1; /* one per NUMA node, each with DRAM_CHANNELS channels */
+	uint32_t dram_interleave_granularity = 64; /* bytes */
+	string   numa_placement = std::string("first_touch");
+	float    numa_remote_latency = 50; /* ns */
+	bool     ptw_enable = false;
+	uint32_t ptw_walkers = 2;
+	uint32_t ptw_pml4_cache_size = 2;
+	uint32_t ptw_pdp_cache_size = 4;
+	uint32_t ptw_pde_cache_size = 32;
+	float    huge_page_fraction = 0.0;
+	uint32_t stlb_huge_entries = 32;
+	bool     llc_compression = false;
+	uint32_t llc_compression_tag_factor = 2; /* tags per uncompressed line of capacity */
+	bool     dram_compression = false;
+	vector<float> compression_size_dist;
+	bool     coherence_directory = false;
+	bool     shared_address_space = false; /* cores share one virtual address space */
+	uint32_t llc_slices = 1;
+	string   llc_slice_hash = std::string("xor"); /* modulo, xor */
+	string   llc_topology = std::string("ring"); /* ring, mesh */
+	uint32_t llc_hop_latency = 2; /* CPU cycles */
+	uint32_t llc_link_bandwidth = 1; /* messages per link per cycle */
 	bool     measure_dram_bw = true;
 	uint64_t measure_dram_bw_epoch = 256;
 	bool     measure_cache_acc = true;
@@ -42,6 +109,9 @@ namespace knob
 	string   next_line_trace_name = string("next_line_trace.csv");
 	uint32_t next_line_pref_degree = 1;
 
+	/* FDIP */
+	uint32_t fdip_filter_size = 32;
+
 	/* SMS */
 	uint32_t sms_at_size = 32;
 	uint32_t sms_ft_size = 64;
@@ -147,6 +217,10 @@ namespace knob
 	uint32_t stride_num_trackers = 64;
    	uint32_t stride_pref_degree = 2;
 
+	/* STLB distance prefetcher */
+	uint32_t tlb_distance_table_size = 64;
+	uint32_t tlb_distance_slots = 2;
+
 	/* Streamer */
 	uint32_t streamer_num_trackers = 64;
 	uint32_t streamer_pref_degree = 5; /* models IBM POWER7 */
@@ -205,6 +279,7 @@ namespace knob
 	bool     scooby_enable_state_action_stats = false;
 	bool     scooby_enable_reward_tracker_hit = false;
 	int32_t  scooby_reward_tracker_hit = -2;
+	int32_t  scooby_reward_dropped = -4;
 	bool     scooby_enable_shaggy = false;
 	uint32_t scooby_state_hash_type = 11;
 	bool     scooby_prefetch_with_shaggy = false;
@@ -212,6 +287,7 @@ namespace knob
 	uint32_t scooby_pref_degree = 1; /* default is set to 1 */
 	bool     scooby_enable_dyn_degree = true;
 	vector<float> scooby_max_to_avg_q_thresholds; /* depricated */
+	vector<float> scooby_pf_conf_q_ratio_thresholds;
 	vector<int32_t> scooby_dyn_degrees;
 	uint64_t scooby_early_exploration_window = 0;
 	uint32_t scooby_multi_deg_select_type = 2; /* type 1 is already depricated */
@@ -226,8 +302,23 @@ namespace knob
 	int32_t  scooby_reward_hbw_none = -2;
 	int32_t  scooby_reward_hbw_out_of_bounds = -12;
 	int32_t  scooby_reward_hbw_tracker_hit = -2;
+	int32_t  scooby_reward_hbw_dropped = -8;
 	vector<int32_t> scooby_last_pref_offset_conf_thresholds_hbw;
 	vector<int32_t> scooby_dyn_degrees_type2_hbw;
+	bool     scooby_enable_va = false;
+	bool     scooby_enable_cross_page = false;
+	bool     scooby_enable_throttle = false;
+	bool     scooby_enable_dram_telemetry = false;
+	bool     scooby_enable_huge_page = false;
+	bool     scooby_enable_translation_prefetch = false;
+	uint32_t scooby_throttle_pc_table_size = 256;
+	uint32_t scooby_throttle_region_table_size = 256;
+	uint32_t scooby_throttle_log2_region_pages = 2;
+	uint32_t scooby_throttle_epoch = 32;
+	float    scooby_throttle_suppress_acc = 0.2;
+	float    scooby_throttle_suppress_acc_hbw = 0.4;
+	float    scooby_throttle_boost_acc = 0.8;
+	float    scooby_throttle_boost_late = 0.5;
 
 	/* Learning Engine */
 	bool     le_enable_trace;
@@ -259,6 +350,8 @@ namespace knob
 	bool le_featurewise_enable_dyn_action_fallback = true;
 	uint32_t le_featurewise_bw_acc_check_level = 1;
 	uint32_t le_featurewise_acc_thresh = 2;
+	uint32_t le_featurewise_knowledge_sharing = 0; /* private per core */
+	uint64_t le_featurewise_knowledge_merge_epoch = 100000;
 
 	bool 			le_featurewise_enable_trace = false;
 	uint32_t		le_featurewise_trace_feature_type;
@@ -298,6 +391,12 @@ int handler(void* user, const char* section, const char* name, const char* value
 		strcpy(config_file_name, value);
 		parse_config(config_file_name);
 	}
+	else if(!strcmp(section, "") && strchr(name, '.'))
+	{
+		/* commandline form of per-level knobs, e.g. --llc.scooby_pref_degree=2 */
+		string level(name, strchr(name, '.') - name);
+		parse_knobs(user, level.c_str(), strchr(name, '.') + 1, value);
+	}
 	else
 	{
 		parse_knobs(user, section, name, value);
@@ -324,6 +423,11 @@ int parse_knobs(void* user, const char* section, const char* name, const char* v
 		strcpy(config_file_name, value);
 		parse_config(config_file_name);
 	}
+	else if(!strcmp(section, "l1d") || !strcmp(section, "l2c") || !strcmp(section, "llc"))
+	{
+		/* per-level overrides are applied by the prefetcher instantiated at that level */
+		knob::cache_level_knobs[string(section)].push_back(make_pair(string(name), string(value)));
+	}
     else if (MATCH("", "warmup_instructions"))
     {
 		knob::warmup_instructions = atol(value);
@@ -340,14 +444,102 @@ int parse_knobs(void* user, const char* section, const char* name, const char* v
     {
 		knob::knob_low_bandwidth = atoi(value);
     }
+    else if (MATCH("", "legacy_rob_scan_scheduling"))
+    {
+		knob::legacy_rob_scan_scheduling = !strcmp(value, "true") ? true : false;
+    }
+    else if (MATCH("", "wrong_path_enable"))
+    {
+		knob::wrong_path_enable = !strcmp(value, "true") ? true : false;
+    }
+    else if (MATCH("", "wrong_path_budget"))
+    {
+		knob::wrong_path_budget = atoi(value);
+    }
+    else if (MATCH("", "wrong_path_width"))
+    {
+		knob::wrong_path_width = atoi(value);
+    }
+    else if (MATCH("", "wrong_path_history_size"))
+    {
+		knob::wrong_path_history_size = atoi(value);
+    }
+    else if (MATCH("", "ftq_size"))
+    {
+		knob::ftq_size = atoi(value);
+    }
+
+    /* hashed perceptron branch predictor */
+    else if (MATCH("", "hashed_perceptron_num_tables"))
+    {
+		knob::hashed_perceptron_num_tables = atoi(value);
+    }
+    else if (MATCH("", "hashed_perceptron_log_table_size"))
+    {
+		knob::hashed_perceptron_log_table_size = atoi(value);
+    }
+    else if (MATCH("", "hashed_perceptron_min_history"))
+    {
+		knob::hashed_perceptron_min_history = atoi(value);
+    }
+    else if (MATCH("", "hashed_perceptron_max_history"))
+    {
+		knob::hashed_perceptron_max_history = atoi(value);
+    }
+    else if (MATCH("", "hashed_perceptron_history_lengths"))
+    {
+		knob::hashed_perceptron_history_lengths = get_array_int(value);
+    }
+
+    /* TAGE-SC-L branch predictor */
+    else if (MATCH("", "tage_sc_l_budget_kb"))
+    {
+		knob::tage_sc_l_budget_kb = atoi(value);
+    }
+    else if (MATCH("", "tage_sc_l_num_tables"))
+    {
+		knob::tage_sc_l_num_tables = atoi(value);
+    }
+    else if (MATCH("", "tage_sc_l_min_history"))
+    {
+		knob::tage_sc_l_min_history = atoi(value);
+    }
+    else if (MATCH("", "tage_sc_l_max_history"))
+    {
+		knob::tage_sc_l_max_history = atoi(value);
+    }
     else if (MATCH("", "l2c_prefetcher_types"))
     {
 		knob::l2c_prefetcher_types.push_back(string(value));
     }
+    else if (MATCH("", "llc_prefetcher_types"))
+    {
+		knob::llc_prefetcher_types.push_back(string(value));
+    }
+    else if (MATCH("", "llc_replacement_type"))
+    {
+		knob::llc_replacement_type = string(value);
+    }
+    else if (MATCH("", "llc_inclusion"))
+    {
+		knob::llc_inclusion = string(value);
+    }
+    else if (MATCH("", "pf_conf_insertion"))
+    {
+		knob::pf_conf_insertion = !strcmp(value, "true") ? true : false;
+    }
     else if (MATCH("", "l1d_prefetcher_types"))
     {
 		knob::l1d_prefetcher_types.push_back(string(value));
     }
+    else if (MATCH("", "l1i_prefetcher_types"))
+    {
+		knob::l1i_prefetcher_types.push_back(string(value));
+    }
+    else if (MATCH("", "stlb_prefetcher_types"))
+    {
+		knob::stlb_prefetcher_types.push_back(string(value));
+    }
     else if (MATCH("", "l1d_perfect"))
     {
 		knob::l1d_perfect = !strcmp(value, "true") ? true : false;
@@ -388,6 +580,162 @@ int parse_knobs(void* user, const char* section, const char* name, const char* v
     {
 		knob::dram_io_freq = atoi(value);
     }
+    else if (MATCH("", "dram_detailed_timing"))
+    {
+		knob::dram_detailed_timing = !strcmp(value, "true") ? true : false;
+    }
+    else if (MATCH("", "dram_standard"))
+    {
+		knob::dram_standard = string(value);
+    }
+    else if (MATCH("", "dram_bank_groups"))
+    {
+		knob::dram_bank_groups = atoi(value);
+    }
+    else if (MATCH("", "dram_tRRD_S"))
+    {
+		knob::dram_tRRD_S = atof(value);
+    }
+    else if (MATCH("", "dram_tRRD_L"))
+    {
+		knob::dram_tRRD_L = atof(value);
+    }
+    else if (MATCH("", "dram_tFAW"))
+    {
+		knob::dram_tFAW = atof(value);
+    }
+    else if (MATCH("", "dram_tCCD_S"))
+    {
+		knob::dram_tCCD_S = atof(value);
+    }
+    else if (MATCH("", "dram_tCCD_L"))
+    {
+		knob::dram_tCCD_L = atof(value);
+    }
+    else if (MATCH("", "dram_tREFI"))
+    {
+		knob::dram_tREFI = atof(value);
+    }
+    else if (MATCH("", "dram_tRFC"))
+    {
+		knob::dram_tRFC = atof(value);
+    }
+    else if (MATCH("", "dram_demand_first"))
+    {
+		knob::dram_demand_first = !strcmp(value, "true") ? true : false;
+    }
+    else if (MATCH("", "dram_prefetch_promote_age"))
+    {
+		knob::dram_prefetch_promote_age = atoi(value);
+    }
+    else if (MATCH("", "dram_prefetch_drop"))
+    {
+		knob::dram_prefetch_drop = !strcmp(value, "true") ? true : false;
+    }
+    else if (MATCH("", "dram_prefetch_drop_watermark"))
+    {
+		knob::dram_prefetch_drop_watermark = atoi(value);
+    }
+    else if (MATCH("", "dram_prefetch_drop_age"))
+    {
+		knob::dram_prefetch_drop_age = atoi(value);
+    }
+    else if (MATCH("", "dram_telemetry_cycle_shift"))
+    {
+		knob::dram_telemetry_cycle_shift = atoi(value);
+    }
+    else if (MATCH("", "dram_telemetry_event_shift"))
+    {
+		knob::dram_telemetry_event_shift = atoi(value);
+    }
+    else if (MATCH("", "dram_controllers"))
+    {
+		knob::dram_controllers = atoi(value);
+    }
+    else if (MATCH("", "dram_interleave_granularity"))
+    {
+		knob::dram_interleave_granularity = atoi(value);
+    }
+    else if (MATCH("", "numa_placement"))
+    {
+		knob::numa_placement = string(value);
+    }
+    else if (MATCH("", "numa_remote_latency"))
+    {
+		knob::numa_remote_latency = atof(value);
+    }
+    else if (MATCH("", "ptw_enable"))
+    {
+		knob::ptw_enable = !strcmp(value, "true") ? true : false;
+    }
+    else if (MATCH("", "ptw_walkers"))
+    {
+		knob::ptw_walkers = atoi(value);
+    }
+    else if (MATCH("", "ptw_pml4_cache_size"))
+    {
+		knob::ptw_pml4_cache_size = atoi(value);
+    }
+    else if (MATCH("", "ptw_pdp_cache_size"))
+    {
+		knob::ptw_pdp_cache_size = atoi(value);
+    }
+    else if (MATCH("", "ptw_pde_cache_size"))
+    {
+		knob::ptw_pde_cache_size = atoi(value);
+    }
+    else if (MATCH("", "huge_page_fraction"))
+    {
+		knob::huge_page_fraction = atof(value);
+    }
+    else if (MATCH("", "stlb_huge_entries"))
+    {
+		knob::stlb_huge_entries = atoi(value);
+    }
+    else if (MATCH("", "llc_compression"))
+    {
+		knob::llc_compression = !strcmp(value, "true") ? true : false;
+    }
+    else if (MATCH("", "llc_compression_tag_factor"))
+    {
+		knob::llc_compression_tag_factor = atoi(value);
+    }
+    else if (MATCH("", "dram_compression"))
+    {
+		knob::dram_compression = !strcmp(value, "true") ? true : false;
+    }
+    else if (MATCH("", "compression_size_dist"))
+    {
+		knob::compression_size_dist = get_array_float(value);
+    }
+    else if (MATCH("", "coherence_directory"))
+    {
+		knob::coherence_directory = !strcmp(value, "true") ? true : false;
+    }
+    else if (MATCH("", "shared_address_space"))
+    {
+		knob::shared_address_space = !strcmp(value, "true") ? true : false;
+    }
+    else if (MATCH("", "llc_slices"))
+    {
+		knob::llc_slices = atoi(value);
+    }
+    else if (MATCH("", "llc_slice_hash"))
+    {
+		knob::llc_slice_hash = string(value);
+    }
+    else if (MATCH("", "llc_topology"))
+    {
+		knob::llc_topology = string(value);
+    }
+    else if (MATCH("", "llc_hop_latency"))
+    {
+		knob::llc_hop_latency = atoi(value);
+    }
+    else if (MATCH("", "llc_link_bandwidth"))
+    {
+		knob::llc_link_bandwidth = atoi(value);
+    }
     else if (MATCH("", "measure_dram_bw"))
     {
 		knob::measure_dram_bw = !strcmp(value, "true") ? true : false;
@@ -443,6 +791,12 @@ int parse_knobs(void* user, const char* section, const char* name, const char* v
 		knob::next_line_pref_degree = atoi(value);
     }
 
+    /* FDIP */
+    else if (MATCH("", "fdip_filter_size"))
+    {
+		knob::fdip_filter_size = atoi(value);
+    }
+
     /* SMS */
 	else if(MATCH("", "sms_at_size"))
 	{
@@ -796,6 +1150,14 @@ int parse_knobs(void* user, const char* section, const char* name, const char* v
 	{
 		knob::stride_pref_degree = atoi(value);
 	}
+	else if (MATCH("", "tlb_distance_table_size"))
+	{
+		knob::tlb_distance_table_size = atoi(value);
+	}
+	else if (MATCH("", "tlb_distance_slots"))
+	{
+		knob::tlb_distance_slots = atoi(value);
+	}
 
 	else if (MATCH("", "streamer_num_trackers"))
 	{
@@ -995,6 +1357,10 @@ int parse_knobs(void* user, const char* section, const char* name, const char* v
 	{
 		knob::scooby_reward_tracker_hit = atoi(value);
 	}
+	else if (MATCH("", "scooby_reward_dropped"))
+	{
+		knob::scooby_reward_dropped = atoi(value);
+	}
 	else if (MATCH("", "scooby_enable_shaggy"))
 	{
 		knob::scooby_enable_shaggy = !strcmp(value, "true") ? true : false;
@@ -1023,6 +1389,10 @@ int parse_knobs(void* user, const char* section, const char* name, const char* v
 	{
 		knob::scooby_max_to_avg_q_thresholds = get_array_float(value);
 	}
+	else if (MATCH("", "scooby_pf_conf_q_ratio_thresholds"))
+	{
+		knob::scooby_pf_conf_q_ratio_thresholds = get_array_float(value);
+	}
 	else if (MATCH("", "scooby_early_exploration_window"))
 	{
 		knob::scooby_early_exploration_window = atoi(value);
@@ -1079,6 +1449,10 @@ int parse_knobs(void* user, const char* section, const char* name, const char* v
 	{
 		knob::scooby_reward_hbw_tracker_hit = atoi(value);
 	}
+	else if (MATCH("", "scooby_reward_hbw_dropped"))
+	{
+		knob::scooby_reward_hbw_dropped = atoi(value);
+	}
 	else if (MATCH("", "scooby_last_pref_offset_conf_thresholds_hbw"))
 	{
 		knob::scooby_last_pref_offset_conf_thresholds_hbw = get_array_int(value);
@@ -1087,6 +1461,62 @@ int parse_knobs(void* user, const char* section, const char* name, const char* v
 	{
 		knob::scooby_dyn_degrees_type2_hbw = get_array_int(value);
 	}
+	else if (MATCH("", "scooby_enable_va"))
+	{
+		knob::scooby_enable_va = !strcmp(value, "true") ? true : false;
+	}
+	else if (MATCH("", "scooby_enable_cross_page"))
+	{
+		knob::scooby_enable_cross_page = !strcmp(value, "true") ? true : false;
+	}
+	else if (MATCH("", "scooby_enable_throttle"))
+	{
+		knob::scooby_enable_throttle = !strcmp(value, "true") ? true : false;
+	}
+	else if (MATCH("", "scooby_enable_dram_telemetry"))
+	{
+		knob::scooby_enable_dram_telemetry = !strcmp(value, "true") ? true : false;
+	}
+	else if (MATCH("", "scooby_enable_huge_page"))
+	{
+		knob::scooby_enable_huge_page = !strcmp(value, "true") ? true : false;
+	}
+	else if (MATCH("", "scooby_enable_translation_prefetch"))
+	{
+		knob::scooby_enable_translation_prefetch = !strcmp(value, "true") ? true : false;
+	}
+	else if (MATCH("", "scooby_throttle_pc_table_size"))
+	{
+		knob::scooby_throttle_pc_table_size = atoi(value);
+	}
+	else if (MATCH("", "scooby_throttle_region_table_size"))
+	{
+		knob::scooby_throttle_region_table_size = atoi(value);
+	}
+	else if (MATCH("", "scooby_throttle_log2_region_pages"))
+	{
+		knob::scooby_throttle_log2_region_pages = atoi(value);
+	}
+	else if (MATCH("", "scooby_throttle_epoch"))
+	{
+		knob::scooby_throttle_epoch = atoi(value);
+	}
+	else if (MATCH("", "scooby_throttle_suppress_acc"))
+	{
+		knob::scooby_throttle_suppress_acc = atof(value);
+	}
+	else if (MATCH("", "scooby_throttle_suppress_acc_hbw"))
+	{
+		knob::scooby_throttle_suppress_acc_hbw = atof(value);
+	}
+	else if (MATCH("", "scooby_throttle_boost_acc"))
+	{
+		knob::scooby_throttle_boost_acc = atof(value);
+	}
+	else if (MATCH("", "scooby_throttle_boost_late"))
+	{
+		knob::scooby_throttle_boost_late = atof(value);
+	}
 
 	/* Learning Engine */
 	else if (MATCH("", "le_enable_trace"))
@@ -1199,6 +1629,14 @@ int parse_knobs(void* user, const char* section, const char* name, const char* v
 	{
 		knob::le_featurewise_acc_thresh = atoi(value);
 	}
+	else if (MATCH("", "le_featurewise_knowledge_sharing"))
+	{
+		knob::le_featurewise_knowledge_sharing = atoi(value);
+	}
+	else if (MATCH("", "le_featurewise_knowledge_merge_epoch"))
+	{
+		knob::le_featurewise_knowledge_merge_epoch = atol(value);
+	}
 	else if (MATCH("", "le_featurewise_enable_trace"))
 	{
 	   knob::le_featurewise_enable_trace = !strcmp(value, "true") ? true : false;
@@ -3,6 +3,7 @@
 #include <assert.h>
 #include <strings.h>
 #include <numeric>
+#include <map>
 #include "util.h"
 #include "learning_engine_featurewise.h"
 #include "scooby.h"
@@ -41,8 +42,21 @@ namespace knob
 	extern vector<int32_t> le_featurewise_plot_actions;
 	extern std::string 	le_featurewise_plot_file_name;
 	extern bool 			le_featurewise_remove_plot_script;
+	extern uint32_t 		le_featurewise_knowledge_sharing;
+	extern uint64_t 		le_featurewise_knowledge_merge_epoch;
 }
 
+struct KnowledgeGroup
+{
+	vector<LearningEngineFeaturewise*> members;
+	uint64_t updates;
+	uint64_t merges;
+	double deviation;
+};
+
+/* one group per cache level; all cores' engines at that level join it */
+static std::map<std::string, KnowledgeGroup> knowledge_groups;
+
 void LearningEngineFeaturewise::init_knobs()
 {
 	assert(knob::le_featurewise_active_features.size() == knob::le_featurewise_num_tilings.size());
@@ -63,12 +77,27 @@ void LearningEngineFeaturewise::init_stats()
 LearningEngineFeaturewise::LearningEngineFeaturewise(Prefetcher *parent, float alpha, float gamma, float epsilon, uint32_t actions, uint64_t seed, std::string policy, std::string type, bool zero_init)
 	: LearningEngineBase(parent, alpha, gamma, epsilon, actions, 0 /*dummy state value*/, seed, policy, type)
 {
+	/* join the knowledge group of this cache level */
+	assert(knob::le_featurewise_knowledge_sharing < NumKnowledgeSharingTypes);
+	assert(knob::le_featurewise_knowledge_sharing != KS_Federated || knob::le_featurewise_knowledge_merge_epoch > 0);
+	m_group = &knowledge_groups[((Scooby*)parent)->get_level()];
+	m_owns_knowledge = true;
+
 	/* init each feature engine */
 	for(uint32_t index = 0; index < NumFeatureTypes; ++index)
 	{
 		m_feature_knowledges[index] = NULL;
 	}
-	for(uint32_t index = 0; index < knob::le_featurewise_active_features.size(); ++index)
+	if(knob::le_featurewise_knowledge_sharing == KS_Shared && !m_group->members.empty())
+	{
+		/* reuse the tables created by the first core at this level */
+		for(uint32_t index = 0; index < NumFeatureTypes; ++index)
+		{
+			m_feature_knowledges[index] = m_group->members[0]->m_feature_knowledges[index];
+		}
+		m_owns_knowledge = false;
+	}
+	for(uint32_t index = 0; m_owns_knowledge && index < knob::le_featurewise_active_features.size(); ++index)
 	{
 		assert(knob::le_featurewise_active_features[index] < NumFeatureTypes);
 		m_feature_knowledges[knob::le_featurewise_active_features[index]] = new FeatureKnowledge((FeatureType)knob::le_featurewise_active_features[index],
@@ -85,6 +114,7 @@ LearningEngineFeaturewise::LearningEngineFeaturewise(Prefetcher *parent, float a
 																							);
 		assert(m_feature_knowledges[knob::le_featurewise_active_features[index]]);
 	}
+	m_group->members.push_back(this);
 
 	m_max_q_value = (float)1/(1-gamma) * std::accumulate(knob::le_featurewise_num_tilings.begin(), knob::le_featurewise_num_tilings.end(), 0);
 	/* init Q-value buckets */
@@ -109,7 +139,7 @@ LearningEngineFeaturewise::LearningEngineFeaturewise(Prefetcher *parent, float a
 
 LearningEngineFeaturewise::~LearningEngineFeaturewise()
 {
-	for(uint32_t index = 0; index < NumFeatureTypes; ++index)
+	for(uint32_t index = 0; m_owns_knowledge && index < NumFeatureTypes; ++index)
 	{
 		if(m_feature_knowledges[index])
 			delete m_feature_knowledges[index];
@@ -175,6 +205,15 @@ void LearningEngineFeaturewise::learn(State *state1, uint32_t action1, int32_t r
 		{
 			adjust_feature_weights(consensus_vec, reward_type);
 		}
+
+		m_group->updates++;
+		if(knob::le_featurewise_knowledge_sharing == KS_Federated)
+		{
+			if(m_group->updates % knob::le_featurewise_knowledge_merge_epoch == 0 && m_group->members.size() > 1)
+			{
+				merge_knowledge();
+			}
+		}
 	}
 	else
 	{
@@ -183,22 +222,51 @@ void LearningEngineFeaturewise::learn(State *state1, uint32_t action1, int32_t r
 	}
 }
 
+void LearningEngineFeaturewise::merge_knowledge()
+{
+	vector<FeatureKnowledge*> knowledges;
+	for(uint32_t index = 0; index < NumFeatureTypes; ++index)
+	{
+		if(!m_feature_knowledges[index])
+		{
+			continue;
+		}
+		knowledges.clear();
+		for(uint32_t member = 0; member < m_group->members.size(); ++member)
+		{
+			knowledges.push_back(m_group->members[member]->m_feature_knowledges[index]);
+		}
+		m_group->deviation += FeatureKnowledge::average(knowledges);
+	}
+	m_group->merges++;
+}
+
 uint32_t LearningEngineFeaturewise::getMaxAction(State *state, float &max_q, float &max_to_avg_q_ratio, vector<bool> &consensus_vec)
 {
 	float max_q_value = 0.0, q_value = 0.0, total_q_value = 0.0;
 	uint32_t selected_action = 0, init_index = 0;
 
+	/* every action looks up the same tiles, so compute them once per feature */
+	uint32_t tile_index[NumFeatureTypes][FK_MAX_TILINGS];
+	for(uint32_t index = 0; index < NumFeatureTypes; ++index)
+	{
+		if(m_feature_knowledges[index])
+		{
+			m_feature_knowledges[index]->get_tile_indices(state, tile_index[index]);
+		}
+	}
+
 	bool fallback = do_fallback(state);
 
 	if(!fallback)
 	{
-		max_q_value = consultQ(state, 0);
+		max_q_value = consultQ(tile_index, 0);
 		total_q_value += max_q_value;
 		init_index = 1;
 	}
 	for(uint32_t action = init_index; action < m_actions; ++action)
 	{
-		q_value = consultQ(state, action);
+		q_value = consultQ(tile_index, action);
 		total_q_value += q_value;
 		if(q_value > max_q_value)
 		{
@@ -232,7 +300,7 @@ uint32_t LearningEngineFeaturewise::getMaxAction(State *state, float &max_q, flo
 	return selected_action;
 }
 
-float LearningEngineFeaturewise::consultQ(State *state, uint32_t action)
+float LearningEngineFeaturewise::consultQ(uint32_t tile_index[][FK_MAX_TILINGS], uint32_t action)
 {
 	assert(action < m_actions);
 	float q_value = 0.0;
@@ -245,11 +313,11 @@ float LearningEngineFeaturewise::consultQ(State *state, uint32_t action)
 		{
 			if(knob::le_featurewise_pooling_type == 1) /* sum pooling */
 			{
-				q_value += m_feature_knowledges[index]->retrieveQ(state, action);
+				q_value += m_feature_knowledges[index]->retrieveQ(tile_index[index], action);
 			}
 			else if(knob::le_featurewise_pooling_type == 2) /* max pooling */
 			{
-				float tmp = m_feature_knowledges[index]->retrieveQ(state, action);
+				float tmp = m_feature_knowledges[index]->retrieveQ(tile_index[index], action);
 				if(tmp >= max)
 				{
 					max = tmp;
@@ -317,7 +385,35 @@ void LearningEngineFeaturewise::dump_stats()
 		{
 			fprintf(stdout, "learning_engine_featurewise.feature_%s_min_weight %0.8f\n", FeatureKnowledge::getFeatureString((FeatureType)index).c_str(), m_feature_knowledges[index]->get_min_weight());
 			fprintf(stdout, "learning_engine_featurewise.feature_%s_max_weight %0.8f\n", FeatureKnowledge::getFeatureString((FeatureType)index).c_str(), m_feature_knowledges[index]->get_max_weight());
+			fprintf(stdout, "learning_engine_featurewise.feature_%s_specialized_kernel %u\n", FeatureKnowledge::getFeatureString((FeatureType)index).c_str(), m_feature_knowledges[index]->has_specialized_kernel());
+		}
+	}
+
+	/* knowledge sharing stats */
+	fprintf(stdout, "learning_engine_featurewise.knowledge.sharing %u\n", knob::le_featurewise_knowledge_sharing);
+	fprintf(stdout, "learning_engine_featurewise.knowledge.owns_qtables %u\n", m_owns_knowledge);
+	fprintf(stdout, "\n");
+
+	/* the group's counters and the footprint of all its tables are dumped once, by its first member */
+	if(m_group->members[0] == this)
+	{
+		uint64_t qtable_bytes = 0;
+		for(uint32_t member = 0; member < m_group->members.size(); ++member)
+		{
+			for(uint32_t index = 0; m_group->members[member]->m_owns_knowledge && index < NumFeatureTypes; ++index)
+			{
+				if(m_group->members[member]->m_feature_knowledges[index])
+				{
+					qtable_bytes += m_group->members[member]->m_feature_knowledges[index]->get_qtable_bytes();
+				}
+			}
 		}
+		fprintf(stdout, "learning_engine_featurewise.knowledge.group_size %lu\n", m_group->members.size());
+		fprintf(stdout, "learning_engine_featurewise.knowledge.group_qtable_bytes %lu\n", qtable_bytes);
+		fprintf(stdout, "learning_engine_featurewise.knowledge.group_updates %lu\n", m_group->updates);
+		fprintf(stdout, "learning_engine_featurewise.knowledge.merges %lu\n", m_group->merges);
+		fprintf(stdout, "learning_engine_featurewise.knowledge.avg_merge_deviation %0.6f\n", m_group->merges ? m_group->deviation/m_group->merges : 0.0);
+		fprintf(stdout, "\n");
 	}
 
 	/* score plotting */
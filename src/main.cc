@@ -4,6 +4,7 @@
 #include "ooo_cpu.h"
 #include "uncore.h"
 #include "knobs.h"
+#include "compression.h"
 #include <fstream>
 
 #define FIXED_FLOAT(x) std::fixed << std::setprecision(5) << (x)
@@ -39,6 +40,17 @@ namespace knob
     extern bool     measure_ipc;
     extern uint32_t measure_ipc_epoch;
     extern uint32_t dram_io_freq;
+    extern bool     dram_detailed_timing;
+    extern string   numa_placement;
+    extern bool     ptw_enable;
+    extern float    huge_page_fraction;
+    extern uint32_t stlb_huge_entries;
+    extern bool     llc_compression;
+    extern bool     dram_compression;
+    extern bool     coherence_directory;
+    extern bool     shared_address_space;
+    extern uint32_t llc_slices;
+    extern uint32_t ftq_size;
     extern bool     measure_dram_bw;
     extern uint64_t measure_dram_bw_epoch;
     extern bool     measure_cache_acc;
@@ -58,6 +70,13 @@ time_t start_time;
 uint32_t PAGE_TABLE_LATENCY = 0, SWAP_LATENCY = 0;
 queue <uint64_t > page_queue;
 map <uint64_t, uint64_t> page_table, inverse_table, recent_page, unique_cl[NUM_CPUS];
+uint64_t numa_interleave_count[NUM_CPUS];
+
+// 2MB mappings: virtual region => first physical page of its frame, and frame => virtual region
+#define HUGE_PAGE_PAGES (1ull << (LOG2_HUGE_PAGE_SIZE - LOG2_PAGE_SIZE))
+#define HUGE_PAGE_ALLOC_TRIES 16
+map <uint64_t, uint64_t> huge_page_table, huge_inverse_table;
+uint64_t huge_pages[NUM_CPUS];
 uint64_t previous_ppage, num_adjacent_page, num_cl[NUM_CPUS], allocated_pages, num_page[NUM_CPUS], minor_fault[NUM_CPUS], major_fault[NUM_CPUS];
 
 void record_roi_stats(uint32_t cpu, CACHE *cache)
@@ -100,7 +119,16 @@ void print_roi_stats(uint32_t cpu, CACHE *cache)
         << "Core_" << cpu << "_" << cache->NAME << "_prefetch_filled " << cache->pf_filled << endl
         << "Core_" << cpu << "_" << cache->NAME << "_prefetch_useful " << cache->pf_useful << endl
         << "Core_" << cpu << "_" << cache->NAME << "_prefetch_useless " << cache->pf_useless << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_prefetch_late " << cache->pf_late << endl
+        << "Core_" << cpu << "_" << cache->NAME << "_prefetch_late " << cache->pf_late << endl;
+
+    for (uint32_t i=0; i<PF_CONF_LEVELS; i++) {
+        cout << "Core_" << cpu << "_" << cache->NAME << "_prefetch_conf_" << i << "_filled " << cache->pf_conf_filled[i] << endl
+            << "Core_" << cpu << "_" << cache->NAME << "_prefetch_conf_" << i << "_useful " << cache->pf_conf_useful[i] << endl;
+    }
+
+    cout<< "Core_" << cpu << "_" << cache->NAME << "_wrong_path_load_access " << cache->wp_access << endl
+        << "Core_" << cpu << "_" << cache->NAME << "_wrong_path_load_hit " << cache->wp_hit << endl
+        << "Core_" << cpu << "_" << cache->NAME << "_wrong_path_load_miss " << cache->wp_miss << endl
         << "Core_" << cpu << "_" << cache->NAME << "_average_miss_latency " << (1.0*(cache->total_miss_latency))/TOTAL_MISS << endl
         << endl
         << "Core_" << cpu << "_" << cache->NAME << "_rq_access " << cache->RQ.ACCESS << endl
@@ -162,36 +190,111 @@ void print_branch_stats(uint32_t cpu)
         cout << "Core_" << cpu << "_branch_prediction_accuracy " << (100.0*(ooo_cpu[cpu].num_branch - ooo_cpu[cpu].branch_mispredictions)) / ooo_cpu[cpu].num_branch << endl
             << "Core_" << cpu << "_branch_MPKI " << (1000.0*ooo_cpu[cpu].branch_mispredictions)/(ooo_cpu[cpu].num_retired - ooo_cpu[cpu].warmup_instructions) << endl
             << "Core_" << cpu << "_average_ROB_occupancy_at_mispredict " << (1.0*ooo_cpu[cpu].total_rob_occupancy_at_branch_mispredict)/ooo_cpu[cpu].branch_mispredictions << endl
-            << endl;
+            << "Core_" << cpu << "_wrong_path_mispredicts " << ooo_cpu[cpu].wp_mispredicts << endl
+            << "Core_" << cpu << "_wrong_path_loads_issued " << ooo_cpu[cpu].wp_issued << endl
+            << "Core_" << cpu << "_wrong_path_loads_unmapped " << ooo_cpu[cpu].wp_unmapped << endl
+            << "Core_" << cpu << "_ftq_fetch_blocks " << ooo_cpu[cpu].ftq_blocks << endl
+            << "Core_" << cpu << "_ftq_full_stalls " << ooo_cpu[cpu].ftq_full << endl
+            << "Core_" << cpu << "_ftq_untranslated_blocks " << ooo_cpu[cpu].ftq_untranslated << endl
+            << "Core_" << cpu << "_ftq_avg_lead_cycles " << (ooo_cpu[cpu].ftq_blocks ? (double)ooo_cpu[cpu].ftq_lead_cycles / ooo_cpu[cpu].ftq_blocks : 0) << endl;
+        ooo_cpu[cpu].branch_predictor_final_stats();
+        cout << endl;
     // }
 }
 
-void print_dram_stats()
+// with more than one controller every stat is prefixed by its node
+void print_dram_controller_stats(MEMORY_CONTROLLER *dram, string prefix)
 {
     // cout << endl;
     // cout << "DRAM Statistics" << endl;
     for (uint32_t i=0; i<DRAM_CHANNELS; i++)
     {
-        cout << "Channel_" << i << "_RQ_row_buffer_hit " << uncore.DRAM.RQ[i].ROW_BUFFER_HIT << endl
-            << "Channel_" << i << "_RQ_row_buffer_miss " << uncore.DRAM.RQ[i].ROW_BUFFER_MISS << endl
-            << "Channel_" << i << "_WQ_row_buffer_hit " << uncore.DRAM.WQ[i].ROW_BUFFER_HIT << endl
-            << "Channel_" << i << "_WQ_row_buffer_miss " << uncore.DRAM.WQ[i].ROW_BUFFER_MISS << endl
-            << "Channel_" << i << "_WQ_full " << uncore.DRAM.WQ[i].FULL << endl
-            << "Channel_" << i << "_dbus_congested " << uncore.DRAM.dbus_congested[i][NUM_TYPES][NUM_TYPES] << endl
-            << endl;
+        cout << prefix << "Channel_" << i << "_RQ_row_buffer_hit " << dram->RQ[i].ROW_BUFFER_HIT << endl
+            << prefix << "Channel_" << i << "_RQ_row_buffer_miss " << dram->RQ[i].ROW_BUFFER_MISS << endl
+            << prefix << "Channel_" << i << "_WQ_row_buffer_hit " << dram->WQ[i].ROW_BUFFER_HIT << endl
+            << prefix << "Channel_" << i << "_WQ_row_buffer_miss " << dram->WQ[i].ROW_BUFFER_MISS << endl
+            << prefix << "Channel_" << i << "_WQ_full " << dram->WQ[i].FULL << endl
+            << prefix << "Channel_" << i << "_dbus_congested " << dram->dbus_congested[i][NUM_TYPES][NUM_TYPES] << endl
+            << prefix << "Channel_" << i << "_dbus_utilization " << (dram->telemetry[i].cycles ? (float)dram->telemetry[i].busy_cycles / dram->telemetry[i].cycles : 0) << endl;
+        if (knob::dram_detailed_timing)
+            cout << prefix << "Channel_" << i << "_refreshes " << dram->refreshes[i] << endl
+                << prefix << "Channel_" << i << "_refresh_cycles " << dram->refresh_cycles[i] << endl
+                << prefix << "Channel_" << i << "_act_delayed_rrd " << dram->act_delayed_rrd[i] << endl
+                << prefix << "Channel_" << i << "_act_delayed_faw " << dram->act_delayed_faw[i] << endl
+                << prefix << "Channel_" << i << "_cas_delayed_ccd " << dram->cas_delayed_ccd[i] << endl;
+        if (knob::dram_compression)
+            cout << prefix << "Channel_" << i << "_dbus_cycles_saved " << dram->dbus_cycles_saved[i] << endl;
+        cout << endl;
     }
 
     uint64_t total_congested_cycle = 0, total_congested = 0;
     for (uint32_t i=0; i<DRAM_CHANNELS; i++){
-        total_congested_cycle += uncore.DRAM.dbus_cycle_congested[i];
-	total_congested += uncore.DRAM.dbus_congested[i][NUM_TYPES][NUM_TYPES];
+        total_congested_cycle += dram->dbus_cycle_congested[i];
+	total_congested += dram->dbus_congested[i][NUM_TYPES][NUM_TYPES];
     }
     if (total_congested)
-        cout << "avg_congested_cycle " << (total_congested_cycle / total_congested) << endl;
+        cout << prefix << "avg_congested_cycle " << (total_congested_cycle / total_congested) << endl;
     else
-        cout << "avg_congested_cycle 0" << endl;
+        cout << prefix << "avg_congested_cycle 0" << endl;
     cout << endl;
 
+    cout << prefix << "DRAM_prefetch_dropped " << dram->pf_dropped << endl
+        << prefix << "DRAM_prefetch_drop_refused " << dram->pf_drop_refused << endl
+        << prefix << "DRAM_prefetch_promoted " << dram->pf_promoted << endl
+        << prefix << "DRAM_demand_returned " << dram->demand_returned << endl
+        << prefix << "DRAM_demand_avg_latency " << (dram->demand_returned ? dram->demand_latency_total / dram->demand_returned : 0) << endl
+        << prefix << "DRAM_prefetch_returned " << dram->prefetch_returned << endl
+        << prefix << "DRAM_prefetch_avg_latency " << (dram->prefetch_returned ? dram->prefetch_latency_total / dram->prefetch_returned : 0) << endl;
+    for (uint32_t i=0; i<DRAM_LATENCY_BUCKETS; i++)
+        cout << prefix << "DRAM_demand_latency_hist_" << i << " " << dram->demand_latency_hist[i] << endl;
+    for (uint32_t i=0; i<DRAM_LATENCY_BUCKETS; i++)
+        cout << prefix << "DRAM_prefetch_latency_hist_" << i << " " << dram->prefetch_latency_hist[i] << endl;
+    cout << endl;
+}
+
+void print_ptw_stats(uint32_t cpu)
+{
+    PAGE_TABLE_WALKER *ptw = &ooo_cpu[cpu].PTW;
+    cout << "Core_" << cpu << "_PTW_walks " << ptw->walks << endl
+        << "Core_" << cpu << "_PTW_avg_walk_latency " << (ptw->walks ? ptw->walk_cycles / ptw->walks : 0) << endl
+        << "Core_" << cpu << "_PTW_entry_loads " << ptw->entry_loads << endl
+        << "Core_" << cpu << "_PTW_entry_merged " << ptw->entry_merged << endl
+        << "Core_" << cpu << "_PTW_PML4_cache_access " << ptw->psc[4].access << endl
+        << "Core_" << cpu << "_PTW_PML4_cache_hit " << ptw->psc[4].hit << endl
+        << "Core_" << cpu << "_PTW_PDP_cache_access " << ptw->psc[3].access << endl
+        << "Core_" << cpu << "_PTW_PDP_cache_hit " << ptw->psc[3].hit << endl
+        << "Core_" << cpu << "_PTW_PDE_cache_access " << ptw->psc[2].access << endl
+        << "Core_" << cpu << "_PTW_PDE_cache_hit " << ptw->psc[2].hit << endl
+        << "Core_" << cpu << "_PTW_huge_page_walks " << ptw->huge_walks << endl
+        << endl;
+}
+
+void print_huge_page_stats(uint32_t cpu)
+{
+    cout << "Core_" << cpu << "_huge_pages " << huge_pages[cpu] << endl
+        << "Core_" << cpu << "_STLB_2M_access " << ooo_cpu[cpu].STLB_2M.access << endl
+        << "Core_" << cpu << "_STLB_2M_hit " << ooo_cpu[cpu].STLB_2M.hit << endl
+        << endl;
+}
+
+void print_dram_stats()
+{
+    if (uncore.NUMA.num_nodes == 1)
+        print_dram_controller_stats(&uncore.DRAM, "");
+    else {
+        for (uint32_t n=0; n<uncore.NUMA.num_nodes; n++) {
+            string prefix = "Node_" + to_string(n) + "_";
+            print_dram_controller_stats(uncore.NUMA.node[n], prefix);
+            cout << prefix << "local_reads " << uncore.NUMA.local_reads[n] << endl
+                << prefix << "remote_reads " << uncore.NUMA.remote_reads[n] << endl
+                << prefix << "writes " << uncore.NUMA.writes[n] << endl
+                << endl;
+        }
+    }
+
+    cout << "DRAM_prefetch_drop_refused_shared " << uncore.LLC.pf_drop_refused_shared << endl
+        << endl;
+
     cout << "DRAM_bw_pochs " << uncore.DRAM.total_bw_epochs << endl;
     for(uint32_t index = 0; index < DRAM_BW_LEVELS; ++index)
     {
@@ -215,6 +318,12 @@ void reset_cache_stats(uint32_t cpu, CACHE *cache)
 
     cache->total_miss_latency = 0;
 
+    cache->wp_access = 0;
+    cache->wp_hit = 0;
+    cache->wp_miss = 0;
+
+    cache->pf_drop_refused_shared = 0;
+
     cache->RQ.ACCESS = 0;
     cache->RQ.MERGED = 0;
     cache->RQ.TO_CACHE = 0;
@@ -252,6 +361,24 @@ void finish_warmup()
         ooo_cpu[i].num_branch = 0;
         ooo_cpu[i].branch_mispredictions = 0;
 	ooo_cpu[i].total_rob_occupancy_at_branch_mispredict = 0;
+        ooo_cpu[i].wp_mispredicts = 0;
+        ooo_cpu[i].PTW.walks = 0;
+        ooo_cpu[i].PTW.walk_cycles = 0;
+        ooo_cpu[i].PTW.entry_loads = 0;
+        ooo_cpu[i].PTW.entry_merged = 0;
+        ooo_cpu[i].PTW.huge_walks = 0;
+        ooo_cpu[i].STLB_2M.access = 0;
+        ooo_cpu[i].STLB_2M.hit = 0;
+        for (uint32_t level=2; level<=PTW_LEVELS; level++) {
+            ooo_cpu[i].PTW.psc[level].access = 0;
+            ooo_cpu[i].PTW.psc[level].hit = 0;
+        }
+        ooo_cpu[i].wp_issued = 0;
+        ooo_cpu[i].wp_unmapped = 0;
+        ooo_cpu[i].ftq_blocks = 0;
+        ooo_cpu[i].ftq_full = 0;
+        ooo_cpu[i].ftq_untranslated = 0;
+        ooo_cpu[i].ftq_lead_cycles = 0;
 
         reset_cache_stats(i, &ooo_cpu[i].L1I);
         reset_cache_stats(i, &ooo_cpu[i].L1D);
@@ -261,13 +388,45 @@ void finish_warmup()
     cout << endl;
 
     // reset DRAM stats
-    for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
-        uncore.DRAM.RQ[i].ROW_BUFFER_HIT = 0;
-        uncore.DRAM.RQ[i].ROW_BUFFER_MISS = 0;
-        uncore.DRAM.WQ[i].ROW_BUFFER_HIT = 0;
-        uncore.DRAM.WQ[i].ROW_BUFFER_MISS = 0;
+    for (uint32_t n=0; n<uncore.NUMA.num_nodes; n++) {
+        MEMORY_CONTROLLER *dram = uncore.NUMA.node[n];
+        for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
+            dram->RQ[i].ROW_BUFFER_HIT = 0;
+            dram->RQ[i].ROW_BUFFER_MISS = 0;
+            dram->WQ[i].ROW_BUFFER_HIT = 0;
+            dram->WQ[i].ROW_BUFFER_MISS = 0;
+            dram->refreshes[i] = 0;
+            dram->refresh_cycles[i] = 0;
+            dram->act_delayed_rrd[i] = 0;
+            dram->act_delayed_faw[i] = 0;
+            dram->cas_delayed_ccd[i] = 0;
+            dram->dbus_cycles_saved[i] = 0;
+        }
+        for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
+            dram->telemetry[i].busy_cycles = 0;
+            dram->telemetry[i].cycles = 0;
+        }
+        dram->pf_dropped = 0;
+        dram->pf_drop_refused = 0;
+        dram->pf_promoted = 0;
+        for (uint32_t i=0; i<DRAM_LATENCY_BUCKETS; i++) {
+            dram->demand_latency_hist[i] = 0;
+            dram->prefetch_latency_hist[i] = 0;
+        }
+        dram->demand_latency_total = 0;
+        dram->prefetch_latency_total = 0;
+        dram->demand_returned = 0;
+        dram->prefetch_returned = 0;
+        uncore.NUMA.local_reads[n] = 0;
+        uncore.NUMA.remote_reads[n] = 0;
+        uncore.NUMA.writes[n] = 0;
     }
 
+    if (knob::coherence_directory)
+        uncore.DIRECTORY.reset_stats();
+    if (knob::llc_slices > 1)
+        uncore.INTERCONNECT.reset_stats();
+
     // set actual cache latency
     for (uint32_t i=0; i<NUM_CPUS; i++) {
         ooo_cpu[i].ITLB.LATENCY = ITLB_LATENCY;
@@ -351,7 +510,96 @@ uint64_t rotr64 (uint64_t n, unsigned int c)
     return (n>>c) | (n<<( (-c)&mask ));
 }
 
+// bits folded into a cpu's virtual pages to keep the address spaces of the cores apart,
+// none when knob::shared_address_space lets the cores share their data
+uint64_t address_space_bits(uint32_t cpu)
+{
+    if (knob::shared_address_space)
+        return 0;
+
+    return rotr64(cpu, lg2(NUM_CPUS));
+}
+
 RANDOM champsim_rand(champsim_seed);
+// node the placement policy picks for a new page of this cpu: its own node for first-touch,
+// or the cpu's next node in round robin for interleave
+uint32_t numa_page_node(uint32_t cpu)
+{
+    uint32_t home = uncore.NUMA.home_node(cpu);
+    if (!knob::numa_placement.compare("interleave"))
+        return (home + numa_interleave_count[cpu]) % uncore.NUMA.num_nodes;
+
+    return home;
+}
+
+// moves a candidate physical page into the node's slice, keeping its offset within the slice
+uint64_t numa_place_page(uint64_t ppage, uint32_t node)
+{
+    uint64_t slice = 1ull << (DRAM_NODE_SHIFT + LOG2_BLOCK_SIZE - LOG2_PAGE_SIZE),
+             span = slice * uncore.NUMA.num_nodes;
+
+    return (ppage / span) * span + node * slice + (ppage % slice);
+}
+
+// THP-style promotion: the first fault in a 2MB virtual region backs the whole region with one
+// 2MB frame, for a knob::huge_page_fraction share of the regions (picked by hashing the region)
+bool huge_page_candidate(uint64_t vregion)
+{
+    if (knob::huge_page_fraction <= 0)
+        return false;
+
+    uint64_t hash = (vregion * 0x9E3779B97F4A7C15ull) >> 40;
+    return hash < knob::huge_page_fraction * (1ull << 24);
+}
+
+// maps every page of vpage's region onto a free 2MB-aligned frame. Gives up, leaving the fault to
+// the 4KB allocator, if the region already holds 4KB pages or no free frame turns up quickly
+bool allocate_huge_page(uint32_t cpu, uint64_t vpage)
+{
+    uint64_t vregion = vpage >> (LOG2_HUGE_PAGE_SIZE - LOG2_PAGE_SIZE),
+             first_vpage = vregion << (LOG2_HUGE_PAGE_SIZE - LOG2_PAGE_SIZE);
+
+    if (allocated_pages + HUGE_PAGE_PAGES > DRAM_PAGES * uncore.NUMA.num_nodes)
+        return false;
+
+    map <uint64_t, uint64_t>::iterator pr = page_table.lower_bound(first_vpage);
+    if ((pr != page_table.end()) && (pr->first < first_vpage + HUGE_PAGE_PAGES))
+        return false;
+
+    uint8_t numa_place = (uncore.NUMA.num_nodes > 1) && knob::numa_placement.compare("none");
+    uint32_t numa_node = numa_place ? numa_page_node(cpu) : 0;
+
+    uint64_t frame = 0;
+    uint32_t tries;
+    for (tries=0; tries<HUGE_PAGE_ALLOC_TRIES; tries++) {
+        frame = champsim_rand.draw_rand();
+        if (numa_place)
+            frame = numa_place_page(frame, numa_node);
+        frame &= ~(HUGE_PAGE_PAGES - 1);
+
+        map <uint64_t, uint64_t>::iterator ppage_check = inverse_table.lower_bound(frame);
+        if ((ppage_check == inverse_table.end()) || (ppage_check->first >= frame + HUGE_PAGE_PAGES))
+            break;
+    }
+    if (tries == HUGE_PAGE_ALLOC_TRIES)
+        return false;
+
+    for (uint64_t i=0; i<HUGE_PAGE_PAGES; i++) {
+        page_table.insert(make_pair(first_vpage + i, frame + i));
+        inverse_table.insert(make_pair(frame + i, first_vpage + i));
+        page_queue.push(first_vpage + i);
+    }
+    huge_page_table.insert(make_pair(vregion, frame));
+    huge_inverse_table.insert(make_pair(frame >> (LOG2_HUGE_PAGE_SIZE - LOG2_PAGE_SIZE), vregion));
+
+    num_page[cpu] += HUGE_PAGE_PAGES;
+    allocated_pages += HUGE_PAGE_PAGES;
+    numa_interleave_count[cpu]++;
+    huge_pages[cpu]++;
+
+    return true;
+}
+
 uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_vpage)
 {
 #ifdef SANITY_CHECK
@@ -360,7 +608,7 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
 #endif
 
     uint8_t  swap = 0;
-    uint64_t high_bit_mask = rotr64(cpu, lg2(NUM_CPUS)),
+    uint64_t high_bit_mask = address_space_bits(cpu),
              unique_va = va | high_bit_mask;
     //uint64_t vpage = unique_va >> LOG2_PAGE_SIZE,
     uint64_t vpage = unique_vpage | high_bit_mask,
@@ -384,7 +632,7 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
     pr = page_table.find(vpage);
     if (pr == page_table.end()) { // no VA => PA translation found
 
-        if (allocated_pages >= DRAM_PAGES) { // not enough memory
+        if (allocated_pages >= DRAM_PAGES * uncore.NUMA.num_nodes) { // not enough memory
 
             // TODO: elaborate page replacement algorithm
             // here, ChampSim randomly selects a page that is not recently used and we only track 32K recently accessed pages
@@ -423,6 +671,9 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
 #endif
             ppage_check->second = vpage;
 
+            // a 2MB frame that gives up one of its pages is no longer contiguous
+            huge_inverse_table.erase(mapped_ppage >> (LOG2_HUGE_PAGE_SIZE - LOG2_PAGE_SIZE));
+
             DP ( if (warmup_complete[cpu]) {
             cout << "[SWAP] update inverse table NRU_vpage: " << hex << NRU_vpage << " new_vpage: ";
             cout << ppage_check->second << " ppage: " << ppage_check->first << dec << endl; });
@@ -445,6 +696,8 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
 
             // swap complete
             swap = 1;
+        } else if (huge_page_candidate(vpage >> (LOG2_HUGE_PAGE_SIZE - LOG2_PAGE_SIZE)) && allocate_huge_page(cpu, vpage)) {
+            // the whole region is mapped now
         } else {
             uint8_t fragmented = 0;
             if (num_adjacent_page > 0)
@@ -454,6 +707,12 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
                 fragmented = 1;
             }
 
+            // without a placement policy the node is whatever the page's slice happens to be
+            uint8_t numa_place = (uncore.NUMA.num_nodes > 1) && knob::numa_placement.compare("none");
+            uint32_t numa_node = numa_place ? numa_page_node(cpu) : 0;
+            if (numa_place)
+                random_ppage = numa_place_page(random_ppage, numa_node);
+
             // encoding cpu number
             // this allows ChampSim to run homogeneous multi-programmed workloads without VA => PA aliasing
             // (e.g., cpu0: astar  cpu1: astar  cpu2: astar  cpu3: astar...)
@@ -471,6 +730,8 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
 
                     // try one more time
                     random_ppage = champsim_rand.draw_rand();
+                    if (numa_place)
+                        random_ppage = numa_place_page(random_ppage, numa_node);
 
                     // encoding cpu number
                     //random_ppage &= (~((NUM_CPUS-1)<<(32-LOG2_PAGE_SIZE)));
@@ -489,6 +750,7 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
             num_adjacent_page--;
             num_page[cpu]++;
             allocated_pages++;
+            numa_interleave_count[cpu]++;
 
             // try to allocate pages contiguously
             if (fragmented) {
@@ -521,9 +783,14 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
     cout << "[PAGE_TABLE] instr_id: " << instr_id << " vpage: " << hex << vpage;
     cout << " => ppage: " << (pa >> LOG2_PAGE_SIZE) << " vadress: " << unique_va << " paddress: " << pa << dec << endl; });
 
+    // the walk ended at a 2MB leaf, the STLB keeps it in its 2MB entries
+    if (huge_page_mapped(cpu, unique_vpage))
+        ooo_cpu[cpu].STLB_2M.fill(vpage >> (LOG2_HUGE_PAGE_SIZE - LOG2_PAGE_SIZE));
+
+    // the page table walker charges the walk itself
     if (swap)
         stall_cycle[cpu] = current_core_cycle[cpu] + SWAP_LATENCY;
-    else
+    else if (!knob::ptw_enable)
         stall_cycle[cpu] = current_core_cycle[cpu] + PAGE_TABLE_LATENCY;
 
     //cout << "cpu: " << cpu << " allocated unique_vpage: " << hex << unique_vpage << " to ppage: " << ppage << dec << endl;
@@ -531,6 +798,82 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
     return pa;
 }
 
+// side-effect free translation for prefetchers: unlike va_to_pa, these never
+// allocate a page, touch the TLBs or charge any page table latency
+bool lookup_va_to_pa(uint32_t cpu, uint64_t va, uint64_t &pa)
+{
+    return lookup_vpage_to_pa(cpu, va >> LOG2_PAGE_SIZE, va, pa);
+}
+
+// same, for callers that build the TLB's unique_vpage themselves (e.g. cloudsuite asids)
+bool lookup_vpage_to_pa(uint32_t cpu, uint64_t unique_vpage, uint64_t va, uint64_t &pa)
+{
+    uint64_t vpage = unique_vpage | address_space_bits(cpu);
+    map <uint64_t, uint64_t>::iterator pr = page_table.find(vpage);
+    if (pr == page_table.end())
+        return false;
+
+    pa = (pr->second << LOG2_PAGE_SIZE) | (va & ((1 << LOG2_PAGE_SIZE) - 1));
+    return true;
+}
+
+bool lookup_pa_to_va(uint64_t pa, uint64_t &va)
+{
+    map <uint64_t, uint64_t>::iterator pr = inverse_table.find(pa >> LOG2_PAGE_SIZE);
+    if (pr == inverse_table.end())
+        return false;
+
+    // the cpu bits folded into the vpage fall off the top here; lookup_va_to_pa puts them back
+    va = (pr->second << LOG2_PAGE_SIZE) | (pa & ((1 << LOG2_PAGE_SIZE) - 1));
+    return true;
+}
+
+// the page is part of a region backed by a 2MB frame
+bool huge_page_mapped(uint32_t cpu, uint64_t unique_vpage)
+{
+    if (huge_page_table.empty())
+        return false;
+
+    uint64_t vpage = unique_vpage | address_space_bits(cpu);
+    map <uint64_t, uint64_t>::iterator hr = huge_page_table.find(vpage >> (LOG2_HUGE_PAGE_SIZE - LOG2_PAGE_SIZE));
+    if (hr == huge_page_table.end())
+        return false;
+
+    // a swap may have moved the page out of the frame
+    map <uint64_t, uint64_t>::iterator pr = page_table.find(vpage);
+    return (pr != page_table.end()) && ((pr->second & ~(HUGE_PAGE_PAGES - 1)) == hr->second);
+}
+
+// translation from the STLB's 2MB entries, which only cover pages of huge-page-backed regions
+bool stlb_huge_lookup(uint32_t cpu, uint64_t unique_vpage, uint64_t va, uint64_t &pa)
+{
+    if (!huge_page_mapped(cpu, unique_vpage))
+        return false;
+
+    uint64_t vpage = unique_vpage | address_space_bits(cpu);
+    if (!ooo_cpu[cpu].STLB_2M.lookup(vpage >> (LOG2_HUGE_PAGE_SIZE - LOG2_PAGE_SIZE)))
+        return false;
+
+    return lookup_vpage_to_pa(cpu, unique_vpage, va, pa);
+}
+
+// log2 of the size of the physically contiguous page holding pa, so that physical-address
+// prefetchers know how far they can go past a 4KB boundary
+uint32_t lookup_page_shift(uint64_t pa)
+{
+    if (huge_inverse_table.find(pa >> LOG2_HUGE_PAGE_SIZE) != huge_inverse_table.end())
+        return LOG2_HUGE_PAGE_SIZE;
+
+    return LOG2_PAGE_SIZE;
+}
+
+// lets a data prefetcher get the translation of a page it is about to prefetch into ahead of
+// the demand access, through the STLB's prefetch queue
+int request_translation(uint32_t cpu, uint64_t va)
+{
+    return ooo_cpu[cpu].STLB.prefetch_translation(0, va >> LOG2_PAGE_SIZE);
+}
+
 void print_knobs()
 {
     cout << "warmup_instructions " << knob::warmup_instructions << endl
@@ -552,6 +895,8 @@ void print_knobs()
         << "l2c_semi_perfect " << knob::l2c_semi_perfect << endl
         << "llc_semi_perfect " << knob::llc_semi_perfect << endl
         << "semi_perfect_cache_page_buffer_size " << knob::semi_perfect_cache_page_buffer_size << endl
+        << "coherence_directory " << knob::coherence_directory << endl
+        << "shared_address_space " << knob::shared_address_space << endl
         << endl;
     cout << "num_cpus " << NUM_CPUS << endl
         << "cpu_freq " << CPU_FREQ << endl
@@ -576,6 +921,8 @@ void print_knobs()
 
     // for(uint32_t index = 0; index < NUM_CPUS; ++index)
     // {
+        ooo_cpu[0].L1I.l1i_prefetcher_print_config();
+        ooo_cpu[0].STLB.stlb_prefetcher_print_config();
         ooo_cpu[0].L1D.l1d_prefetcher_print_config();
         ooo_cpu[0].L2C.l2c_prefetcher_print_config();
     // }
@@ -641,12 +988,14 @@ int main(int argc, char** argv)
     tRP  = (uint32_t)((1.0 * tRP_DRAM_NANOSECONDS  * CPU_FREQ) / 1000);
     tRCD = (uint32_t)((1.0 * tRCD_DRAM_NANOSECONDS * CPU_FREQ) / 1000);
     tCAS = (uint32_t)((1.0 * tCAS_DRAM_NANOSECONDS * CPU_FREQ) / 1000);
+    dram_initialize_timing();
+    uncore.NUMA.initialize();
 
     // default: 16 = (64 / 8) * (3200 / 1600)
     // it takes 16 CPU cycles to tranfser 64B cache block on a 8B (64-bit) bus
     // note that dram burst length = BLOCK_SIZE/DRAM_CHANNEL_WIDTH
     DRAM_DBUS_RETURN_TIME = (BLOCK_SIZE / DRAM_CHANNEL_WIDTH) * (1.0 * CPU_FREQ / DRAM_MTPS);
-    DRAM_DBUS_MAX_CAS = DRAM_CHANNELS * (knob::measure_dram_bw_epoch / DRAM_DBUS_RETURN_TIME);
+    DRAM_DBUS_MAX_CAS = DRAM_CHANNELS * uncore.NUMA.num_nodes * (knob::measure_dram_bw_epoch / DRAM_DBUS_RETURN_TIME);
     // end consequence of knobs
 
     // search through the argv for "-traces"
@@ -733,6 +1082,7 @@ int main(int argc, char** argv)
 
         // ROB
         ooo_cpu[i].ROB.cpu = i;
+        ooo_cpu[i].initialize_core();
 
         // BRANCH PREDICTOR
         ooo_cpu[i].initialize_branch_predictor();
@@ -757,12 +1107,26 @@ int main(int argc, char** argv)
         ooo_cpu[i].STLB.upper_level_icache[i] = &ooo_cpu[i].ITLB;
         ooo_cpu[i].STLB.upper_level_dcache[i] = &ooo_cpu[i].DTLB;
 
+        if (knob::ptw_enable) {
+            ooo_cpu[i].STLB.lower_level = &ooo_cpu[i].PTW;
+            ooo_cpu[i].PTW.cpu = i;
+            ooo_cpu[i].PTW.upper_level_icache[i] = &ooo_cpu[i].STLB;
+            ooo_cpu[i].PTW.upper_level_dcache[i] = &ooo_cpu[i].STLB;
+            ooo_cpu[i].PTW.lower_level = &ooo_cpu[i].L1D;
+            ooo_cpu[i].PTW.initialize();
+        }
+
+        if (knob::huge_page_fraction > 0)
+            ooo_cpu[i].STLB_2M.initialize(knob::stlb_huge_entries);
+        ooo_cpu[i].STLB.stlb_prefetcher_initialize();
+
         // PRIVATE CACHE
         ooo_cpu[i].L1I.cpu = i;
         ooo_cpu[i].L1I.cache_type = IS_L1I;
         ooo_cpu[i].L1I.MAX_READ = (FETCH_WIDTH > MAX_READ_PER_CYCLE) ? MAX_READ_PER_CYCLE : FETCH_WIDTH;
         ooo_cpu[i].L1I.fill_level = FILL_L1;
         ooo_cpu[i].L1I.lower_level = &ooo_cpu[i].L2C;
+        ooo_cpu[i].L1I.l1i_prefetcher_initialize();
 
         ooo_cpu[i].L1D.cpu = i;
         ooo_cpu[i].L1D.cache_type = IS_L1D;
@@ -787,13 +1151,34 @@ int main(int argc, char** argv)
         uncore.LLC.upper_level_dcache[i] = &ooo_cpu[i].L2C;
         uncore.LLC.lower_level = &uncore.DRAM;
 
+        // MESI DIRECTORY
+        if (knob::coherence_directory) {
+            uncore.DIRECTORY.L1I[i] = &ooo_cpu[i].L1I;
+            uncore.DIRECTORY.L1D[i] = &ooo_cpu[i].L1D;
+            uncore.DIRECTORY.L2C[i] = &ooo_cpu[i].L2C;
+            uncore.DIRECTORY.LLC = &uncore.LLC;
+            ooo_cpu[i].L1D.directory = &uncore.DIRECTORY;
+            uncore.LLC.directory = &uncore.DIRECTORY;
+        }
+
         // OFF-CHIP DRAM
-        uncore.DRAM.fill_level = FILL_DRAM;
-        uncore.DRAM.upper_level_icache[i] = &uncore.LLC;
-        uncore.DRAM.upper_level_dcache[i] = &uncore.LLC;
-        for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
-            uncore.DRAM.RQ[i].is_RQ = 1;
-            uncore.DRAM.WQ[i].is_WQ = 1;
+        // with several controllers, the NUMA interconnect sits between them and the LLC
+        MEMORY *dram_upper_level = &uncore.LLC;
+        if (uncore.NUMA.num_nodes > 1) {
+            uncore.LLC.lower_level = &uncore.NUMA;
+            uncore.NUMA.upper_level_icache[i] = &uncore.LLC;
+            uncore.NUMA.upper_level_dcache[i] = &uncore.LLC;
+            dram_upper_level = &uncore.NUMA;
+        }
+        for (uint32_t n=0; n<uncore.NUMA.num_nodes; n++) {
+            MEMORY_CONTROLLER *dram = uncore.NUMA.node[n];
+            dram->fill_level = FILL_DRAM;
+            dram->upper_level_icache[i] = dram_upper_level;
+            dram->upper_level_dcache[i] = dram_upper_level;
+            for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
+                dram->RQ[i].is_RQ = 1;
+                dram->WQ[i].is_WQ = 1;
+            }
         }
 
         warmup_complete[i] = 0;
@@ -811,7 +1196,17 @@ int main(int argc, char** argv)
         major_fault[i] = 0;
     }
 
+    if (knob::llc_compression || knob::dram_compression)
+        initialize_compression();
+    uncore.LLC.llc_initialize_compression();
+    if (knob::llc_slices > 1) {
+        uncore.INTERCONNECT.initialize();
+        uncore.LLC.llc_initialize_slices(&uncore.INTERCONNECT);
+        for (uint32_t i=0; i<NUM_CPUS; i++)
+            ooo_cpu[i].L2C.interconnect = &uncore.INTERCONNECT;
+    }
     uncore.LLC.llc_initialize_replacement(champsim_seed);
+    uncore.LLC.llc_initialize_inclusion();
     uncore.LLC.llc_prefetcher_initialize();
 
     print_knobs();
@@ -864,7 +1259,13 @@ int main(int argc, char** argv)
             if (stall_cycle[i] <= current_core_cycle[i]) {
 
                 // fetch unit
-                if (ooo_cpu[i].ROB.occupancy < ooo_cpu[i].ROB.SIZE) {
+                if (knob::ftq_size) {
+                    // the predictor fills the FTQ regardless of ROB space, and the ROB takes instructions from FTQ blocks
+                    if (ooo_cpu[i].fetch_stall == 0)
+                        ooo_cpu[i].handle_branch();
+                    ooo_cpu[i].ftq_fetch();
+                }
+                else if (ooo_cpu[i].ROB.occupancy < ooo_cpu[i].ROB.SIZE) {
                     // handle branch
                     if (ooo_cpu[i].fetch_stall == 0)
                         ooo_cpu[i].handle_branch();
@@ -949,6 +1350,7 @@ int main(int argc, char** argv)
                 record_roi_stats(i, &ooo_cpu[i].L1D);
                 record_roi_stats(i, &ooo_cpu[i].L1I);
                 record_roi_stats(i, &ooo_cpu[i].L2C);
+                record_roi_stats(i, &ooo_cpu[i].STLB);
                 record_roi_stats(i, &uncore.LLC);
 
                 all_simulation_complete++;
@@ -963,15 +1365,16 @@ int main(int argc, char** argv)
         uncore.cycle++;
         if(knob::measure_dram_bw && uncore.cycle >= uncore.DRAM.next_bw_measure_cycle)
         {
-            uint64_t this_epoch_enqueue_count = uncore.DRAM.rq_enqueue_count - uncore.DRAM.last_enqueue_count;
+            uint64_t rq_enqueue_count = uncore.NUMA.rq_enqueue_count(),
+                     this_epoch_enqueue_count = rq_enqueue_count - uncore.DRAM.last_enqueue_count;
             uncore.DRAM.epoch_enqueue_count = (uncore.DRAM.epoch_enqueue_count/2) + this_epoch_enqueue_count;
             uint32_t quartile = ((float)100*uncore.DRAM.epoch_enqueue_count)/DRAM_DBUS_MAX_CAS;
             if(quartile <= 25)      uncore.DRAM.bw = 0;
             else if(quartile <= 50) uncore.DRAM.bw = 1;
             else if(quartile <= 75) uncore.DRAM.bw = 2;
             else                    uncore.DRAM.bw = 3;
-            MYLOG("cycle %lu rq_enqueue_count %lu last_enqueue_count %lu epoch_enqueue_count %lu QUARTILE %u", uncore.cycle, uncore.DRAM.rq_enqueue_count, uncore.DRAM.last_enqueue_count, uncore.DRAM.epoch_enqueue_count, uncore.DRAM.bw);
-            uncore.DRAM.last_enqueue_count = uncore.DRAM.rq_enqueue_count;
+            MYLOG("cycle %lu rq_enqueue_count %lu last_enqueue_count %lu epoch_enqueue_count %lu QUARTILE %u", uncore.cycle, rq_enqueue_count, uncore.DRAM.last_enqueue_count, uncore.DRAM.epoch_enqueue_count, uncore.DRAM.bw);
+            uncore.DRAM.last_enqueue_count = rq_enqueue_count;
             uncore.DRAM.next_bw_measure_cycle = uncore.cycle + knob::measure_dram_bw_epoch;
             uncore.DRAM.total_bw_epochs++;
             uncore.DRAM.bw_level_hist[uncore.DRAM.bw]++;
@@ -979,7 +1382,7 @@ int main(int argc, char** argv)
         }
 
         uncore.LLC.operate();
-        uncore.DRAM.operate();
+        uncore.NUMA.operate();
     }
 
     uint64_t elapsed_second = (uint64_t)(time(NULL) - start_time),
@@ -1020,17 +1423,31 @@ int main(int argc, char** argv)
         print_roi_stats(i, &ooo_cpu[i].L2C);
 #endif
         print_roi_stats(i, &uncore.LLC);
+        if (ooo_cpu[i].STLB.pf_requested)
+            print_roi_stats(i, &ooo_cpu[i].STLB);
         cout << "Core_" << i << "_major_page_fault " << major_fault[i] << endl
             << "Core_" << i << "_minor_page_fault " << minor_fault[i] << endl
             << endl;
+        if (knob::ptw_enable)
+            print_ptw_stats(i);
+        if (knob::huge_page_fraction > 0)
+            print_huge_page_stats(i);
     }
 
     for (uint32_t i=0; i<NUM_CPUS; i++) {
+        ooo_cpu[i].L1I.l1i_prefetcher_final_stats();
+        ooo_cpu[i].STLB.stlb_prefetcher_final_stats();
         ooo_cpu[i].L1D.l1d_prefetcher_final_stats();
         ooo_cpu[i].L2C.l2c_prefetcher_final_stats();
     }
 
     uncore.LLC.llc_prefetcher_final_stats();
+    uncore.LLC.llc_inclusion_final_stats();
+    uncore.LLC.llc_compression_final_stats();
+    if (knob::coherence_directory)
+        uncore.DIRECTORY.final_stats();
+    if (knob::llc_slices > 1)
+        uncore.INTERCONNECT.final_stats();
 
 #ifndef CRC2_COMPILE
     uncore.LLC.llc_replacement_final_stats();
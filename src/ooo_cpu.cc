@@ -3,6 +3,19 @@
 namespace knob
 {
 	extern bool knob_cloudsuite;
+	extern bool legacy_rob_scan_scheduling;
+	extern bool wrong_path_enable;
+	extern uint32_t wrong_path_budget;
+	extern uint32_t wrong_path_width;
+	extern uint32_t wrong_path_history_size;
+	extern uint32_t ftq_size;
+	extern bool ptw_enable;
+	extern uint32_t ptw_walkers;
+	extern uint32_t ptw_pml4_cache_size;
+	extern uint32_t ptw_pdp_cache_size;
+	extern uint32_t ptw_pde_cache_size;
+	extern float huge_page_fraction;
+	extern uint32_t stlb_huge_entries;
 }
 
 const char* GetAccessType(uint8_t type)
@@ -35,12 +48,29 @@ void print_core_config()
         << "num_instr_destinations_sparc " << NUM_INSTR_DESTINATIONS_SPARC << endl
         << "num_instr_destinations " << NUM_INSTR_DESTINATIONS << endl
         << "num_instr_sources " << NUM_INSTR_SOURCES << endl
+        << "legacy_rob_scan_scheduling " << knob::legacy_rob_scan_scheduling << endl
+        << "wrong_path_enable " << knob::wrong_path_enable << endl
+        << "wrong_path_budget " << knob::wrong_path_budget << endl
+        << "wrong_path_width " << knob::wrong_path_width << endl
+        << "wrong_path_history_size " << knob::wrong_path_history_size << endl
+        << "ftq_size " << knob::ftq_size << endl
+        << "ptw_enable " << knob::ptw_enable << endl
+        << "ptw_walkers " << knob::ptw_walkers << endl
+        << "ptw_pml4_cache_size " << knob::ptw_pml4_cache_size << endl
+        << "ptw_pdp_cache_size " << knob::ptw_pdp_cache_size << endl
+        << "ptw_pde_cache_size " << knob::ptw_pde_cache_size << endl
+        << "huge_page_fraction " << knob::huge_page_fraction << endl
+        << "stlb_huge_entries " << knob::stlb_huge_entries << endl
         << endl;
 }
 
 void O3_CPU::initialize_core()
 {
-
+    if (knob::wrong_path_enable) {
+        assert(knob::wrong_path_history_size > 0);
+        wp_table.resize(knob::wrong_path_history_size);
+        wp_recent_ip.resize(knob::wrong_path_history_size, 0);
+    }
 }
 
 void O3_CPU::handle_branch()
@@ -56,6 +86,16 @@ void O3_CPU::handle_branch()
     // first, read PIN trace
     while (continue_reading) {
 
+        // the predictor cannot run further ahead of fetch than the fetch target queue allows
+        if (knob::ftq_size && (FTQ.size() >= knob::ftq_size)) {
+            ftq_full++;
+            break;
+        }
+
+        // nor can it hand out more store IDs than STA holds, as its instructions are not in the ROB yet
+        if (knob::ftq_size && (STA[(STA_tail + NUM_INSTR_DESTINATIONS_SPARC - 1) % STA_SIZE] < UINT64_MAX))
+            break;
+
         size_t instr_size = knob::knob_cloudsuite ? sizeof(cloudsuite_instr) : sizeof(input_instr);
 
         if (knob::knob_cloudsuite) {
@@ -127,11 +167,14 @@ void O3_CPU::handle_branch()
                 if (num_mem_ops > 0) 
                     arch_instr.is_memory = 1;
 
-                // virtually add this instruction to the ROB
-                if (ROB.occupancy < ROB.SIZE) {
-                    uint32_t rob_index = add_to_rob(&arch_instr);
+                // virtually add this instruction to the ROB, or to the FTQ when the predictor runs ahead of fetch
+                if (knob::ftq_size || (ROB.occupancy < ROB.SIZE)) {
+                    ooo_model_instr *entry = knob::ftq_size ? ftq_enqueue(&arch_instr) : &ROB.entry[add_to_rob(&arch_instr)];
                     num_reads++;
 
+                    if (knob::wrong_path_enable)
+                        wrong_path_train(&arch_instr);
+
                     // branch prediction
                     if (arch_instr.is_branch) {
 
@@ -167,7 +210,16 @@ void O3_CPU::handle_branch()
                             // and stall any additional fetches until the branch is executed
                             fetch_stall = 1; 
 
-                            ROB.entry[rob_index].branch_mispredicted = 1;
+                            entry->branch_mispredicted = 1;
+
+                            // run down the predicted path until the branch resolves
+                            if (knob::wrong_path_enable && wp_recent_count) {
+                                wp_active = 1;
+                                wp_injected = 0;
+                                wp_step = 0;
+                                wp_branch_id = instr_unique_id;
+                                wp_mispredicts++;
+                            }
                         }
                         else {
                             if (branch_prediction == 1) {
@@ -185,7 +237,7 @@ void O3_CPU::handle_branch()
                     }
 
                     //if ((num_reads == FETCH_WIDTH) || (ROB.occupancy == ROB.SIZE))
-                    if ((num_reads >= instrs_to_read_this_cycle) || (ROB.occupancy == ROB.SIZE))
+                    if ((num_reads >= instrs_to_read_this_cycle) || (!knob::ftq_size && (ROB.occupancy == ROB.SIZE)))
                         continue_reading = 0;
                 }
                 instr_unique_id++;
@@ -261,11 +313,14 @@ void O3_CPU::handle_branch()
                 if (num_mem_ops > 0) 
                     arch_instr.is_memory = 1;
 
-                // virtually add this instruction to the ROB
-                if (ROB.occupancy < ROB.SIZE) {
-                    uint32_t rob_index = add_to_rob(&arch_instr);
+                // virtually add this instruction to the ROB, or to the FTQ when the predictor runs ahead of fetch
+                if (knob::ftq_size || (ROB.occupancy < ROB.SIZE)) {
+                    ooo_model_instr *entry = knob::ftq_size ? ftq_enqueue(&arch_instr) : &ROB.entry[add_to_rob(&arch_instr)];
                     num_reads++;
 
+                    if (knob::wrong_path_enable)
+                        wrong_path_train(&arch_instr);
+
                     // branch prediction
                     if (arch_instr.is_branch) {
 
@@ -301,7 +356,16 @@ void O3_CPU::handle_branch()
                             // and stall any additional fetches until the branch is executed
                             fetch_stall = 1; 
 
-                            ROB.entry[rob_index].branch_mispredicted = 1;
+                            entry->branch_mispredicted = 1;
+
+                            // run down the predicted path until the branch resolves
+                            if (knob::wrong_path_enable && wp_recent_count) {
+                                wp_active = 1;
+                                wp_injected = 0;
+                                wp_step = 0;
+                                wp_branch_id = instr_unique_id;
+                                wp_mispredicts++;
+                            }
                         }
                         else {
                             if (branch_prediction == 1) {
@@ -319,7 +383,7 @@ void O3_CPU::handle_branch()
                     }
 
                     //if ((num_reads == FETCH_WIDTH) || (ROB.occupancy == ROB.SIZE))
-                    if ((num_reads >= instrs_to_read_this_cycle) || (ROB.occupancy == ROB.SIZE))
+                    if ((num_reads >= instrs_to_read_this_cycle) || (!knob::ftq_size && (ROB.occupancy == ROB.SIZE)))
                         continue_reading = 0;
                 }
                 instr_unique_id++;
@@ -344,6 +408,8 @@ uint32_t O3_CPU::add_to_rob(ooo_model_instr *arch_instr)
     ROB.entry[index] = *arch_instr;
     ROB.entry[index].event_cycle = current_core_cycle[cpu];
 
+    add_store_index(index);
+
     ROB.occupancy++;
     ROB.tail++;
     if (ROB.tail >= ROB.SIZE)
@@ -409,7 +475,9 @@ uint32_t O3_CPU::check_rob(uint64_t instr_id)
 
 void O3_CPU::fetch_instruction()
 {
-    // TODO: can we model wrong path execusion?
+    // wrong path is approximated by loads synthesized from recent load streams
+    if (wp_active)
+        wrong_path_fetch();
 
   // if we had a branch mispredict, turn fetching back on after the branch mispredict penalty
   if((fetch_stall == 1) && (current_core_cycle[cpu] >= fetch_resume_cycle) && (fetch_resume_cycle != 0))
@@ -533,6 +601,7 @@ void O3_CPU::fetch_instruction()
 
             ROB.entry[fetch_index].fetched = INFLIGHT;
             ROB.last_fetch = fetch_index;
+
             fetch_index++;
             if (fetch_index == ROB.SIZE)
                 fetch_index = 0;
@@ -550,38 +619,34 @@ void O3_CPU::schedule_instruction()
         return;
 
     // execution is out-of-order but we have an in-order scheduling algorithm to detect all RAW dependencies
-    uint32_t limit = ROB.next_fetch[1];
-    num_searched = 0;
-    if (ROB.head < limit) {
-        for (uint32_t i=ROB.head; i<limit; i++) { 
-            if ((ROB.entry[i].fetched != COMPLETED) || (ROB.entry[i].event_cycle > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
-                return;
+    // every entry older than ROB.next_schedule is already scheduled and waits for its producers in the
+    // RTE/RTM ready lists, so scheduling picks up at that oldest unscheduled entry and stalls while it is
+    // not fetched yet or its event_cycle is in the future; the work done is one step per scheduled instruction
+    uint32_t i = ROB.next_schedule;
+    if (knob::legacy_rob_scan_scheduling)
+        i = ROB.head;
+
+    num_searched = (i >= ROB.head) ? (i - ROB.head) : (ROB.SIZE - ROB.head + i);
+    while (num_searched < SCHEDULER_SIZE) {
+        if ((ROB.entry[i].fetched != COMPLETED) || (ROB.entry[i].event_cycle > current_core_cycle[cpu]))
+            return;
 
-            if (ROB.entry[i].scheduled == 0)
-                do_scheduling(i);
+        if (ROB.entry[i].scheduled == 0)
+            do_scheduling(i);
+        else if (!knob::legacy_rob_scan_scheduling) // the whole ROB is scheduled
+            return;
 
-            num_searched++;
-        }
-    }
-    else {
-        for (uint32_t i=ROB.head; i<ROB.SIZE; i++) {
-            if ((ROB.entry[i].fetched != COMPLETED) || (ROB.entry[i].event_cycle > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
+        num_searched++;
+        i++;
+        if (i == ROB.SIZE) {
+            // the legacy scan restarts at ROB.head every cycle, stalls behind any older entry whose event_cycle
+            // is in the future and stops at the end of the ROB array
+            if (knob::legacy_rob_scan_scheduling)
                 return;
-
-            if (ROB.entry[i].scheduled == 0)
-                do_scheduling(i);
-
-            num_searched++;
-        }
-        for (uint32_t i=0; i<limit; i++) { 
-            if ((ROB.entry[i].fetched != COMPLETED) || (ROB.entry[i].event_cycle > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
-                return;
-
-            if (ROB.entry[i].scheduled == 0)
-                do_scheduling(i);
-
-            num_searched++;
+            i = 0;
         }
+        if (i == ROB.head)
+            return;
     }
 }
 
@@ -592,8 +657,13 @@ void O3_CPU::do_scheduling(uint32_t rob_index)
     reg_dependency(rob_index);
     ROB.next_schedule = (rob_index == (ROB.SIZE - 1)) ? 0 : (rob_index + 1);
 
-    if (ROB.entry[rob_index].is_memory)
+    if (ROB.entry[rob_index].is_memory) {
         ROB.entry[rob_index].scheduled = INFLIGHT;
+
+        // remember this rob_index in the Ready-To-Memory-schedule heap
+        if (ROB.entry[rob_index].reg_ready)
+            RTM.push(make_pair(ROB.entry[rob_index].instr_id, rob_index));
+    }
     else {
         ROB.entry[rob_index].scheduled = COMPLETED;
 
@@ -641,32 +711,38 @@ void O3_CPU::reg_dependency(uint32_t rob_index)
     } }); 
 
     // check RAW dependency
-    int prior = rob_index - 1;
-    if (prior < 0)
-        prior = ROB.SIZE - 1;
-
-    if (rob_index != ROB.head) {
-        if ((int)ROB.head <= prior) {
-            for (int i=prior; i>=(int)ROB.head; i--) if (ROB.entry[i].executed != COMPLETED) {
-		for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++) {
-			if (ROB.entry[rob_index].source_registers[j] && (ROB.entry[rob_index].reg_RAW_checked[j] == 0))
-				reg_RAW_dependency(i, rob_index, j);
-		}
-	    }
-        } else {
-            for (int i=prior; i>=0; i--) if (ROB.entry[i].executed != COMPLETED) {
-		for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++) {
-			if (ROB.entry[rob_index].source_registers[j] && (ROB.entry[rob_index].reg_RAW_checked[j] == 0))
-				reg_RAW_dependency(i, rob_index, j);
-		}
-	    }
-            for (int i=ROB.SIZE-1; i>=(int)ROB.head; i--) if (ROB.entry[i].executed != COMPLETED) {
-		for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++) {
-			if (ROB.entry[rob_index].source_registers[j] && (ROB.entry[rob_index].reg_RAW_checked[j] == 0))
-				reg_RAW_dependency(i, rob_index, j);
-		}
-	    }
-        }
+    // instructions are scheduled in program order, so the rename table holds
+    // the youngest older writer of each source register
+    for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++) {
+        uint8_t reg = ROB.entry[rob_index].source_registers[j];
+        if ((reg == 0) || ROB.entry[rob_index].reg_RAW_checked[j])
+            continue;
+
+        uint32_t prior = RAT_rob_index[reg];
+        if ((prior < ROB_SIZE) && (ROB.entry[prior].instr_id == RAT_instr_id[reg]) && (ROB.entry[prior].executed != COMPLETED))
+            reg_RAW_dependency(prior, rob_index, j);
+    }
+
+    // rename destination registers
+    for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+        uint8_t reg = ROB.entry[rob_index].destination_registers[i];
+        if (reg == 0)
+            continue;
+
+        RAT_rob_index[reg] = rob_index;
+        RAT_instr_id[reg] = ROB.entry[rob_index].instr_id;
+    }
+}
+
+void O3_CPU::rename_release(uint32_t rob_index)
+{
+    for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+        uint8_t reg = ROB.entry[rob_index].destination_registers[i];
+        if (reg == 0)
+            continue;
+
+        if ((RAT_rob_index[reg] == rob_index) && (RAT_instr_id[reg] == ROB.entry[rob_index].instr_id))
+            RAT_rob_index[reg] = ROB_SIZE;
     }
 }
 
@@ -679,8 +755,7 @@ void O3_CPU::reg_RAW_dependency(uint32_t prior, uint32_t current, uint32_t sourc
         if (ROB.entry[prior].destination_registers[i] == ROB.entry[current].source_registers[source_index]) {
 
             // we need to mark this dependency in the ROB since the producer might not be added in the store queue yet
-            ROB.entry[prior].registers_instrs_depend_on_me.insert (current);   // this load cannot be executed until the prior store gets executed
-            ROB.entry[prior].registers_index_depend_on_me[source_index].insert (current);   // this load cannot be executed until the prior store gets executed
+            ROB.entry[prior].registers_consumers.push_back (reg_consumer(current, source_index));   // this instruction cannot be executed until the prior one gets executed
             ROB.entry[prior].reg_RAW_producer = 1;
 
             ROB.entry[current].reg_ready = 0;
@@ -705,7 +780,7 @@ void O3_CPU::execute_instruction()
 
     // out-of-order execution for non-memory instructions
     // memory instructions are handled by memory_instruction()
-    uint32_t exec_issued = 0, num_iteration = 0;
+    uint32_t exec_issued = 0;
 
     while (exec_issued < EXEC_WIDTH) {
         if (RTE0[RTE0_head] < ROB_SIZE) {
@@ -719,19 +794,16 @@ void O3_CPU::execute_instruction()
                     RTE0_head = 0;
                 exec_issued++;
             }
+            else
+                break; // the head is not ready yet
         }
         else {
             //DP (if (warmup_complete[cpu]) {
             //cout << "[RTE0] is empty head: " << RTE0_head << " tail: " << RTE0_tail << endl; });
             break;
         }
-
-        num_iteration++;
-        if (num_iteration == (ROB_SIZE-1))
-            break;
     }
 
-    num_iteration = 0;
     while (exec_issued < EXEC_WIDTH) {
         if (RTE1[RTE1_head] < ROB_SIZE) {
             uint32_t exec_index = RTE1[RTE1_head];
@@ -744,16 +816,14 @@ void O3_CPU::execute_instruction()
                     RTE1_head = 0;
                 exec_issued++;
             }
+            else
+                break; // the head is not ready yet
         }
         else {
             //DP (if (warmup_complete[cpu]) {
             //cout << "[RTE1] is empty head: " << RTE1_head << " tail: " << RTE1_tail << endl; });
             break;
         }
-
-        num_iteration++;
-        if (num_iteration == (ROB_SIZE-1))
-            break;
     }
 }
 
@@ -779,49 +849,27 @@ void O3_CPU::do_execution(uint32_t rob_index)
 
 void O3_CPU::schedule_memory_instruction()
 {
-    if ((ROB.head == ROB.tail) && ROB.occupancy == 0)
+    if (RTM.empty())
         return;
 
-    // execution is out-of-order but we have an in-order scheduling algorithm to detect all RAW dependencies
-    uint32_t limit = ROB.next_schedule;
+    // oldest first; instructions that could not get all of their LQ/SQ entries stay in the heap
+    vector<pair<uint64_t, uint32_t> > pending;
     num_searched = 0;
-    if (ROB.head < limit) {
-        for (uint32_t i=ROB.head; i<limit; i++) {
+    while (!RTM.empty() && (num_searched < SCHEDULER_SIZE)) {
+        uint32_t rob_index = RTM.top().second;
+        if (ROB.entry[rob_index].event_cycle > current_core_cycle[cpu])
+            break;
 
-            if (ROB.entry[i].is_memory == 0)
-                continue;
+        pending.push_back(RTM.top());
+        RTM.pop();
 
-            if ((ROB.entry[i].fetched != COMPLETED) || (ROB.entry[i].event_cycle > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
-                break;
-
-            if (ROB.entry[i].is_memory && ROB.entry[i].reg_ready && (ROB.entry[i].scheduled == INFLIGHT))
-                do_memory_scheduling(i);
-        }
+        do_memory_scheduling(rob_index);
+        if (ROB.entry[rob_index].scheduled == COMPLETED)
+            pending.pop_back();
     }
-    else {
-        for (uint32_t i=ROB.head; i<ROB.SIZE; i++) {
-
-            if (ROB.entry[i].is_memory == 0)
-                continue;
-
-            if ((ROB.entry[i].fetched != COMPLETED) || (ROB.entry[i].event_cycle > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
-                break;
-
-            if (ROB.entry[i].is_memory && ROB.entry[i].reg_ready && (ROB.entry[i].scheduled == INFLIGHT))
-                do_memory_scheduling(i);
-        }
-        for (uint32_t i=0; i<limit; i++) {
 
-            if (ROB.entry[i].is_memory == 0)
-                continue;
-
-            if ((ROB.entry[i].fetched != COMPLETED) || (ROB.entry[i].event_cycle > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
-                break;
-
-            if (ROB.entry[i].is_memory && ROB.entry[i].reg_ready && (ROB.entry[i].scheduled == INFLIGHT))
-                do_memory_scheduling(i);
-        }
-    }
+    for (uint32_t i=0; i<pending.size(); i++)
+        RTM.push(pending[i]);
 }
 
 void O3_CPU::execute_memory_instruction()
@@ -904,17 +952,18 @@ uint32_t O3_CPU::check_and_add_lsq(uint32_t rob_index)
 
 void O3_CPU::add_load_queue(uint32_t rob_index, uint32_t data_index)
 {
-    // search for an empty slot 
+    // take the lowest empty slot from the free bitmap
     uint32_t lq_index = LQ.SIZE;
-    for (uint32_t i=0; i<LQ.SIZE; i++) {
-        if (LQ.entry[i].virtual_address == 0) {
-            lq_index = i;
+    for (uint32_t i=0; i<LQ_FREE_WORDS; i++) {
+        if (LQ_free[i]) {
+            lq_index = i*64 + __builtin_ctzll(LQ_free[i]);
+            LQ_free[i] &= LQ_free[i] - 1;
             break;
         }
     }
 
     // sanity check
-    if (lq_index == LQ.SIZE) {
+    if ((lq_index == LQ.SIZE) || LQ.entry[lq_index].virtual_address) {
         cerr << "instr_id: " << ROB.entry[rob_index].instr_id << " no empty slot in the load queue!!!" << endl;
         assert(0);
     }
@@ -931,84 +980,22 @@ void O3_CPU::add_load_queue(uint32_t rob_index, uint32_t data_index)
     LQ.entry[lq_index].event_cycle = current_core_cycle[cpu] + SCHEDULING_LATENCY;
     LQ.occupancy++;
 
-    // check RAW dependency
-    int prior = rob_index - 1;
-    if (prior < 0)
-        prior = ROB.SIZE - 1;
-
-    if (rob_index != ROB.head) {
-        if ((int)ROB.head <= prior) {
-            for (int i=prior; i>=(int)ROB.head; i--) {
-                if (LQ.entry[lq_index].producer_id != UINT64_MAX)
-                {
-                    break;
-                }
-
-                    mem_RAW_dependency(i, rob_index, data_index, lq_index);
-            }
-        }
-        else {
-            for (int i=prior; i>=0; i--) {
-                if (LQ.entry[lq_index].producer_id != UINT64_MAX)
-                {
-                    break;
-                }
-
-                    mem_RAW_dependency(i, rob_index, data_index, lq_index);
-            }
-            for (int i=ROB.SIZE-1; i>=(int)ROB.head; i--) { 
-                if (LQ.entry[lq_index].producer_id != UINT64_MAX)
-                {
-                    break;
-                }
+    // check RAW dependency against the youngest older store to the same address
+    uint32_t prior = find_store_producer(rob_index, data_index);
+    if (prior != ROB_SIZE)
+        mem_RAW_dependency(prior, rob_index, data_index, lq_index);
 
-                    mem_RAW_dependency(i, rob_index, data_index, lq_index);
-            }
-        }
-    }
-
-    // check
-    // 1) if store-to-load forwarding is possible
-    // 2) if there is WAR that are not correctly executed
+    // check if store-to-load forwarding is possible
+    // forwarding should be done by the SQ entry that holds the same producer_id from RAW dependency check
+    // a younger store that already executed (WAR) needs no action: thanks to the store buffer,
+    // its data is not written back to the memory system until retirement, so the load just reads the data cache
     uint32_t forwarding_index = SQ.SIZE;
-    for (uint32_t i=0; i<SQ.SIZE; i++) {
-
-        // skip empty slot
-        if (SQ.entry[i].virtual_address == 0)
-            continue;
-
-        // forwarding should be done by the SQ entry that holds the same producer_id from RAW dependency check
-        if (SQ.entry[i].virtual_address == LQ.entry[lq_index].virtual_address) { // store-to-load forwarding check
-
-            // forwarding store is in the SQ
-            if ((rob_index != ROB.head) && (LQ.entry[lq_index].producer_id == SQ.entry[i].instr_id)) { // RAW
-                forwarding_index = i;
-                break; // should be break
-            }
-
-            if ((LQ.entry[lq_index].producer_id == UINT64_MAX) && (LQ.entry[lq_index].instr_id <= SQ.entry[i].instr_id)) { // WAR 
-                // a load is about to be added in the load queue and we found a store that is 
-                // "logically later in the program order but already executed" => this is not correctly executed WAR
-                // due to out-of-order execution, this case is possible, for example
-                // 1) application is load intensive and load queue is full
-                // 2) we have loads that can't be added in the load queue
-                // 3) subsequent stores logically behind in the program order are added in the store queue first
-
-                // thanks to the store buffer, data is not written back to the memory system until retirement
-                // also due to in-order retirement, this "already executed store" cannot be retired until we finish the prior load instruction 
-                // if we detect WAR when a load is added in the load queue, just let the load instruction to access the memory system
-                // no need to mark any dependency because this is actually WAR not RAW
-
-                // do not forward data from the store queue since this is WAR
-                // just read correct data from data cache
-
-                LQ.entry[lq_index].physical_address = 0;
-                LQ.entry[lq_index].translated = 0;
-                LQ.entry[lq_index].fetched = 0;
-                
-                DP(if(warmup_complete[cpu]) {
-                cout << "[LQ] " << __func__ << " instr_id: " << LQ.entry[lq_index].instr_id << " reset fetched: " << +LQ.entry[lq_index].fetched;
-                cout << " to obey WAR store instr_id: " << SQ.entry[i].instr_id << " cycle: " << current_core_cycle[cpu] << endl; });
+    if (prior != ROB_SIZE) {
+        for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+            uint32_t sq_index = ROB.entry[prior].sq_index[i];
+            if ((sq_index != UINT32_MAX) && (SQ.entry[sq_index].virtual_address == LQ.entry[lq_index].virtual_address)) {
+                forwarding_index = sq_index;
+                break;
             }
         }
     }
@@ -1061,6 +1048,60 @@ void O3_CPU::add_load_queue(uint32_t rob_index, uint32_t data_index)
     cout << " fetched: " << +LQ.entry[lq_index].fetched << " index: " << lq_index << " occupancy: " << LQ.occupancy << " cycle: " << current_core_cycle[cpu] << endl; });
 }
 
+void O3_CPU::add_store_index(uint32_t rob_index)
+{
+    for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+        if (ROB.entry[rob_index].destination_memory[i] == 0)
+            continue;
+
+        uint32_t bucket = (ROB.entry[rob_index].destination_memory[i] >> LOG2_BLOCK_SIZE) % STORE_INDEX_SIZE;
+        ROB.entry[rob_index].store_chain[i] = store_index[bucket];
+        ROB.entry[rob_index].store_chain_id[i] = store_index_id[bucket];
+        store_index[bucket] = rob_index*NUM_INSTR_DESTINATIONS_SPARC + i;
+        store_index_id[bucket] = ROB.entry[rob_index].instr_id;
+    }
+}
+
+void O3_CPU::release_store_index(uint32_t rob_index)
+{
+    for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+        if (ROB.entry[rob_index].destination_memory[i] == 0)
+            continue;
+
+        // younger stores in the bucket detect the stale link through the instr_id check
+        uint32_t bucket = (ROB.entry[rob_index].destination_memory[i] >> LOG2_BLOCK_SIZE) % STORE_INDEX_SIZE;
+        if ((store_index[bucket] == rob_index*NUM_INSTR_DESTINATIONS_SPARC + i) && (store_index_id[bucket] == ROB.entry[rob_index].instr_id))
+            store_index[bucket] = UINT32_MAX;
+    }
+}
+
+// returns the ROB index of the youngest store older than rob_index that writes
+// the address read by source_memory[data_index], ROB_SIZE if there is none
+uint32_t O3_CPU::find_store_producer(uint32_t rob_index, uint32_t data_index)
+{
+    uint64_t address = ROB.entry[rob_index].source_memory[data_index];
+    uint32_t bucket = (address >> LOG2_BLOCK_SIZE) % STORE_INDEX_SIZE;
+    uint32_t node = store_index[bucket];
+    uint64_t node_id = store_index_id[bucket];
+
+    // the chain is ordered from young to old, and retirement is in-order,
+    // so the first retired link ends the search
+    while (node != UINT32_MAX) {
+        uint32_t prior = node / NUM_INSTR_DESTINATIONS_SPARC,
+                 i = node % NUM_INSTR_DESTINATIONS_SPARC;
+        if (ROB.entry[prior].instr_id != node_id)
+            break;
+
+        if ((node_id < ROB.entry[rob_index].instr_id) && (ROB.entry[prior].destination_memory[i] == address))
+            return prior;
+
+        node = ROB.entry[prior].store_chain[i];
+        node_id = ROB.entry[prior].store_chain_id[i];
+    }
+
+    return ROB_SIZE;
+}
+
 void O3_CPU::mem_RAW_dependency(uint32_t prior, uint32_t current, uint32_t data_index, uint32_t lq_index)
 {
     for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
@@ -1147,7 +1188,7 @@ void O3_CPU::add_store_queue(uint32_t rob_index, uint32_t data_index)
 void O3_CPU::operate_lsq()
 {
     // handle store
-    uint32_t store_issued = 0, num_iteration = 0;
+    uint32_t store_issued = 0;
 
     while (store_issued < SQ_WIDTH) {
         if (RTS0[RTS0_head] < SQ_SIZE) {
@@ -1193,19 +1234,16 @@ void O3_CPU::operate_lsq()
 
                 store_issued++;
             }
+            else
+                break; // the head is not ready yet
         }
         else {
             //DP (if (warmup_complete[cpu]) {
             //cout << "[RTS0] is empty head: " << RTS0_head << " tail: " << RTS0_tail << endl; });
             break;
         }
-
-        num_iteration++;
-        if (num_iteration == (SQ_SIZE-1))
-            break;
     }
 
-    num_iteration = 0;
     while (store_issued < SQ_WIDTH) {
         if (RTS1[RTS1_head] < SQ_SIZE) {
             uint32_t sq_index = RTS1[RTS1_head];
@@ -1219,20 +1257,17 @@ void O3_CPU::operate_lsq()
 
                 store_issued++;
             }
+            else
+                break; // the head is not ready yet
         }
         else {
             //DP (if (warmup_complete[cpu]) {
             //cout << "[RTS1] is empty head: " << RTS1_head << " tail: " << RTS1_tail << endl; });
             break;
         }
-
-        num_iteration++;
-        if (num_iteration == (SQ_SIZE-1))
-            break;
     }
 
     unsigned load_issued = 0;
-    num_iteration = 0;
     while (load_issued < LQ_WIDTH) {
         if (RTL0[RTL0_head] < LQ_SIZE) {
             uint32_t lq_index = RTL0[RTL0_head];
@@ -1275,44 +1310,40 @@ void O3_CPU::operate_lsq()
 
                 load_issued++;
             }
+            else
+                break; // the head is not ready yet
         }
         else {
             //DP (if (warmup_complete[cpu]) {
             //cout << "[RTL0] is empty head: " << RTL0_head << " tail: " << RTL0_tail << endl; });
             break;
         }
-
-        num_iteration++;
-        if (num_iteration == (LQ_SIZE-1))
-            break;
     }
 
-    num_iteration = 0;
     while (load_issued < LQ_WIDTH) {
         if (RTL1[RTL1_head] < LQ_SIZE) {
             uint32_t lq_index = RTL1[RTL1_head];
             if (LQ.entry[lq_index].event_cycle <= current_core_cycle[cpu]) {
                 int rq_index = execute_load(LQ.entry[lq_index].rob_index, lq_index, LQ.entry[lq_index].data_index);
 
-                if (rq_index != -2) {
-                    RTL1[RTL1_head] = LQ_SIZE;
-                    RTL1_head++;
-                    if (RTL1_head == LQ_SIZE)
-                        RTL1_head = 0;
+                if (rq_index == -2)
+                    break;
 
-                    load_issued++;
-                }
+                RTL1[RTL1_head] = LQ_SIZE;
+                RTL1_head++;
+                if (RTL1_head == LQ_SIZE)
+                    RTL1_head = 0;
+
+                load_issued++;
             }
+            else
+                break; // the head is not ready yet
         }
         else {
             //DP (if (warmup_complete[cpu]) {
             //cout << "[RTL1] is empty head: " << RTL1_head << " tail: " << RTL1_tail << endl; });
             break;
         }
-
-        num_iteration++;
-        if (num_iteration == (LQ_SIZE-1))
-            break;
     }
 }
 
@@ -1469,43 +1500,44 @@ void O3_CPU::complete_execution(uint32_t rob_index)
 
 void O3_CPU::reg_RAW_release(uint32_t rob_index)
 {
-    // if (!ROB.entry[rob_index].registers_instrs_depend_on_me.empty()) 
+    vector<reg_consumer> &consumers = ROB.entry[rob_index].registers_consumers;
 
-    ITERATE_SET(i,ROB.entry[rob_index].registers_instrs_depend_on_me, ROB_SIZE) {
-        for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++) {
-            if (ROB.entry[rob_index].registers_index_depend_on_me[j].search (i)) {
-                ROB.entry[i].num_reg_dependent--;
+    for (uint32_t k=0; k<consumers.size(); k++) {
+        uint32_t i = consumers[k].rob_index;
+        ROB.entry[i].num_reg_dependent--;
 
-                if (ROB.entry[i].num_reg_dependent == 0) {
-                    ROB.entry[i].reg_ready = 1;
-                    if (ROB.entry[i].is_memory)
-                        ROB.entry[i].scheduled = INFLIGHT;
-                    else {
-                        ROB.entry[i].scheduled = COMPLETED;
+        if (ROB.entry[i].num_reg_dependent == 0) {
+            ROB.entry[i].reg_ready = 1;
+            if (ROB.entry[i].is_memory) {
+                ROB.entry[i].scheduled = INFLIGHT;
+
+                // remember this rob_index in the Ready-To-Memory-schedule heap
+                RTM.push(make_pair(ROB.entry[i].instr_id, i));
+            }
+            else {
+                ROB.entry[i].scheduled = COMPLETED;
 
 #ifdef SANITY_CHECK
-                        if (RTE0[RTE0_tail] < ROB_SIZE)
-                            assert(0);
+                if (RTE0[RTE0_tail] < ROB_SIZE)
+                    assert(0);
 #endif
-                        // remember this rob_index in the Ready-To-Execute array 0
-                        RTE0[RTE0_tail] = i;
-
-                        DP (if (warmup_complete[cpu]) {
-                        cout << "[RTE0] " << __func__ << " instr_id: " << ROB.entry[i].instr_id << " rob_index: " << i << " is added to RTE0";
-                        cout << " head: " << RTE0_head << " tail: " << RTE0_tail << endl; }); 
+                // remember this rob_index in the Ready-To-Execute array 0
+                RTE0[RTE0_tail] = i;
 
-                        RTE0_tail++;
-                        if (RTE0_tail == ROB_SIZE)
-                            RTE0_tail = 0;
+                DP (if (warmup_complete[cpu]) {
+                cout << "[RTE0] " << __func__ << " instr_id: " << ROB.entry[i].instr_id << " rob_index: " << i << " is added to RTE0";
+                cout << " head: " << RTE0_head << " tail: " << RTE0_tail << endl; }); 
 
-                    }
-                }
+                RTE0_tail++;
+                if (RTE0_tail == ROB_SIZE)
+                    RTE0_tail = 0;
 
-                DP (if (warmup_complete[cpu]) {
-                cout << "[ROB] " << __func__ << " instr_id: " << ROB.entry[rob_index].instr_id << " releases instr_id: ";
-                cout << ROB.entry[i].instr_id << " reg_index: " << +ROB.entry[i].source_registers[j] << " num_reg_dependent: " << ROB.entry[i].num_reg_dependent << " cycle: " << current_core_cycle[cpu] << endl; });
             }
         }
+
+        DP (if (warmup_complete[cpu]) {
+        cout << "[ROB] " << __func__ << " instr_id: " << ROB.entry[rob_index].instr_id << " releases instr_id: ";
+        cout << ROB.entry[i].instr_id << " reg_index: " << +ROB.entry[i].source_registers[consumers[k].source_index] << " num_reg_dependent: " << ROB.entry[i].num_reg_dependent << " cycle: " << current_core_cycle[cpu] << endl; });
     }
 }
 
@@ -1514,6 +1546,7 @@ void O3_CPU::operate_cache()
     ITLB.operate();
     DTLB.operate();
     STLB.operate();
+    PTW.operate();
     L1I.operate();
     L1D.operate();
     L2C.operate();
@@ -1614,8 +1647,15 @@ void O3_CPU::complete_data_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
              sq_index = queue->entry[index].sq_index,
              lq_index = queue->entry[index].lq_index;
 
+    // page table entries go back to the walker
+    if (queue->entry[index].page_walk) {
+        PTW.return_data(&queue->entry[index]);
+        queue->remove_queue(&queue->entry[index]);
+        return;
+    }
+
 #ifdef SANITY_CHECK
-    if (queue->entry[index].type != RFO) {
+    if ((queue->entry[index].type != RFO) && (queue->entry[index].wrong_path == 0)) {
         if (rob_index != check_rob(queue->entry[index].instr_id))
             assert(0);
     }
@@ -1669,7 +1709,7 @@ void O3_CPU::complete_data_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
     }
     else { // L1D
 
-        if (queue->entry[index].type == RFO)
+        if ((queue->entry[index].type == RFO) || queue->entry[index].wrong_path)
             handle_merged_load(&queue->entry[index]);
         else { 
 #ifdef SANITY_CHECK
@@ -1705,6 +1745,160 @@ void O3_CPU::complete_data_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
     queue->remove_queue(&queue->entry[index]);
 }
 
+ooo_model_instr *O3_CPU::ftq_enqueue(ooo_model_instr *arch_instr)
+{
+    if (FTQ.empty() || FTQ.back().closed || ((FTQ.back().ip >> LOG2_BLOCK_SIZE) != (arch_instr->ip >> LOG2_BLOCK_SIZE))) {
+        FETCH_TARGET target;
+        target.ip = arch_instr->ip;
+        target.first_instr_id = arch_instr->instr_id;
+        target.enqueue_cycle = current_core_cycle[cpu];
+        FTQ.push_back(target);
+        ftq_blocks++;
+
+        // steer the L1I prefetcher with the new block, as long as its page is already mapped
+        uint64_t unique_vpage = arch_instr->ip >> LOG2_PAGE_SIZE, pa;
+        if (knob::knob_cloudsuite)
+            unique_vpage = (unique_vpage << 9) | (256 + arch_instr->asid[0]);
+        if (lookup_vpage_to_pa(cpu, unique_vpage, arch_instr->ip, pa))
+            L1I.l1i_prefetcher_fetch_target(arch_instr->ip, pa);
+        else
+            ftq_untranslated++;
+    }
+
+    FTQ.back().last_instr_id = arch_instr->instr_id;
+    if (arch_instr->is_branch && arch_instr->branch_taken)
+        FTQ.back().closed = 1;
+
+    FTQ_instr.push_back(*arch_instr);
+    return &FTQ_instr.back();
+}
+
+void O3_CPU::ftq_fetch()
+{
+    // move up to FETCH_WIDTH predicted instructions into the ROB, stopping at the end of a taken-branch block
+    for (uint32_t i=0; i<FETCH_WIDTH; i++) {
+        if (FTQ_instr.empty() || (ROB.occupancy == ROB.SIZE))
+            break;
+
+        FETCH_TARGET &target = FTQ.front();
+        if (FTQ_instr.front().instr_id == target.first_instr_id)
+            ftq_lead_cycles += current_core_cycle[cpu] - target.enqueue_cycle;
+
+        uint64_t instr_id = FTQ_instr.front().instr_id;
+        add_to_rob(&FTQ_instr.front());
+        FTQ_instr.pop_front();
+
+        // a fetch block leaves the FTQ once its last instruction is in the ROB
+        if (target.last_instr_id == instr_id) {
+            uint8_t closed = target.closed;
+            FTQ.pop_front();
+            if (closed)
+                break;
+        }
+    }
+}
+
+void O3_CPU::wrong_path_train(ooo_model_instr *arch_instr)
+{
+    // the first load address of each instruction trains its PC's stream
+    for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++) {
+        if (arch_instr->source_memory[i] == 0)
+            continue;
+
+        uint64_t ip = arch_instr->ip,
+                 address = arch_instr->source_memory[i];
+        WRONG_PATH_LOAD &entry = wp_table[ip % wp_table.size()];
+        if (entry.ip == ip)
+            entry.stride = (int64_t)(address - entry.last_address);
+        else {
+            entry.ip = ip;
+            entry.stride = 0;
+        }
+        entry.last_address = address;
+
+        // tight loops would otherwise fill the history with a single PC
+        uint32_t youngest = (wp_recent_tail == 0) ? (wp_recent_ip.size() - 1) : (wp_recent_tail - 1);
+        if ((wp_recent_count == 0) || (wp_recent_ip[youngest] != ip)) {
+            wp_recent_ip[wp_recent_tail] = ip;
+            wp_recent_tail++;
+            if (wp_recent_tail == wp_recent_ip.size())
+                wp_recent_tail = 0;
+            if (wp_recent_count < wp_recent_ip.size())
+                wp_recent_count++;
+        }
+
+        break;
+    }
+}
+
+void O3_CPU::wrong_path_fetch()
+{
+    // the mispredicted branch has executed, fetch is back on the correct path
+    if ((fetch_stall == 0) || (fetch_resume_cycle != 0)) {
+        wp_active = 0;
+        return;
+    }
+
+    for (uint32_t i=0; i<knob::wrong_path_width; i++) {
+
+        if (wp_injected >= knob::wrong_path_budget) {
+            wp_active = 0;
+            return;
+        }
+
+        // walk the recent load PCs from youngest to oldest, one stride further down each stream per pass
+        uint32_t slot = (wp_recent_tail + 2*wp_recent_ip.size() - 1 - (wp_step % wp_recent_count)) % wp_recent_ip.size();
+        uint64_t ip = wp_recent_ip[slot];
+        WRONG_PATH_LOAD &entry = wp_table[ip % wp_table.size()];
+
+        wp_step++;
+        if (entry.ip != ip) // stream was replaced by an aliasing PC
+            continue;
+
+        if (entry.branch_id != wp_branch_id) {
+            entry.branch_id = wp_branch_id;
+            entry.next_address = entry.last_address + entry.stride;
+        }
+
+        // only pages the correct path has already touched are visited
+        uint64_t pa;
+        if (!lookup_va_to_pa(cpu, entry.next_address, pa)) {
+            entry.next_address += entry.stride;
+            wp_injected++;
+            wp_unmapped++;
+            continue;
+        }
+
+        PACKET data_packet;
+        data_packet.fill_level = FILL_L1;
+        data_packet.cpu = cpu;
+        data_packet.lq_index = LQ_SIZE;
+        data_packet.address = pa >> LOG2_BLOCK_SIZE;
+        data_packet.full_addr = pa;
+        data_packet.instr_id = instr_unique_id;
+        data_packet.ip = ip;
+        data_packet.type = LOAD;
+        data_packet.asid[0] = cpu;
+        data_packet.asid[1] = cpu;
+        data_packet.event_cycle = current_core_cycle[cpu];
+        data_packet.wrong_path = 1;
+
+        // retry the same address next cycle
+        if (L1D.add_rq(&data_packet) == -2) {
+            wp_step--;
+            return;
+        }
+
+        DP (if (warmup_complete[cpu]) {
+        cout << "[WRONG_PATH] " << __func__ << " branch_id: " << wp_branch_id << " ip: " << hex << ip;
+        cout << " vaddr: " << entry.next_address << " full_addr: " << pa << dec << " injected: " << wp_injected << endl; });
+
+        entry.next_address += entry.stride;
+        wp_injected++;
+        wp_issued++;
+    }
+}
+
 void O3_CPU::handle_o3_fetch(PACKET *current_packet, uint32_t cache_type)
 {
     uint32_t rob_index = current_packet->rob_index,
@@ -1880,6 +2074,9 @@ void O3_CPU::release_load_queue(uint32_t lq_index)
     LSQ_ENTRY empty_entry;
     LQ.entry[lq_index] = empty_entry;
     LQ.occupancy--;
+
+    assert(!(LQ_free[lq_index/64] & (1ull << (lq_index%64))));
+    LQ_free[lq_index/64] |= 1ull << (lq_index%64);
 }
 
 void O3_CPU::retire_rob()
@@ -1965,6 +2162,9 @@ void O3_CPU::retire_rob()
         DP ( if (warmup_complete[cpu]) {
         cout << "[ROB] " << __func__ << " instr_id: " << ROB.entry[ROB.head].instr_id << " is retired" << endl; });
 
+        rename_release(ROB.head);
+        release_store_index(ROB.head);
+
         ooo_model_instr empty_entry;
         ROB.entry[ROB.head] = empty_entry;
 
@@ -0,0 +1,221 @@
+#include "ptw.h"
+
+namespace knob
+{
+    extern uint32_t ptw_walkers;
+    extern uint32_t ptw_pml4_cache_size;
+    extern uint32_t ptw_pdp_cache_size;
+    extern uint32_t ptw_pde_cache_size;
+}
+
+// shared by all cores so that tables never alias
+static uint64_t next_table_page = PTW_TABLE_PAGE_BASE;
+
+void PAGING_STRUCTURE_CACHE::initialize(uint32_t size)
+{
+    SIZE = size;
+    tag.assign(SIZE, 0);
+    lru.assign(SIZE, 0);
+    valid.assign(SIZE, 0);
+}
+
+bool PAGING_STRUCTURE_CACHE::lookup(uint64_t vpn_tag)
+{
+    access++;
+    for (uint32_t i=0; i<SIZE; i++) {
+        if (valid[i] && (tag[i] == vpn_tag)) {
+            lru[i] = ++counter;
+            hit++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void PAGING_STRUCTURE_CACHE::fill(uint64_t vpn_tag)
+{
+    if (SIZE == 0)
+        return;
+
+    // refresh a present entry, else take the first invalid or the least recently used one
+    uint32_t victim = 0;
+    for (uint32_t i=0; i<SIZE; i++) {
+        if (valid[i] && (tag[i] == vpn_tag)) {
+            victim = i;
+            break;
+        }
+        if (!valid[victim])
+            continue;
+        if (!valid[i] || (lru[i] < lru[victim]))
+            victim = i;
+    }
+
+    valid[victim] = 1;
+    tag[victim] = vpn_tag;
+    lru[victim] = ++counter;
+}
+
+void PAGE_TABLE_WALKER::initialize()
+{
+    assert(knob::ptw_walkers > 0);
+    psc[4].initialize(knob::ptw_pml4_cache_size);
+    psc[3].initialize(knob::ptw_pdp_cache_size);
+    psc[2].initialize(knob::ptw_pde_cache_size);
+}
+
+// physical address of the level's entry for this virtual page; tables are allocated on first use
+uint64_t PAGE_TABLE_WALKER::get_entry_address(uint64_t vpn, uint32_t level)
+{
+    uint64_t table = vpn >> (LOG2_PTW_ENTRIES * level),
+             index = (vpn >> (LOG2_PTW_ENTRIES * (level - 1))) & ((1 << LOG2_PTW_ENTRIES) - 1);
+
+    map <uint64_t, uint64_t>::iterator it = table_page[level].find(table);
+    if (it == table_page[level].end())
+        it = table_page[level].insert(make_pair(table, next_table_page++)).first;
+
+    return (it->second << LOG2_PAGE_SIZE) | (index * PTW_ENTRY_SIZE);
+}
+
+void PAGE_TABLE_WALKER::start_walk(PACKET *packet)
+{
+    PAGE_WALK walk;
+    walk.packet = *packet;
+    walk.cycle_started = current_core_cycle[cpu];
+
+    // a 2MB page ends the walk at its PDE, which the PDE cache does not hold
+    if (huge_page_mapped(cpu, packet->address))
+        walk.leaf_level = 2;
+
+    // resume below the lowest level whose entry is cached
+    walk.level = PTW_LEVELS;
+    for (uint32_t level = walk.leaf_level + 1; level <= PTW_LEVELS; level++) {
+        if (psc[level].lookup(packet->address >> (LOG2_PTW_ENTRIES * (level - 1)))) {
+            walk.level = level - 1;
+            break;
+        }
+    }
+
+    active.push_back(walk);
+}
+
+void PAGE_TABLE_WALKER::operate()
+{
+    while ((active.size() < knob::ptw_walkers) && !pending.empty()) {
+        start_walk(&pending.front());
+        pending.pop_front();
+    }
+
+    for (uint32_t i=0; i<active.size(); i++) {
+        PAGE_WALK &walk = active[i];
+        if (walk.issued)
+            continue;
+
+        // the leaf entry is in: hand the translation to the STLB
+        if (walk.level < walk.leaf_level) {
+            // translation prefetches only walk mapped pages and must not touch the page table
+            uint64_t pa;
+            if ((walk.packet.type != PREFETCH) || !lookup_vpage_to_pa(cpu, walk.packet.address, walk.packet.full_addr, pa))
+                pa = va_to_pa(cpu, walk.packet.instr_id, walk.packet.full_addr, walk.packet.address);
+            walk.packet.data = pa >> LOG2_PAGE_SIZE;
+            walk.packet.event_cycle = current_core_cycle[cpu];
+            upper_level_dcache[cpu]->return_data(&walk.packet);
+
+            walks++;
+            if (walk.leaf_level == 2)
+                huge_walks++;
+            walk_cycles += current_core_cycle[cpu] - walk.cycle_started;
+            active.erase(active.begin() + i);
+            i--;
+            continue;
+        }
+
+        walk.entry_address = get_entry_address(walk.packet.address, walk.level);
+
+        // neighbouring pages share entry blocks, wait for a load that is already in flight
+        for (uint32_t j=0; j<active.size(); j++) {
+            if ((j != i) && active[j].issued && ((active[j].entry_address >> LOG2_BLOCK_SIZE) == (walk.entry_address >> LOG2_BLOCK_SIZE))) {
+                walk.issued = 1;
+                entry_merged++;
+                break;
+            }
+        }
+        if (walk.issued)
+            continue;
+
+        PACKET entry_packet;
+        entry_packet.fill_level = FILL_L1;
+        entry_packet.cpu = cpu;
+        entry_packet.lq_index = LQ_SIZE;
+        entry_packet.address = walk.entry_address >> LOG2_BLOCK_SIZE;
+        entry_packet.full_addr = walk.entry_address;
+        entry_packet.instr_id = walk.packet.instr_id;
+        entry_packet.ip = walk.packet.ip;
+        entry_packet.type = LOAD;
+        entry_packet.asid[0] = walk.packet.asid[0];
+        entry_packet.asid[1] = walk.packet.asid[1];
+        entry_packet.event_cycle = current_core_cycle[cpu];
+        entry_packet.page_walk = walk.level;
+
+        // retry next cycle if the L1D cannot take it
+        if (lower_level->add_rq(&entry_packet) == -2)
+            continue;
+
+        walk.issued = 1;
+        entry_loads++;
+    }
+}
+
+// an entry block came back from the L1D, every walk waiting on it moves one level down
+void PAGE_TABLE_WALKER::return_data(PACKET *packet)
+{
+    for (uint32_t i=0; i<active.size(); i++) {
+        PAGE_WALK &walk = active[i];
+        if (!walk.issued || ((walk.entry_address >> LOG2_BLOCK_SIZE) != packet->address))
+            continue;
+
+        if (walk.level > walk.leaf_level)
+            psc[walk.level].fill(walk.packet.address >> (LOG2_PTW_ENTRIES * (walk.level - 1)));
+        walk.level--;
+        walk.issued = 0;
+    }
+}
+
+int PAGE_TABLE_WALKER::add_rq(PACKET *packet)
+{
+    pending.push_back(*packet);
+
+    return -1;
+}
+
+int PAGE_TABLE_WALKER::add_wq(PACKET *packet)
+{
+    return -1;
+}
+
+int PAGE_TABLE_WALKER::add_pq(PACKET *packet)
+{
+    return -1;
+}
+
+void PAGE_TABLE_WALKER::increment_WQ_FULL(uint64_t address)
+{
+
+}
+
+uint32_t PAGE_TABLE_WALKER::get_occupancy(uint8_t queue_type, uint64_t address)
+{
+    if (queue_type == 1)
+        return pending.size() + active.size();
+
+    return 0;
+}
+
+uint32_t PAGE_TABLE_WALKER::get_size(uint8_t queue_type, uint64_t address)
+{
+    // bounded by the STLB's MSHR
+    if (queue_type == 1)
+        return UINT32_MAX;
+
+    return 0;
+}
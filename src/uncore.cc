@@ -6,4 +6,33 @@ UNCORE uncore;
 // constructor
 UNCORE::UNCORE() {
 	cycle = 0;
+	NUMA.node[0] = &DRAM;
+}
+
+static DRAM_TELEMETRY *dram_telemetry(uint64_t address)
+{
+    MEMORY_CONTROLLER *dram = uncore.NUMA.node[uncore.NUMA.get_node(address >> LOG2_BLOCK_SIZE)];
+    return &dram->telemetry[dram->dram_get_channel(address >> LOG2_BLOCK_SIZE)];
+}
+
+float dram_utilization(uint64_t address)
+{
+    return (float)dram_telemetry(address)->utilization / (1 << DRAM_TELEMETRY_FRAC_BITS);
+}
+
+float dram_queueing_delay(uint64_t address)
+{
+    return (float)dram_telemetry(address)->queueing_delay / (1 << DRAM_TELEMETRY_FRAC_BITS);
+}
+
+float dram_row_hit_rate(uint64_t address)
+{
+    return (float)dram_telemetry(address)->row_hit_rate / (1 << DRAM_TELEMETRY_FRAC_BITS);
+}
+
+// quartiles of utilization, like the epoch-based level computed in main.cc
+uint8_t dram_bw_level(uint64_t address)
+{
+    uint64_t level = ((uint64_t)dram_telemetry(address)->utilization * DRAM_BW_LEVELS) >> DRAM_TELEMETRY_FRAC_BITS;
+    return level < DRAM_BW_LEVELS ? level : DRAM_BW_LEVELS - 1;
 }